@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <print>
+#include <string_view>
+
+namespace komaru::bench {
+
+// Keeps the compiler from throwing away a computed value
+template <typename T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+void Measure(std::string_view name, size_t iterations, F&& f) {
+    // Warm up caches and interned types
+    for (size_t i = 0; i < iterations / 10 + 1; ++i) {
+        f();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f();
+    }
+    auto finish = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(finish - start).count();
+    std::println("{:<40} {:>10.1f} ns/iter", name, ns / static_cast<double>(iterations));
+}
+
+}  // namespace komaru::bench
@@ -0,0 +1,92 @@
+#include <bench/bench.hpp>
+
+#include <komaru/parsers/cat_file_parser.hpp>
+#include <komaru/util/filesystem.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+
+using komaru::bench::DoNotOptimize;
+using komaru::bench::Measure;
+
+namespace {
+
+// Writes chains of `+ 1` functions laid out the way the editor saves them, until the file
+// reaches `target_size` bytes. Returns the number of nodes written.
+size_t GenerateCatFile(const std::filesystem::path& path, size_t target_size) {
+    constexpr size_t kChainLength = 100;
+
+    std::ofstream out(path);
+    std::string node;
+    size_t written = 0;
+    size_t nodes_num = 0;
+
+    out << "{\n    \"imports\": [\n    ],\n    \"nodes\": [";
+
+    while (written < target_size) {
+        for (size_t i = 0; i < kChainLength; ++i, ++nodes_num) {
+            bool is_root = i == 0;
+            bool is_end = i + 1 == kChainLength;
+
+            node = std::format(
+                "{}\n        {{\n"
+                "            \"has_input_pin\": {},\n"
+                "            \"id\": {},\n"
+                "            \"main_text\": \"Int\",\n"
+                "            \"out_pins\": [{}\n            ],\n"
+                "{}"
+                "            \"x\": {}.25,\n"
+                "            \"y\": -{}.5\n"
+                "        }}",
+                nodes_num == 0 ? "" : ",", is_root ? "false" : "true", nodes_num,
+                is_end ? ""
+                       : std::format("\n                {{\n"
+                                     "                    \"connections\": [\n"
+                                     "                        {{\n"
+                                     "                            \"node\": {},\n"
+                                     "                            \"text\": \"+ 1\"\n"
+                                     "                        }}\n"
+                                     "                    ]\n"
+                                     "                }}",
+                                     nodes_num + 1),
+                is_root ? std::format("            \"tag_text\": \"f{}\",\n", nodes_num) : "",
+                i * 100, nodes_num % 1000);
+
+            out << node;
+            written += node.size();
+        }
+    }
+
+    out << "\n    ],\n    \"packages\": [\n    ]\n}\n";
+
+    return nodes_num;
+}
+
+}  // namespace
+
+// Usage: bench_cat_file_parser [size in MB, 200 by default]
+int main(int argc, char** argv) {
+    size_t size_mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+    auto path = komaru::util::GenTmpFilepath();
+
+    size_t nodes_num = GenerateCatFile(path, size_mb << 20);
+    std::println("generated {} MB .cat file with {} nodes", std::filesystem::file_size(path) >> 20,
+                 nodes_num);
+
+    Measure("read whole file into a string", 3, [&]() {
+        DoNotOptimize(komaru::util::ReadFile(path)->size());
+    });
+
+    Measure("ReadCatFile", 3, [&]() {
+        auto maybe_file = komaru::parsers::ReadCatFile(path);
+        if (!maybe_file || maybe_file->program.GetNodes().size() != nodes_num) {
+            std::println("failed to read the generated file");
+            std::exit(1);
+        }
+        DoNotOptimize(maybe_file->program.GetConnections().size());
+    });
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,29 @@
+#include <bench/bench.hpp>
+
+#include <komaru/translate/common/cond.hpp>
+
+using komaru::bench::DoNotOptimize;
+using komaru::bench::Measure;
+using komaru::translate::common::Cond;
+
+// Synthetic function body: nested ifs whose branches join back, as CalcCppCondForNode sees them
+int main() {
+    constexpr int32_t kDepth = 7;
+    constexpr size_t kIterations = 20;
+
+    Cond cond;
+    Measure("nested ifs with joins, depth 7", kIterations, [&]() {
+        cond = Cond(0);
+        for (int32_t i = 1; i <= kDepth; ++i) {
+            Cond then_cond = cond & Cond(2 * i);
+            Cond else_cond = cond & Cond(2 * i + 1);
+            cond = then_cond | else_cond | cond;
+        }
+        DoNotOptimize(cond);
+    });
+
+    Cond scope = Cond(0) & Cond(2) & Cond(4);
+    Measure("DoesImply for the joined condition", kIterations, [&]() {
+        DoNotOptimize(scope.DoesImply(cond));
+    });
+}
@@ -0,0 +1,67 @@
+#include <bench/bench.hpp>
+
+#include <komaru/lang/cat_program.hpp>
+#include <komaru/lang/morphism.hpp>
+
+using namespace komaru::lang;
+using komaru::bench::DoNotOptimize;
+using komaru::bench::Measure;
+
+namespace {
+
+// What cooking builds for an arrow label, without parsing it
+MorphismPtr MakeArrowMorphism(size_t i) {
+    switch (i % 5) {
+        case 0:
+            return Morphism::Binded(Morphism::Plus(),
+                                    {{1, Morphism::Literal(Literal::Number(static_cast<int>(i)))}});
+        case 1:
+            return Morphism::Binded(
+                Morphism::Binded(Morphism::Less(), {{0, Morphism::Position(0)}}),
+                {{0, Morphism::Literal(Literal::Number(10))}});
+        case 2:
+            return Morphism::Common("print", Type::Int(),
+                                    Type::Parameterized("IO", {Type::Singleton()}));
+        case 3:
+            return Morphism::Tuple({Morphism::Literal(Literal::Char('x')), Morphism::True()});
+        default:
+            return Morphism::Identity();
+    }
+}
+
+}  // namespace
+
+// Synthetic program: a chain of 50k arrows, built and dropped as a cook pass would do it
+int main() {
+    constexpr size_t kArrowsNum = 50'000;
+    constexpr size_t kIterations = 20;
+
+    size_t distinct = 0;
+    Measure("build + drop 50k-arrow program", kIterations, [&]() {
+        CatProgramBuilder builder;
+        auto [start_node, start_pin] = builder.NewNodeWithPin(Type::Singleton(), "main");
+        auto* pin = &start_pin;
+
+        for (size_t i = 0; i < kArrowsNum; ++i) {
+            auto [node, next_pin] = builder.NewNodeWithPin(Type::Auto());
+            builder.Connect(*pin, node, MakeArrowMorphism(i));
+            pin = &next_pin;
+        }
+
+        CatProgram program = builder.Extract();
+        distinct = program.GetMorphisms().Size();
+        DoNotOptimize(program);
+    });
+    std::println("{:<40} {:>10}", "distinct morphisms", distinct);
+
+    std::vector<MorphismPtr> morphisms;
+    morphisms.reserve(kArrowsNum);
+    Measure("copy morphism pointers x 50k", kIterations, [&]() {
+        morphisms.clear();
+        MorphismPtr morphism = MakeArrowMorphism(0);
+        for (size_t i = 0; i < kArrowsNum; ++i) {
+            morphisms.push_back(morphism);
+        }
+        DoNotOptimize(morphisms);
+    });
+}
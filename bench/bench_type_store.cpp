@@ -0,0 +1,108 @@
+#include <bench/bench.hpp>
+
+#include <komaru/lang/type.hpp>
+
+#include <malloc.h>
+
+#include <random>
+#include <unordered_set>
+
+using namespace komaru::lang;
+using komaru::bench::DoNotOptimize;
+using komaru::bench::Measure;
+
+namespace {
+
+Type RandomType(std::mt19937& gen, size_t depth) {
+    static const std::vector<std::string> kNames = {"Int", "Char", "Bool", "a", "b", "Maybe"};
+
+    auto pick = [&gen](size_t n) {
+        return std::uniform_int_distribution<size_t>(0, n - 1)(gen);
+    };
+
+    const std::string& name = kNames[pick(kNames.size())];
+    if (depth == 0) {
+        return name == "Maybe" ? Type::Parameterized(name, {Type::Int()}) : Type::Common(name);
+    }
+
+    switch (pick(5)) {
+        case 0:
+            return Type::Parameterized(name == "Maybe" ? "Either" : "Maybe",
+                                       {RandomType(gen, depth - 1)});
+        case 1: {
+            std::vector<Type> types(2 + pick(4));
+            for (auto& type : types) {
+                type = RandomType(gen, depth - 1);
+            }
+            return Type::Tuple(std::move(types));
+        }
+        case 2:
+            return Type::Function(RandomType(gen, depth - 1), RandomType(gen, depth - 1));
+        case 3:
+            return Type::List(RandomType(gen, depth - 1));
+        default:
+            return RandomType(gen, depth - 1);
+    }
+}
+
+size_t HeapInUse() {
+    return mallinfo2().uordblks;
+}
+
+}  // namespace
+
+// Synthetic program: 100k random types up to 4 levels deep
+int main() {
+    constexpr size_t kTypesNum = 100'000;
+    constexpr size_t kWalks = 10;
+
+    std::vector<Type> types;
+    types.reserve(kTypesNum);
+
+    std::mt19937 gen(42);
+
+    size_t heap_before = HeapInUse();
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < kTypesNum; ++i) {
+        types.push_back(RandomType(gen, 4));
+    }
+
+    auto finish = std::chrono::steady_clock::now();
+    size_t heap_after = HeapInUse();
+
+    size_t distinct = std::unordered_set<Type>(types.begin(), types.end()).size();
+    double create_ns = std::chrono::duration<double, std::nano>(finish - start).count();
+
+    std::println("{:<40} {:>10}", "distinct types", distinct);
+    std::println("{:<40} {:>10.1f} ns/type", "create", create_ns / kTypesNum);
+    std::println("{:<40} {:>10.1f} KiB", "heap growth", (heap_after - heap_before) / 1024.0);
+    std::println("{:<40} {:>10}", "sizeof(Type)", sizeof(Type));
+
+    Measure("IsConcrete x 100k", kWalks, [&]() {
+        for (Type type : types) {
+            DoNotOptimize(type.IsConcrete());
+        }
+    });
+
+    Measure("FlattenFunction x 100k", kWalks, [&]() {
+        for (Type type : types) {
+            DoNotOptimize(type.FlattenFunction());
+        }
+    });
+
+    Measure("ToString x 100k", kWalks, [&]() {
+        for (Type type : types) {
+            DoNotOptimize(type.ToString());
+        }
+    });
+
+    std::string buffer;
+    Measure("AppendTo x 100k", kWalks, [&]() {
+        for (Type type : types) {
+            buffer.clear();
+            type.AppendTo(buffer);
+            DoNotOptimize(buffer);
+        }
+    });
+}
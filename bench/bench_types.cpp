@@ -0,0 +1,47 @@
+#include <bench/bench.hpp>
+
+#include <komaru/lang/type.hpp>
+#include <komaru/lang/morphism.hpp>
+
+using namespace komaru::lang;
+using komaru::bench::DoNotOptimize;
+using komaru::bench::Measure;
+
+int main() {
+    constexpr size_t kIterations = 1'000'000;
+
+    Type plus_t = Morphism::Plus()->GetType();
+    Measure("TryDeduceTypes a->a->a (Int, Int)", kIterations, [&]() {
+        DoNotOptimize(TryDeduceTypes(plus_t, {{0, Type::Int()}, {1, Type::Int()}}));
+    });
+
+    std::pair<size_t, Type> plus_args[] = {{0, Type::Int()}, {1, Type::Int()}};
+    Measure("TryDeduceTypes a->a->a (Int, Int), span", kIterations, [&]() {
+        DoNotOptimize(TryDeduceTypes(plus_t, plus_args));
+    });
+
+    Type a = Type::Var("a");
+    Type b = Type::Var("b");
+    Type fmap_t = Type::FunctionChain({Type::Function(a, b), Type::Parameterized("f", {a}),
+                                       Type::Parameterized("f", {b})});
+    Type show_t = Type::Function(Type::Int(), Type::String());
+    Type maybe_int = Type::Parameterized("Maybe", {Type::Int()});
+    Measure("TryDeduceTypes fmap (Int -> [Char], Maybe Int)", kIterations, [&]() {
+        DoNotOptimize(TryDeduceTypes(fmap_t, {{0, show_t}, {1, maybe_int}}));
+    });
+
+    Type e = Type::Var("e");
+    Type either_ea = Type::Parameterized("Either", {e, a});
+    Type either_eb = Type::Parameterized("Either", {e, b});
+    Type bind_t = Type::FunctionChain({either_ea, Type::Function(a, either_eb), either_eb});
+    Type either_si = Type::Parameterized("Either", {Type::String(), Type::Int()});
+    Type either_sb = Type::Parameterized("Either", {Type::String(), Type::Bool()});
+    Type bind_arg = Type::Function(Type::Int(), either_sb);
+    Measure("TryDeduceTypes >>= (Either [Char] Int, ..)", kIterations, [&]() {
+        DoNotOptimize(TryDeduceTypes(bind_t, {{0, either_si}, {1, bind_arg}}));
+    });
+
+    Measure("TryMatchTypes Either e a ~ Either [Char] Int", kIterations, [&]() {
+        DoNotOptimize(TryMatchTypes(either_ea, either_si));
+    });
+}
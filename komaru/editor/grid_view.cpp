@@ -2,6 +2,7 @@
 
 #include <komaru/editor/node.hpp>
 #include <komaru/editor/connection.hpp>
+#include <komaru/lang/type.hpp>
 #include <komaru/translate/cat_cooking.hpp>
 #include <komaru/translate/haskell/hs_translator.hpp>
 #include <komaru/translate/haskell/hs_symbols_registry.hpp>
@@ -460,6 +461,21 @@ std::vector<translate::hs::HaskellImport> GridView::GetImports() {
     return imports;
 }
 
+translate::IncrementalCooker& GridView::GetCooker(
+    const std::vector<std::string>& packages,
+    const std::vector<translate::hs::HaskellImport>& imports) {
+    if (!cooker_ || packages != cooked_packages_ || imports != cooked_imports_) {
+        cooker_.reset();
+        symbols_registry_ =
+            std::make_unique<translate::hs::HaskellSymbolsRegistry>(packages, imports);
+        cooker_ = std::make_unique<translate::IncrementalCooker>(*symbols_registry_);
+        cooked_packages_ = packages;
+        cooked_imports_ = imports;
+    }
+
+    return *cooker_;
+}
+
 void GridView::OnRunAction() {
     auto raw_program = ConvertNodeGraphToRawCatProgram();
     std::vector<std::string> packages;
@@ -474,8 +490,9 @@ void GridView::OnRunAction() {
     }
 
     try {
-        translate::hs::HaskellSymbolsRegistry symbols_registry(packages, imports);
-        auto maybe_cat_program = translate::Cook(raw_program, symbols_registry);
+        // Types of this run are released once it's over, the cooker pins whatever it keeps
+        lang::TypeUniverse universe;
+        auto maybe_cat_program = GetCooker(packages, imports).Cook(raw_program);
 
         if (!maybe_cat_program) {
             std::println("cooking error: {}", maybe_cat_program.error().Error());
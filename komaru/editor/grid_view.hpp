@@ -2,11 +2,14 @@
 
 #include <komaru/translate/raw_cat_program.hpp>
 #include <komaru/translate/haskell/hs_import.hpp>
+#include <komaru/translate/haskell/hs_symbols_registry.hpp>
+#include <komaru/translate/cat_cooking.hpp>
 
 #include <QGraphicsView>
 #include <QToolBar>
 #include <QJsonDocument>
 
+#include <memory>
 #include <unordered_set>
 
 class QTermWidget;
@@ -52,6 +55,8 @@ private:
 
     std::vector<std::string> GetPackages();
     std::vector<translate::hs::HaskellImport> GetImports();
+    translate::IncrementalCooker& GetCooker(const std::vector<std::string>& packages,
+                                            const std::vector<translate::hs::HaskellImport>& imports);
 
 private slots:
     void OnRunAction();
@@ -78,6 +83,12 @@ private:
     QTermWidget* terminal_;
     QListWidget* packages_list_;
     QListWidget* imports_list_;
+
+    // Kept between runs while packages and imports stay the same
+    std::vector<std::string> cooked_packages_;
+    std::vector<translate::hs::HaskellImport> cooked_imports_;
+    std::unique_ptr<translate::hs::HaskellSymbolsRegistry> symbols_registry_;
+    std::unique_ptr<translate::IncrementalCooker> cooker_;
 };
 
 }  // namespace komaru::editor
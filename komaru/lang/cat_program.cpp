@@ -1,6 +1,8 @@
 #include "cat_program.hpp"
 
+#include <cassert>
 #include <print>
+#include <unordered_map>
 
 #include <komaru/util/std_extensions.hpp>
 
@@ -9,122 +11,280 @@ namespace komaru::lang {
 using CPNode = CatProgram::Node;
 using CPOutPin = CatProgram::OutPin;
 using CPArrow = CatProgram::Arrow;
+using DraftNode = CatProgramBuilder::Node;
+using DraftOutPin = CatProgramBuilder::OutPin;
 
 const CPNode& CPArrow::TargetNode() const {
-    return target_node_;
+    return *target_node_;
 }
 
 const CPOutPin& CPArrow::SourcePin() const {
-    return source_pin_;
+    return *source_pin_;
 }
 
 const MorphismPtr& CPArrow::GetMorphism() const {
     return morphism_;
 }
 
-CPArrow::Arrow(CPOutPin& source_pin, CPNode& target_node, MorphismPtr morphism)
-    : source_pin_(source_pin),
-      target_node_(target_node),
+CPArrow::Arrow(const CPOutPin& source_pin, const CPNode& target_node, MorphismPtr morphism)
+    : source_pin_(&source_pin),
+      target_node_(&target_node),
       morphism_(std::move(morphism)) {
 }
 
 const CPNode& CPOutPin::GetNode() const {
-    return node_;
+    return *node_;
 }
 
 const CPOutPin::Brancher& CPOutPin::GetBrancher() const {
     return brancher_;
 }
 
-const std::deque<CPArrow>& CPOutPin::Arrows() const {
+std::span<const CPArrow> CPOutPin::Arrows() const {
     return arrows_;
 }
 
-void CPOutPin::SetPattern(Pattern pattern) {
-    brancher_ = std::move(pattern);
+CPOutPin::OutPin(const CPNode& node, Brancher brancher)
+    : node_(&node),
+      brancher_(std::move(brancher)) {
 }
 
-void CPOutPin::SetGuard(Guard guard) {
-    brancher_ = std::move(guard);
+Type CPNode::GetType() const {
+    return type_;
 }
 
-CPArrow& CPOutPin::AddArrow(CPNode& target_node, MorphismPtr morphism) {
-    return arrows_.emplace_back(Arrow(*this, target_node, std::move(morphism)));
+std::span<const CPArrow* const> CPNode::IncomingArrows() const {
+    return incoming_arrows_;
 }
 
-CPOutPin::OutPin(Node& node)
-    : node_(node) {
+std::span<const CPOutPin> CPNode::OutPins() const {
+    return out_pins_;
 }
 
-Type CPNode::GetType() const {
-    return type_;
+const std::string& CPNode::GetName() const {
+    return name_;
 }
 
-const std::vector<CPArrow*>& CPNode::IncomingArrows() const {
-    return incoming_arrows_;
+CPNode::Node(Type type, std::string name)
+    : type_(type),
+      name_(std::move(name)) {
 }
 
-const std::deque<CPOutPin>& CPNode::OutPins() const {
-    return out_pins_;
+std::span<const CPNode> CatProgram::GetNodes() const {
+    return nodes_;
 }
 
-const std::string& CPNode::GetName() const {
+size_t CatProgram::GetNodeIndex(const CPNode& node) const {
+    assert(&node >= nodes_.data() && &node < nodes_.data() + nodes_.size());
+    return static_cast<size_t>(&node - nodes_.data());
+}
+
+const MorphismInterner& CatProgram::GetMorphisms() const {
+    return morphisms_;
+}
+
+size_t CatProgram::GetPinIndex(const CPOutPin& pin) const {
+    assert(&pin >= pins_.data() && &pin < pins_.data() + pins_.size());
+    return static_cast<size_t>(&pin - pins_.data());
+}
+
+Type DraftNode::GetType() const {
+    return type_;
+}
+
+const std::string& DraftNode::GetName() const {
     return name_;
 }
 
-std::deque<CPOutPin>& CPNode::OutPins() {
+const std::deque<DraftOutPin>& DraftNode::OutPins() const {
     return out_pins_;
 }
 
-CPOutPin& CPNode::AddOutPin() {
-    return out_pins_.emplace_back(CPOutPin(*this));
+std::deque<DraftOutPin>& DraftNode::OutPins() {
+    return out_pins_;
+}
+
+DraftOutPin& DraftNode::AddOutPin() {
+    return out_pins_.emplace_back(DraftOutPin(*this, out_pins_.size()));
 }
 
-CPOutPin& CPNode::AddOutPin(Pattern pattern) {
-    auto& out_pin = out_pins_.emplace_back(CPOutPin(*this));
+DraftOutPin& DraftNode::AddOutPin(Pattern pattern) {
+    auto& out_pin = AddOutPin();
     out_pin.SetPattern(std::move(pattern));
     return out_pin;
 }
 
-CPOutPin& CPNode::AddOutPin(Guard guard) {
-    auto& out_pin = out_pins_.emplace_back(CPOutPin(*this));
+DraftOutPin& DraftNode::AddOutPin(Guard guard) {
+    auto& out_pin = AddOutPin();
     out_pin.SetGuard(std::move(guard));
     return out_pin;
 }
 
-CPNode& CPNode::SetName(std::string name) {
+DraftNode& DraftNode::SetName(std::string name) {
     name_ = std::move(name);
     return *this;
 }
 
-CPNode::Node(Type type, std::string name)
-    : type_(type),
+DraftNode::Node(size_t idx, Type type, std::string name)
+    : idx_(idx),
+      type_(type),
       name_(std::move(name)) {
 }
 
-const std::deque<CPNode>& CatProgram::GetNodes() const {
-    return nodes_;
+const DraftNode& DraftOutPin::GetNode() const {
+    return node_;
+}
+
+const DraftOutPin::Brancher& DraftOutPin::GetBrancher() const {
+    return brancher_;
+}
+
+void DraftOutPin::SetPattern(Pattern pattern) {
+    brancher_ = std::move(pattern);
+}
+
+void DraftOutPin::SetGuard(Guard guard) {
+    brancher_ = std::move(guard);
+}
+
+DraftOutPin::OutPin(Node& node, size_t idx)
+    : node_(node),
+      idx_(idx) {
 }
 
-CPNode& CatProgramBuilder::NewNode(Type type, std::string name) {
-    return program_.nodes_.emplace_back(CPNode(type, std::move(name)));
+DraftNode& CatProgramBuilder::NewNode(Type type, std::string name) {
+    return nodes_.emplace_back(DraftNode(nodes_.size(), type, std::move(name)));
 }
 
-std::pair<CPNode&, CPOutPin&> CatProgramBuilder::NewNodeWithPin(Type type, std::string name) {
+std::pair<DraftNode&, DraftOutPin&> CatProgramBuilder::NewNodeWithPin(Type type,
+                                                                     std::string name) {
     auto& node = NewNode(type, std::move(name));
     auto& pin = node.AddOutPin();
     return std::tie(node, pin);
 }
 
-CatProgramBuilder& CatProgramBuilder::Connect(CPOutPin& out_pin, CPNode& node,
+CatProgramBuilder& CatProgramBuilder::Connect(DraftOutPin& out_pin, DraftNode& node,
                                               MorphismPtr morphism) {
-    auto& arrow = out_pin.AddArrow(node, std::move(morphism));
-    node.incoming_arrows_.push_back(&arrow);
+    arrows_.push_back(DraftArrow{.source_pin = &out_pin,
+                                 .target_node = &node,
+                                 .morphism = morphisms_.Intern(morphism)});
     return *this;
 }
 
+CatProgramBuilder& CatProgramBuilder::Append(const CatProgram& program) {
+    std::vector<DraftNode*> node2copy;
+    std::vector<DraftOutPin*> pin2copy;
+    node2copy.reserve(program.nodes_.size());
+    pin2copy.reserve(program.pins_.size());
+
+    for (const auto& node : program.GetNodes()) {
+        auto& copy = NewNode(node.GetType(), node.GetName());
+        node2copy.push_back(&copy);
+
+        for (const auto& out_pin : node.OutPins()) {
+            auto& pin_copy = copy.AddOutPin();
+            pin_copy.brancher_ = out_pin.GetBrancher();
+            pin2copy.push_back(&pin_copy);
+        }
+    }
+
+    // Arrows were added target by target, so this keeps their order on both ends
+    for (const auto& node : program.GetNodes()) {
+        for (const CPArrow* arrow : node.IncomingArrows()) {
+            Connect(*pin2copy[program.GetPinIndex(arrow->SourcePin())],
+                    *node2copy[program.GetNodeIndex(node)], arrow->GetMorphism());
+        }
+    }
+
+    return *this;
+}
+
+// Pins and arrows are counting-sorted into place, arrows keep the order they were added in
+// both among the arrows of a pin and among the incoming arrows of a node
 CatProgram CatProgramBuilder::Extract() {
-    return std::move(program_);
+    CatProgram program;
+    program.morphisms_ = std::move(morphisms_);
+
+    // Offsets of every node's pins in the pins array
+    std::vector<size_t> pin_offsets(nodes_.size() + 1, 0);
+    for (const auto& node : nodes_) {
+        pin_offsets[node.idx_ + 1] = pin_offsets[node.idx_] + node.out_pins_.size();
+    }
+
+    auto pin_index = [&](const DraftOutPin& pin) {
+        return pin_offsets[pin.node_.idx_] + pin.idx_;
+    };
+
+    std::vector<size_t> arrow_offsets(pin_offsets.back() + 1, 0);
+    std::vector<size_t> incoming_offsets(nodes_.size() + 1, 0);
+    for (const auto& arrow : arrows_) {
+        ++arrow_offsets[pin_index(*arrow.source_pin) + 1];
+        ++incoming_offsets[arrow.target_node->idx_ + 1];
+    }
+    for (size_t i = 1; i < arrow_offsets.size(); ++i) {
+        arrow_offsets[i] += arrow_offsets[i - 1];
+    }
+    for (size_t i = 1; i < incoming_offsets.size(); ++i) {
+        incoming_offsets[i] += incoming_offsets[i - 1];
+    }
+
+    // Arrays are sized up front, nothing is reallocated after pointers into them are taken
+    program.nodes_.reserve(nodes_.size());
+    program.pins_.reserve(pin_offsets.back());
+
+    for (auto& node : nodes_) {
+        auto& frozen_node = program.nodes_.emplace_back(
+            CPNode(node.type_, std::move(node.name_)));
+
+        for (auto& pin : node.out_pins_) {
+            program.pins_.emplace_back(CPOutPin(frozen_node, std::move(pin.brancher_)));
+        }
+    }
+
+    // Frozen position of every draft arrow
+    std::vector<size_t> arrow_idxs(arrows_.size());
+    std::vector<size_t> draft_idxs(arrows_.size());
+    std::vector<size_t> arrow_pos(arrow_offsets.begin(), arrow_offsets.end() - 1);
+
+    for (auto [i, arrow] : util::Enumerate(arrows_)) {
+        arrow_idxs[i] = arrow_pos[pin_index(*arrow.source_pin)]++;
+        draft_idxs[arrow_idxs[i]] = i;
+    }
+
+    program.arrows_.reserve(arrows_.size());
+    for (size_t draft_idx : draft_idxs) {
+        auto& arrow = arrows_[draft_idx];
+        program.arrows_.push_back(CPArrow(program.pins_[pin_index(*arrow.source_pin)],
+                                          program.nodes_[arrow.target_node->idx_],
+                                          std::move(arrow.morphism)));
+    }
+
+    std::vector<size_t> incoming_pos(incoming_offsets.begin(), incoming_offsets.end() - 1);
+    program.incoming_arrows_.resize(arrows_.size());
+
+    for (auto [i, arrow] : util::Enumerate(arrows_)) {
+        program.incoming_arrows_[incoming_pos[arrow.target_node->idx_]++] =
+            &program.arrows_[arrow_idxs[i]];
+    }
+
+    for (auto [i, pin] : util::Enumerate(program.pins_)) {
+        pin.arrows_ = std::span<const CPArrow>(program.arrows_)
+                          .subspan(arrow_offsets[i], arrow_offsets[i + 1] - arrow_offsets[i]);
+    }
+
+    for (auto [i, node] : util::Enumerate(program.nodes_)) {
+        node.out_pins_ = std::span<const CPOutPin>(program.pins_)
+                             .subspan(pin_offsets[i], pin_offsets[i + 1] - pin_offsets[i]);
+        node.incoming_arrows_ =
+            std::span<const CPArrow* const>(program.incoming_arrows_)
+                .subspan(incoming_offsets[i], incoming_offsets[i + 1] - incoming_offsets[i]);
+    }
+
+    nodes_.clear();
+    arrows_.clear();
+    morphisms_ = MorphismInterner();
+
+    return program;
 }
 
 void DebugCatProgram(const CatProgram& program) {
@@ -1,10 +1,15 @@
 #pragma once
 #include <komaru/lang/type.hpp>
 #include <komaru/lang/morphism.hpp>
+#include <komaru/lang/morphism_interner.hpp>
 #include <komaru/lang/pattern.hpp>
 #include <komaru/lang/guard.hpp>
 #include <komaru/util/non_copyable.hpp>
 
+#include <deque>
+#include <span>
+#include <vector>
+
 namespace komaru::lang {
 
 class CatProgramBuilder;
@@ -22,7 +27,7 @@ class CatProgramBuilder;
 // In this case arrows contain special $i morphisms where i is a an unsigned integer
 // and they form a tuple type in the target node by placing values on their repsective
 // positions determined by $i syntax.
-class CatProgram {
+class CatProgram : public util::NonCopyable {
     friend class komaru::lang::CatProgramBuilder;
 
 public:
@@ -30,10 +35,12 @@ public:
     class OutPin;
     class Arrow;
 
-    // TODO: destroy unneccessary friendships
-    class Arrow : public util::NonCopyable {
-        friend class CatProgram;
-        friend class OutPin;
+    // A built program is frozen: nodes, pins and arrows each live in one array. Arrows are
+    // grouped by source pin and pins by node, and incoming arrows are grouped by target node
+    // in a separate array, so adjacency lists are contiguous ranges of these arrays.
+    // Moving a program keeps the arrays, so references into it stay valid.
+
+    class Arrow {
         friend class komaru::lang::CatProgramBuilder;
 
     public:
@@ -42,17 +49,16 @@ public:
         const MorphismPtr& GetMorphism() const;
 
     private:
-        Arrow(OutPin& source_pin, Node& target_node, MorphismPtr morphism);
+        Arrow(const OutPin& source_pin, const Node& target_node, MorphismPtr morphism);
 
     private:
-        OutPin& source_pin_;
-        Node& target_node_;
+        const OutPin* source_pin_;
+        const Node* target_node_;
         MorphismPtr morphism_;
     };
 
-    class OutPin : public util::NonCopyable {
-        friend class CatProgram;
-        friend class ::komaru::lang::CatProgramBuilder;
+    class OutPin {
+        friend class komaru::lang::CatProgramBuilder;
 
     public:
         using Brancher = std::variant<Pattern, Guard>;
@@ -60,31 +66,71 @@ public:
     public:
         const Node& GetNode() const;
         const Brancher& GetBrancher() const;
-        const std::deque<Arrow>& Arrows() const;
+        std::span<const Arrow> Arrows() const;
 
-        void SetPattern(Pattern pattern);
-        void SetGuard(Guard guard);
+    private:
+        OutPin(const Node& node, Brancher brancher);
 
     private:
-        explicit OutPin(Node& node);
+        const Node* node_;
+        Brancher brancher_;
+        std::span<const Arrow> arrows_;
+    };
 
-        Arrow& AddArrow(Node& target_node, MorphismPtr morphism);
+    class Node {
+        friend class komaru::lang::CatProgramBuilder;
+
+    public:
+        Type GetType() const;
+        std::span<const Arrow* const> IncomingArrows() const;
+        std::span<const OutPin> OutPins() const;
+        const std::string& GetName() const;
 
     private:
-        Node& node_;  // associated node
-        Brancher brancher_{Pattern::Any()};
-        std::deque<Arrow> arrows_;
+        Node(Type type, std::string name);
+
+    private:
+        Type type_;
+        std::string name_;
+        std::span<const Arrow* const> incoming_arrows_;
+        std::span<const OutPin> out_pins_;
     };
 
+public:
+    CatProgram(CatProgram&&) = default;
+    CatProgram& operator=(CatProgram&&) = default;
+
+    std::span<const Node> GetNodes() const;
+    // Position of the node in GetNodes(), e.g. for per-node arrays instead of maps
+    size_t GetNodeIndex(const Node& node) const;
+    // Arrows with equal morphisms share one node, the interner gives its id
+    const MorphismInterner& GetMorphisms() const;
+
+private:
+    CatProgram() = default;
+
+    size_t GetPinIndex(const OutPin& pin) const;
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<OutPin> pins_;
+    std::vector<Arrow> arrows_;
+    std::vector<const Arrow*> incoming_arrows_;
+    MorphismInterner morphisms_;
+};
+
+// Programs are built from mutable draft nodes and pins, Extract freezes them into a CatProgram
+class CatProgramBuilder {
+public:
+    class OutPin;
+
     class Node : public util::NonCopyable {
-        friend class CatProgram;
         friend class komaru::lang::CatProgramBuilder;
 
     public:
         Type GetType() const;
-        const std::vector<Arrow*>& IncomingArrows() const;
-        const std::deque<OutPin>& OutPins() const;
         const std::string& GetName() const;
+        const std::deque<OutPin>& OutPins() const;
 
         std::deque<OutPin>& OutPins();
         OutPin& AddOutPin();
@@ -93,27 +139,36 @@ public:
         Node& SetName(std::string name);
 
     private:
-        explicit Node(Type type, std::string name = "");
+        Node(size_t idx, Type type, std::string name);
 
     private:
+        size_t idx_;
         Type type_;
         std::string name_;
-        std::vector<Arrow*> incoming_arrows_;
         std::deque<OutPin> out_pins_;
     };
 
-public:
-    const std::deque<Node>& GetNodes() const;
+    class OutPin : public util::NonCopyable {
+        friend class komaru::lang::CatProgramBuilder;
 
-private:
-    CatProgram() = default;
-    // preserves node addresses
-    std::deque<Node> nodes_;
-};
+    public:
+        using Brancher = CatProgram::OutPin::Brancher;
 
-class CatProgramBuilder {
-    using Node = CatProgram::Node;
-    using OutPin = CatProgram::OutPin;
+    public:
+        const Node& GetNode() const;
+        const Brancher& GetBrancher() const;
+
+        void SetPattern(Pattern pattern);
+        void SetGuard(Guard guard);
+
+    private:
+        OutPin(Node& node, size_t idx);
+
+    private:
+        Node& node_;  // associated node
+        size_t idx_;  // among the node's pins
+        Brancher brancher_{Pattern::Any()};
+    };
 
 public:
     CatProgramBuilder() = default;
@@ -121,11 +176,23 @@ public:
     Node& NewNode(Type type, std::string name = "");
     std::pair<Node&, OutPin&> NewNodeWithPin(Type type, std::string name = "");
     CatProgramBuilder& Connect(OutPin& out_pin, Node& node, MorphismPtr morphism);
+    // Copies every node of `program` with its pins and arrows, morphisms are shared
+    CatProgramBuilder& Append(const CatProgram& program);
 
+    // Freezes what was built so far, the builder is left empty
     CatProgram Extract();
 
 private:
-    CatProgram program_;
+    struct DraftArrow {
+        const OutPin* source_pin;
+        const Node* target_node;
+        MorphismPtr morphism;
+    };
+
+    // preserves node addresses
+    std::deque<Node> nodes_;
+    std::vector<DraftArrow> arrows_;
+    MorphismInterner morphisms_;
 };
 
 void DebugCatProgram(const CatProgram& program);
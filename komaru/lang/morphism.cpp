@@ -8,14 +8,14 @@
 
 namespace komaru::lang {
 
-CommonMorphism::CommonMorphism(std::string name, Type source, Type target)
-    : name_(std::move(name)),
+CommonMorphism::CommonMorphism(Symbol name, Type source, Type target)
+    : name_(name),
       source_(source),
       target_(target) {
 }
 
 std::string CommonMorphism::ToString() const {
-    return name_;
+    return name_.GetName();
 }
 
 Type CommonMorphism::GetSource() const {
@@ -39,14 +39,18 @@ bool CommonMorphism::IsValue() const {
 }
 
 bool CommonMorphism::ShouldBeShielded() const {
-    return IsOperatorName(name_) || GetParamNum() > 0;
+    return IsOperatorName(name_.GetName()) || GetParamNum() > 0;
 }
 
 bool CommonMorphism::IsOperator() const {
-    return IsOperatorName(name_);
+    return IsOperatorName(name_.GetName());
 }
 
 const std::string& CommonMorphism::GetName() const {
+    return name_.GetName();
+}
+
+Symbol CommonMorphism::GetSymbol() const {
     return name_;
 }
 
@@ -97,7 +101,7 @@ bool PositionMorphism::IsNonePosition() const {
     return pos_ == std::numeric_limits<size_t>::max();
 }
 
-BindedMorphism::BindedMorphism(MorphismPtr morphism, std::map<size_t, MorphismPtr> mapping)
+BindedMorphism::BindedMorphism(MorphismPtr morphism, BindingMap mapping)
     : morphism_(std::move(morphism)),
       mapping_(std::move(mapping)),
       source_(Type::Auto()),
@@ -106,23 +110,25 @@ BindedMorphism::BindedMorphism(MorphismPtr morphism, std::map<size_t, MorphismPt
     std::vector<Type> new_types;
 
     // Cleanup extra mappings
-    auto it = mapping_.lower_bound(param_num);
-    while (it != mapping_.end()) {
-        it = mapping_.erase(it);
+    while (!mapping_.empty() && std::prev(mapping_.end())->first >= param_num) {
+        mapping_.erase(std::prev(mapping_.end()));
     }
 
     assert(!mapping_.empty());
 
-    std::map<size_t, Type> type_mapping;
+    util::SmallVector<std::pair<size_t, Type>, 3> arg_types;
     for (const auto& [pos, morphism] : mapping_) {
-        type_mapping[pos] = morphism->GetType().Pure();
+        arg_types.emplace_back(pos, morphism->GetType().Pure());
     }
 
-    Type deduced_type = DeduceTypes(morphism_->GetType(), type_mapping);
+    Type deduced_type = DeduceTypes(morphism_->GetType(), arg_types);
     auto types = deduced_type.FlattenFunction();
 
+    auto bound = mapping_.begin();
     for (size_t i = 0; i + 1 < types.size(); ++i) {
-        if (!mapping_.contains(i)) {
+        if (bound != mapping_.end() && bound->first == i) {
+            ++bound;
+        } else {
             new_types.push_back(types[i]);
         }
     }
@@ -157,7 +163,7 @@ std::string BindedMorphism::ToString() const {
         return ToStringShielded(*morphism_);
     });
 
-    size_t last_idx = mapping_.rbegin()->first;
+    size_t last_idx = std::prev(mapping_.end())->first;
 
     for (size_t i = 0; i <= last_idx; ++i) {
         res += " ";
@@ -205,7 +211,7 @@ const MorphismPtr& BindedMorphism::GetUnderlyingMorphism() const {
     return morphism_;
 }
 
-const std::map<size_t, MorphismPtr>& BindedMorphism::GetMapping() const {
+const BindingMap& BindedMorphism::GetMapping() const {
     return mapping_;
 }
 
@@ -240,10 +246,12 @@ std::string BindedMorphism::ToStringAsOperator() const {
 
 void BindedMorphism::Flatten() {
     assert(morphism_->Holds<BindedMorphism>());
-    auto& inner = morphism_->GetVariant<BindedMorphism>();
+    // Keep the inner node alive: morphism_ may be its only owner
+    MorphismPtr inner_morphism = std::move(morphism_);
+    const auto& inner = inner_morphism->GetVariant<BindedMorphism>();
     morphism_ = inner.morphism_;
 
-    std::map<size_t, MorphismPtr> new_mapping = inner.mapping_;
+    BindingMap new_mapping = inner.mapping_;
 
     size_t old_idx = 0;
 
@@ -255,9 +263,9 @@ void BindedMorphism::Flatten() {
         if (old_idx > 0) {
             auto it = mapping_.find(old_idx - 1);
             if (it != mapping_.end()) {
-                new_mapping.emplace(i, it->second);
+                new_mapping.emplace(i, std::move(it->second));
+                mapping_.erase(it);
             }
-            mapping_.erase(it);
         }
     }
 
@@ -358,6 +366,10 @@ bool TupleMorphism::IsOperator() const {
     return false;
 }
 
+const std::vector<MorphismPtr>& TupleMorphism::GetMorphisms() const {
+    return morphisms_;
+}
+
 ListMorphism::ListMorphism(std::vector<MorphismPtr> morphisms)
     : morphisms_(std::move(morphisms)) {
     if (morphisms_.empty()) {
@@ -416,9 +428,12 @@ bool ListMorphism::IsOperator() const {
     return false;
 }
 
+const std::vector<MorphismPtr>& ListMorphism::GetMorphisms() const {
+    return morphisms_;
+}
+
 MorphismPtr Morphism::Common(std::string name, Type source, Type target) {
-    return std::make_shared<Morphism>(PrivateDummy{},
-                                      CommonMorphism(std::move(name), source, target));
+    return Make(CommonMorphism(std::move(name), source, target));
 }
 
 MorphismPtr Morphism::CommonWithType(std::string name, Type type) {
@@ -440,28 +455,27 @@ MorphismPtr Morphism::ChainFunction(std::string name, const std::vector<Type>& t
 }
 
 MorphismPtr Morphism::Position(size_t pos) {
-    return std::make_shared<Morphism>(PrivateDummy{}, PositionMorphism(pos));
+    return Make(PositionMorphism(pos));
 }
 
 MorphismPtr Morphism::NonePosition() {
     return Position(std::numeric_limits<size_t>::max());
 }
 
-MorphismPtr Morphism::Binded(MorphismPtr morphism, std::map<size_t, MorphismPtr> mapping) {
-    return std::make_shared<Morphism>(PrivateDummy{},
-                                      BindedMorphism(std::move(morphism), std::move(mapping)));
+MorphismPtr Morphism::Binded(MorphismPtr morphism, BindingMap mapping) {
+    return Make(BindedMorphism(std::move(morphism), std::move(mapping)));
 }
 
 MorphismPtr Morphism::Literal(class Literal literal) {
-    return std::make_shared<Morphism>(PrivateDummy{}, LiteralMorphism(std::move(literal)));
+    return Make(LiteralMorphism(std::move(literal)));
 }
 
 MorphismPtr Morphism::Tuple(std::vector<MorphismPtr> morphisms) {
-    return std::make_shared<Morphism>(PrivateDummy{}, TupleMorphism(std::move(morphisms)));
+    return Make(TupleMorphism(std::move(morphisms)));
 }
 
 MorphismPtr Morphism::List(std::vector<MorphismPtr> morphisms) {
-    return std::make_shared<Morphism>(PrivateDummy{}, ListMorphism(std::move(morphisms)));
+    return Make(ListMorphism(std::move(morphisms)));
 }
 
 MorphismPtr Morphism::Plus() {
@@ -587,4 +601,28 @@ std::string ToStringShielded(const Morphism& morphism) {
     return morphism.ToString();
 }
 
+void PinTypes(const Morphism& morphism, PinnedTypes& pins) {
+    pins.Add(morphism.GetSource());
+    pins.Add(morphism.GetTarget());
+
+    morphism.Visit(util::Overloaded{[&pins](const BindedMorphism& m) {
+                                        PinTypes(*m.GetUnderlyingMorphism(), pins);
+                                        for (const auto& [_, arg] : m.GetMapping()) {
+                                            PinTypes(*arg, pins);
+                                        }
+                                    },
+                                    [&pins](const TupleMorphism& m) {
+                                        for (const auto& child : m.GetMorphisms()) {
+                                            PinTypes(*child, pins);
+                                        }
+                                    },
+                                    [&pins](const ListMorphism& m) {
+                                        for (const auto& child : m.GetMorphisms()) {
+                                            PinTypes(*child, pins);
+                                        }
+                                    },
+                                    [](const auto&) {
+                                    }});
+}
+
 }  // namespace komaru::lang
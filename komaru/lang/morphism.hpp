@@ -2,13 +2,20 @@
 #include <komaru/lang/type.hpp>
 #include <komaru/lang/literal.hpp>
 #include <komaru/util/derive_variant.hpp>
+#include <komaru/util/flat_map.hpp>
+#include <komaru/util/intrusive_ptr.hpp>
+#include <komaru/util/object_pool.hpp>
 
-#include <map>
+#include <cassert>
 
 namespace komaru::lang {
 
 class Morphism;
-using MorphismPtr = std::shared_ptr<Morphism>;
+// Morphisms are built and dropped by the thousand on every cook pass, so they come from
+// a pool and carry their own reference counter
+using MorphismPtr = util::IntrusivePtr<Morphism>;
+// Bound position -> argument. There are rarely more than a few, so they are kept inline
+using BindingMap = util::FlatMap<size_t, MorphismPtr, 3>;
 
 class CommonMorphism;
 class PositionMorphism;
@@ -31,7 +38,7 @@ concept MorphismLike = requires(const T t) {
 
 class CommonMorphism {
 public:
-    CommonMorphism(std::string name, Type source, Type target);
+    CommonMorphism(Symbol name, Type source, Type target);
 
     std::string ToString() const;
     Type GetSource() const;
@@ -42,9 +49,10 @@ public:
     bool ShouldBeShielded() const;
     bool IsOperator() const;
     const std::string& GetName() const;
+    Symbol GetSymbol() const;
 
 private:
-    std::string name_;
+    Symbol name_;
     Type source_;
     Type target_;
 };
@@ -70,7 +78,7 @@ private:
 
 class BindedMorphism {
 public:
-    BindedMorphism(MorphismPtr morphism, std::map<size_t, MorphismPtr> mapping);
+    BindedMorphism(MorphismPtr morphism, BindingMap mapping);
 
     std::string ToString() const;
     Type GetSource() const;
@@ -81,7 +89,7 @@ public:
     bool ShouldBeShielded() const;
     bool IsOperator() const;
     const MorphismPtr& GetUnderlyingMorphism() const;
-    const std::map<size_t, MorphismPtr>& GetMapping() const;
+    const BindingMap& GetMapping() const;
 
 private:
     std::string ToStringAsOperator() const;
@@ -89,7 +97,7 @@ private:
 
 private:
     MorphismPtr morphism_;
-    std::map<size_t, MorphismPtr> mapping_;
+    BindingMap mapping_;
     Type source_;
     Type target_;
 };
@@ -126,6 +134,7 @@ public:
     bool IsValue() const;
     bool ShouldBeShielded() const;
     bool IsOperator() const;
+    const std::vector<MorphismPtr>& GetMorphisms() const;
 
 private:
     std::vector<MorphismPtr> morphisms_;
@@ -145,22 +154,26 @@ public:
     bool IsValue() const;
     bool ShouldBeShielded() const;
     bool IsOperator() const;
+    const std::vector<MorphismPtr>& GetMorphisms() const;
 
 private:
     std::vector<MorphismPtr> morphisms_;
     Type target_type_;
 };
 
-class Morphism : public util::DeriveVariant<Morphism> {
+class Morphism : public util::DeriveVariant<Morphism>,
+                 public util::RefCounted {
     using Variant = std::variant<CommonMorphism, PositionMorphism, BindedMorphism, LiteralMorphism,
                                  TupleMorphism, ListMorphism>;
 
-    struct PrivateDummy {};
-
 public:
-    template <typename T>
-    Morphism(PrivateDummy, T morphism)
-        : morphism_(std::move(morphism)) {
+    static void* operator new(size_t size) {
+        assert(size == sizeof(Morphism));
+        return util::ObjectPool<Morphism>::Allocate();
+    }
+
+    static void operator delete(void* ptr) {
+        util::ObjectPool<Morphism>::Deallocate(ptr);
     }
 
     static MorphismPtr Common(std::string name, Type source, Type target);
@@ -169,7 +182,7 @@ public:
     static MorphismPtr ChainFunction(std::string name, const std::vector<Type>& types);
     static MorphismPtr Position(size_t pos);
     static MorphismPtr NonePosition();
-    static MorphismPtr Binded(MorphismPtr morphism, std::map<size_t, MorphismPtr> mapping);
+    static MorphismPtr Binded(MorphismPtr morphism, BindingMap mapping);
     static MorphismPtr Literal(Literal literal);
     static MorphismPtr Tuple(std::vector<MorphismPtr> morphisms);
     static MorphismPtr List(std::vector<MorphismPtr> morphisms);
@@ -200,6 +213,16 @@ public:
     const Variant* GetVariantPointer() const;
 
 private:
+    template <typename T>
+    explicit Morphism(T morphism)
+        : morphism_(std::move(morphism)) {
+    }
+
+    template <typename T>
+    static MorphismPtr Make(T morphism) {
+        return MorphismPtr(new Morphism(std::move(morphism)));
+    }
+
     static bool ValidateCompound(const std::vector<MorphismPtr>& morphisms);
 
 private:
@@ -218,5 +241,7 @@ bool IsOperatorName(const std::string& name);
 bool IsFunctionName(const std::string& name);
 bool IsConstructorName(const std::string& name);
 std::string ToStringShielded(const Morphism& morphism);
+// Pins the types of the morphism and of the morphisms it's made of
+void PinTypes(const Morphism& morphism, PinnedTypes& pins);
 
 }  // namespace komaru::lang
@@ -0,0 +1,184 @@
+#include "morphism_interner.hpp"
+
+#include <cassert>
+#include <functional>
+#include <ranges>
+
+#include <komaru/util/hash.hpp>
+#include <komaru/util/small_vector.hpp>
+#include <komaru/util/std_extensions.hpp>
+
+namespace komaru::lang {
+
+namespace {
+
+using Children = util::SmallVector<MorphismPtr, 4>;
+using LiteralValue = std::remove_cvref_t<decltype(*std::declval<Literal>().GetVariantPointer())>;
+
+template <typename F>
+void ForEachChild(const Morphism& morphism, F&& func) {
+    morphism.Visit(util::Overloaded{[&](const BindedMorphism& m) {
+                                        func(m.GetUnderlyingMorphism());
+                                        for (const auto& [_, arg] : m.GetMapping()) {
+                                            func(arg);
+                                        }
+                                    },
+                                    [&](const TupleMorphism& m) {
+                                        for (const auto& child : m.GetMorphisms()) {
+                                            func(child);
+                                        }
+                                    },
+                                    [&](const ListMorphism& m) {
+                                        for (const auto& child : m.GetMorphisms()) {
+                                            func(child);
+                                        }
+                                    },
+                                    [](const auto&) {
+                                    }});
+}
+
+// Hash of the morphism's own fields, children are mixed in by the caller
+size_t HashFields(const Morphism& morphism) {
+    size_t seed = morphism.GetVariantPointer()->index();
+
+    return morphism.Visit(util::Overloaded{
+        [&](const CommonMorphism& m) {
+            seed = util::HashCombine(seed, std::hash<Symbol>{}(m.GetSymbol()));
+            seed = util::HashCombine(seed, std::hash<Type>{}(m.GetSource()));
+            return util::HashCombine(seed, std::hash<Type>{}(m.GetTarget()));
+        },
+        [&](const PositionMorphism& m) {
+            return util::HashCombine(seed, m.GetPosition());
+        },
+        [&](const BindedMorphism& m) {
+            for (size_t pos : m.GetMapping() | std::views::keys) {
+                seed = util::HashCombine(seed, pos);
+            }
+            return seed;
+        },
+        [&](const LiteralMorphism& m) {
+            return util::HashCombine(seed, std::hash<LiteralValue>{}(
+                                               *m.GetLiteral().GetVariantPointer()));
+        },
+        [&](const auto&) {
+            return seed;
+        }});
+}
+
+bool SameFields(const Morphism& a, const Morphism& b) {
+    if (a.GetVariantPointer()->index() != b.GetVariantPointer()->index()) {
+        return false;
+    }
+
+    return a.Visit(util::Overloaded{
+        [&](const CommonMorphism& m) {
+            const auto& o = b.GetVariant<CommonMorphism>();
+            return m.GetSymbol() == o.GetSymbol() && m.GetSource() == o.GetSource() &&
+                   m.GetTarget() == o.GetTarget();
+        },
+        [&](const PositionMorphism& m) {
+            return m.GetPosition() == b.GetVariant<PositionMorphism>().GetPosition();
+        },
+        [&](const BindedMorphism& m) {
+            return std::ranges::equal(m.GetMapping() | std::views::keys,
+                                      b.GetVariant<BindedMorphism>().GetMapping() |
+                                          std::views::keys);
+        },
+        [&](const LiteralMorphism& m) {
+            return *m.GetLiteral().GetVariantPointer() ==
+                   *b.GetVariant<LiteralMorphism>().GetLiteral().GetVariantPointer();
+        },
+        [](const auto&) {
+            // Tuples and lists are defined by their children only
+            return true;
+        }});
+}
+
+// Same morphism built over the interned children
+MorphismPtr Rebuild(const MorphismPtr& morphism, const Children& children) {
+    return morphism->Visit(util::Overloaded{
+        [&](const BindedMorphism& m) {
+            BindingMap mapping;
+            size_t i = 1;
+            for (size_t pos : m.GetMapping() | std::views::keys) {
+                mapping.emplace(pos, children[i++]);
+            }
+            return Morphism::Binded(children[0], std::move(mapping));
+        },
+        [&](const TupleMorphism&) {
+            return Morphism::Tuple({children.begin(), children.end()});
+        },
+        [&](const ListMorphism&) {
+            return Morphism::List({children.begin(), children.end()});
+        },
+        [&](const auto&) {
+            return morphism;
+        }});
+}
+
+}  // namespace
+
+MorphismPtr MorphismInterner::Intern(const MorphismPtr& morphism) {
+    if (ids_.contains(morphism.get())) {
+        return morphism;
+    }
+
+    // Children go first, so below they can be compared by address
+    Children children;
+    bool children_changed = false;
+    size_t hash = HashFields(*morphism);
+
+    ForEachChild(*morphism, [&](const MorphismPtr& child) {
+        MorphismPtr interned = Intern(child);
+        children_changed |= interned != child;
+        hash = util::HashCombine(hash, ids_.at(interned.get()));
+        children.push_back(std::move(interned));
+    });
+
+    auto [begin, end] = ids_by_hash_.equal_range(hash);
+    for (const auto& [_, id] : std::ranges::subrange(begin, end)) {
+        const MorphismPtr& candidate = morphisms_[id];
+        if (!SameFields(*candidate, *morphism)) {
+            continue;
+        }
+
+        size_t i = 0;
+        bool same_children = true;
+        ForEachChild(*candidate, [&](const MorphismPtr& child) {
+            same_children &= i < children.size() && child == children[i];
+            ++i;
+        });
+
+        if (same_children && i == children.size()) {
+            return candidate;
+        }
+    }
+
+    MorphismPtr canonical = children_changed ? Rebuild(morphism, children) : morphism;
+    auto id = static_cast<uint32_t>(morphisms_.size());
+
+    morphisms_.push_back(canonical);
+    ids_.emplace(canonical.get(), id);
+    ids_by_hash_.emplace(hash, id);
+
+    return canonical;
+}
+
+std::optional<uint32_t> MorphismInterner::FindID(const Morphism& morphism) const {
+    auto it = ids_.find(&morphism);
+    if (it == ids_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+const MorphismPtr& MorphismInterner::GetMorphism(uint32_t id) const {
+    assert(id < morphisms_.size());
+    return morphisms_[id];
+}
+
+size_t MorphismInterner::Size() const {
+    return morphisms_.size();
+}
+
+}  // namespace komaru::lang
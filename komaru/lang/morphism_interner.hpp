@@ -0,0 +1,32 @@
+#pragma once
+#include <komaru/lang/morphism.hpp>
+#include <komaru/util/non_copyable.hpp>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace komaru::lang {
+
+// Deduplicates structurally equal morphisms into a DAG: equal subtrees (including binded
+// arguments and literals) become a single shared node with a stable id, so that work done
+// per morphism can be done and cached once.
+class MorphismInterner : public util::NonCopyable {
+public:
+    MorphismInterner() = default;
+
+    // Returns the canonical node equal to `morphism`, adding it if there is none yet
+    MorphismPtr Intern(const MorphismPtr& morphism);
+
+    // Ids are dense and given in interning order
+    std::optional<uint32_t> FindID(const Morphism& morphism) const;
+    const MorphismPtr& GetMorphism(uint32_t id) const;
+    size_t Size() const;
+
+private:
+    std::vector<MorphismPtr> morphisms_;
+    std::unordered_map<const Morphism*, uint32_t> ids_;
+    std::unordered_multimap<size_t, uint32_t> ids_by_hash_;
+};
+
+}  // namespace komaru::lang
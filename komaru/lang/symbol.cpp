@@ -0,0 +1,136 @@
+#include "symbol.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace komaru::lang {
+
+namespace {
+
+// Names are stored in chunks of doubling size which are never moved or freed,
+// so reading a name by id doesn't need the lock
+class SymbolTable {
+public:
+    SymbolTable() {
+        [[maybe_unused]] uint32_t empty_id = Intern("");
+        assert(empty_id == 0);
+
+        for (auto [builtin, name] : kBuiltinNames) {
+            [[maybe_unused]] uint32_t id = Intern(name);
+            assert(id == static_cast<uint32_t>(builtin));
+        }
+    }
+
+    static SymbolTable& Instance() {
+        static SymbolTable table;
+        return table;
+    }
+
+    uint32_t Intern(std::string_view name) {
+        Shard& shard = shards_[std::hash<std::string_view>{}(name) % kShardsNum];
+
+        {
+            std::shared_lock lock(shard.mutex);
+            auto it = shard.index.find(name);
+            if (it != shard.index.end()) {
+                return it->second;
+            }
+        }
+
+        std::unique_lock lock(shard.mutex);
+
+        auto it = shard.index.find(name);
+        if (it != shard.index.end()) {
+            return it->second;
+        }
+
+        auto [id, stored_name] = Store(name);
+        shard.index.emplace(stored_name, id);
+
+        return id;
+    }
+
+    const std::string& GetName(uint32_t id) const {
+        auto [chunk_idx, offset] = Locate(id);
+        return chunks_[chunk_idx].load(std::memory_order_acquire)[offset];
+    }
+
+private:
+    std::pair<uint32_t, std::string_view> Store(std::string_view name) {
+        std::lock_guard lock(store_mutex_);
+
+        uint32_t id = size_;
+        auto [chunk_idx, offset] = Locate(id);
+
+        std::string* chunk = chunks_[chunk_idx].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new std::string[size_t{1} << chunk_idx];
+            chunks_[chunk_idx].store(chunk, std::memory_order_release);
+        }
+
+        chunk[offset] = name;
+        ++size_;
+
+        return {id, chunk[offset]};
+    }
+
+    // Chunk i holds ids [2^i - 1, 2^(i + 1) - 1)
+    static std::pair<size_t, size_t> Locate(uint32_t id) {
+        size_t n = static_cast<size_t>(id) + 1;
+        size_t chunk_idx = std::bit_width(n) - 1;
+        return {chunk_idx, n - (size_t{1} << chunk_idx)};
+    }
+
+private:
+    static constexpr std::array<std::pair<BuiltinSymbol, std::string_view>, 10> kBuiltinNames = {{
+        {BuiltinSymbol::kAuto, "auto"},
+        {BuiltinSymbol::kSingleton, "S"},
+        {BuiltinSymbol::kInt, "Int"},
+        {BuiltinSymbol::kFloat, "Float"},
+        {BuiltinSymbol::kDouble, "Double"},
+        {BuiltinSymbol::kChar, "Char"},
+        {BuiltinSymbol::kBool, "Bool"},
+        {BuiltinSymbol::kList, "[]"},
+        {BuiltinSymbol::kIO, "IO"},
+        {BuiltinSymbol::kStr, "Str"},
+    }};
+
+    struct Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string_view, uint32_t> index;
+    };
+
+    static constexpr size_t kChunksNum = 33;
+    static constexpr size_t kShardsNum = 16;
+
+    std::array<std::atomic<std::string*>, kChunksNum> chunks_{};
+    std::mutex store_mutex_;
+    uint32_t size_{0};
+
+    std::array<Shard, kShardsNum> shards_;
+};
+
+}  // namespace
+
+Symbol::Symbol(std::string_view name)
+    : id_(SymbolTable::Instance().Intern(name)) {
+}
+
+Symbol::Symbol(const std::string& name)
+    : Symbol(std::string_view(name)) {
+}
+
+Symbol::Symbol(const char* name)
+    : Symbol(std::string_view(name)) {
+}
+
+const std::string& Symbol::GetName() const {
+    return SymbolTable::Instance().GetName(id_);
+}
+
+}  // namespace komaru::lang
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <compare>
+#include <string>
+#include <string_view>
+#include <functional>
+
+namespace komaru::lang {
+
+// Names interned before any other, so their symbols are known at compile time
+enum class BuiltinSymbol : uint32_t {
+    kAuto = 1,
+    kSingleton,
+    kInt,
+    kFloat,
+    kDouble,
+    kChar,
+    kBool,
+    kList,
+    kIO,
+    kStr,
+};
+
+// Interned name of a type, type constructor or morphism.
+// Equal names always get the same id, so comparing symbols is comparing integers.
+class Symbol {
+public:
+    // Empty name
+    Symbol() = default;
+
+    Symbol(std::string_view name);  // NOLINT
+    Symbol(const std::string& name);  // NOLINT
+    Symbol(const char* name);  // NOLINT
+    constexpr Symbol(BuiltinSymbol symbol)  // NOLINT
+        : id_(static_cast<uint32_t>(symbol)) {
+    }
+
+    const std::string& GetName() const;
+
+    constexpr uint32_t GetID() const {
+        return id_;
+    }
+
+    constexpr bool IsEmpty() const {
+        return id_ == 0;
+    }
+
+    bool operator==(const Symbol& o) const = default;
+    // Orders by id, not lexicographically
+    std::strong_ordering operator<=>(const Symbol& o) const = default;
+
+private:
+    uint32_t id_{0};
+};
+
+}  // namespace komaru::lang
+
+template <>
+struct std::hash<komaru::lang::Symbol> {
+    std::size_t operator()(const komaru::lang::Symbol& s) const noexcept {
+        return s.GetID();
+    }
+};
@@ -1,97 +1,761 @@
 #include "type.hpp"
 
 #include <format>
+#include <functional>
 #include <cassert>
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <unordered_map>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
 
 #include <komaru/util/std_extensions.hpp>
 #include <komaru/util/string.hpp>
+#include <komaru/util/hash.hpp>
+#include <komaru/util/arena.hpp>
 
 namespace komaru::lang {
 
-std::deque<Type::Variant>& Type::GetStorage() {
-    static std::deque<Type::Variant> storage;
-    return storage;
+static void AppendShielded(std::string& out, Type type, Style style) {
+    bool shield = type.ShouldBeShielded();
+    if (shield) {
+        out += '(';
+    }
+    type.AppendTo(out, style);
+    if (shield) {
+        out += ')';
+    }
+}
+
+template <typename T, typename... Ts>
+static constexpr size_t VariantIndexOf(std::type_identity<std::variant<Ts...>>) {
+    constexpr std::array<bool, sizeof...(Ts)> kMatches = {std::is_same_v<T, Ts>...};
+    return std::ranges::find(kMatches, true) - kMatches.begin();
 }
 
-std::unordered_map<std::string, Type::Variant*>& Type::GetIndex() {
-    static std::unordered_map<std::string, Type::Variant*> index;
-    return index;
+namespace {
+
+std::atomic<uint32_t> next_generation{TypeUniverse::kPermanentGeneration + 1};
+// Bumped every time types are released, so memoized results mentioning them are dropped
+std::atomic<uint64_t> release_epoch{0};
+// Taken by whatever changes pins or frees types, so a type that is alive when it's taken
+// stays alive, children included, until it's released. Shard locks are taken inside it.
+std::mutex pins_mutex;
+
+thread_local TypeUniverse* tls_universe = nullptr;
+// PermanentScopes open on this thread
+thread_local size_t tls_permanent_scopes = 0;
+
+// Universe the types interned on this thread go to, nullptr for permanent ones
+TypeUniverse* GetCurrentUniverse() {
+    return tls_permanent_scopes > 0 ? nullptr : tls_universe;
 }
 
+uint32_t GetGeneration(const TypeUniverse* universe) {
+    return universe ? universe->GetGeneration() : TypeUniverse::kPermanentGeneration;
+}
+
+// Types of universes own their child lists, flattened functions and rendered text, so
+// a pinned one can outlive its universe without keeping the rest of it
 template <typename T>
-Type::Variant* Type::MakeType(const T& type) {
-    auto it = GetIndex().find(type.GetID());
-    if (it != GetIndex().end()) {
-        return it->second;
+std::span<const T> CopyToHeap(std::span<const T> values) {
+    if (values.empty()) {
+        return {};
     }
 
-    Variant* new_type = &GetStorage().emplace_back(type);
-    GetIndex().emplace(std::move(type.GetID()), new_type);
-    return new_type;
+    T* data = std::allocator<T>().allocate(values.size());
+    std::uninitialized_copy(values.begin(), values.end(), data);
+    return {data, values.size()};
 }
 
-Type::Type(const CommonType& type) {
-    type_ = MakeType(type);
+template <typename T>
+void FreeOnHeap(std::span<const T> values) {
+    if (!values.empty()) {
+        std::allocator<T>().deallocate(const_cast<T*>(values.data()), values.size());
+    }
 }
 
-Type::Type(const TupleType& type) {
-    type_ = MakeType(type);
+}  // namespace
+
+struct Type::Shard {
+    struct Slot {
+        uint32_t id;
+        uint32_t hash;
+    };
+
+    // Types of one universe in this shard. It's released with the universe, and its pinned
+    // types are left alive until they're unpinned.
+    struct Generation {
+        std::vector<uint32_t> local_idxs;
+        // Made permanent, so they aren't released
+        size_t promoted_num{0};
+    };
+
+    static constexpr uint32_t kNoType = std::numeric_limits<uint32_t>::max();
+    // One past the last index of the last chunk
+    static constexpr uint32_t kMaxLocalIdx = (uint32_t{1} << kChunksNum) - 1;
+
+    std::optional<uint32_t> Find(const TypeKey& key) const {
+        if (index.empty()) {
+            return std::nullopt;
+        }
+
+        auto hash = static_cast<uint32_t>(key.GetHash());
+        size_t mask = index.size() - 1;
+
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = index[i];
+            if (slot.id == kNoType) {
+                return std::nullopt;
+            }
+            if (slot.hash == hash && KeyMatches(key, *Type(slot.id).GetVariantPointer())) {
+                return slot.id;
+            }
+        }
+    }
+
+    uint32_t Add(const TypeKey& key, size_t shard_idx, uint32_t generation) {
+        uint32_t local_idx = size;
+        if (!free_local_idxs.empty()) {
+            local_idx = free_local_idxs.back();
+            free_local_idxs.pop_back();
+        } else if (size == kMaxLocalIdx) {
+            throw std::length_error("too many types in the type store");
+        } else {
+            ++size;
+        }
+
+        auto [chunk_idx, offset] = Locate(local_idx);
+
+        auto& chunk_ptr = chunks_[shard_idx][chunk_idx];
+        Entry* chunk = chunk_ptr.load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = std::allocator<Entry>().allocate(size_t{1} << chunk_idx);
+            chunk_ptr.store(chunk, std::memory_order_release);
+        }
+
+        auto id = static_cast<uint32_t>(local_idx * kShardsNum + shard_idx);
+
+        Entry* entry = std::construct_at(chunk + offset, MakeEntry(key, Type(id), generation));
+        if (entry->flattened.empty()) {
+            entry->flattened = {&entry->self, 1};
+        }
+        if (generation != TypeUniverse::kPermanentGeneration) {
+            generations[generation].local_idxs.push_back(local_idx);
+        }
+
+        ++types_num;
+        if ((types_num + 1) * 2 > index.size()) {
+            Rehash(std::max<size_t>(index.size() * 2, 64));
+        }
+        Insert(Slot{.id = id, .hash = static_cast<uint32_t>(key.GetHash())});
+
+        return id;
+    }
+
+    void Release(uint32_t generation, size_t shard_idx) {
+        auto it = generations.find(generation);
+        if (it == generations.end()) {
+            return;
+        }
+
+        for (uint32_t local_idx : it->second.local_idxs) {
+            const Entry& entry = Type(ToID(local_idx, shard_idx)).GetEntry();
+            if (LoadGeneration(entry) == generation && entry.pins_num == 0) {
+                Free(local_idx, shard_idx);
+            }
+        }
+
+        generations.erase(it);
+    }
+
+    // Returns true if it's the first pin, so the children have to be pinned too
+    bool Pin(const Entry& entry) {
+        return LoadGeneration(entry) != TypeUniverse::kPermanentGeneration &&
+               entry.pins_num++ == 0;
+    }
+
+    // Returns true if it was the last pin, so the children have to be unpinned too. A type
+    // whose universe is gone is freed then.
+    bool Unpin(const Entry& entry, size_t shard_idx) {
+        uint32_t generation = LoadGeneration(entry);
+        if (generation == TypeUniverse::kPermanentGeneration || --entry.pins_num > 0) {
+            return false;
+        }
+
+        if (!generations.contains(generation)) {
+            Free(entry.self.GetID() / kShardsNum, shard_idx);
+        }
+        return true;
+    }
+
+    void Promote(const Entry& entry) {
+        uint32_t generation = LoadGeneration(entry);
+        // Another thread could have promoted it while the lock was released
+        if (generation == TypeUniverse::kPermanentGeneration) {
+            return;
+        }
+
+        if (auto it = generations.find(generation); it != generations.end()) {
+            ++it->second.promoted_num;
+        }
+        std::atomic_ref(const_cast<uint32_t&>(entry.generation))
+            .store(TypeUniverse::kPermanentGeneration, std::memory_order_relaxed);
+    }
+
+    // Promoting changes it under the lock of the type's shard, while types are found and held
+    // under other locks
+    static uint32_t LoadGeneration(const Entry& entry) {
+        return std::atomic_ref(const_cast<uint32_t&>(entry.generation))
+            .load(std::memory_order_relaxed);
+    }
+
+    // Builtin entries are constant-initialized, only their local index and key are recorded
+    void ReserveBuiltin() {
+        size = 1;
+    }
+
+    void IndexBuiltin(uint32_t id, uint32_t hash) {
+        ++types_num;
+        if ((types_num + 1) * 2 > index.size()) {
+            Rehash(std::max<size_t>(index.size() * 2, 64));
+        }
+        Insert(Slot{.id = id, .hash = hash});
+    }
+
+    const std::string_view* CopyString(uint32_t generation, std::string_view text) {
+        if (generation != TypeUniverse::kPermanentGeneration) {
+            auto* block = std::allocator<std::byte>().allocate(sizeof(std::string_view) +
+                                                               text.size());
+            auto* chars = reinterpret_cast<char*>(block + sizeof(std::string_view));
+            std::ranges::copy(text, chars);
+            return std::construct_at(reinterpret_cast<std::string_view*>(block), chars,
+                                     text.size());
+        }
+
+        std::span<const char> chars = permanent_arena.CopyArray(std::span<const char>(text));
+        return std::construct_at(
+            static_cast<std::string_view*>(
+                permanent_arena.Allocate(sizeof(std::string_view), alignof(std::string_view))),
+            chars.data(), chars.size());
+    }
+
+    size_t CountTypes(uint32_t generation) const {
+        auto it = generations.find(generation);
+        return it == generations.end()
+                   ? 0
+                   : it->second.local_idxs.size() - it->second.promoted_num;
+    }
+
+    size_t CountAllTypes() const {
+        return types_num;
+    }
+
+private:
+    static uint32_t ToID(uint32_t local_idx, size_t shard_idx) {
+        return static_cast<uint32_t>(local_idx * kShardsNum + shard_idx);
+    }
+
+    template <typename T>
+    std::span<const T> CopyArray(uint32_t generation, std::span<const T> values) {
+        return generation == TypeUniverse::kPermanentGeneration ? permanent_arena.CopyArray(values)
+                                                                : CopyToHeap(values);
+    }
+
+    // Only types of universes are freed, so their data is on the heap
+    void Free(uint32_t local_idx, size_t shard_idx) {
+        uint32_t id = ToID(local_idx, shard_idx);
+        const Entry& entry = Type(id).GetEntry();
+
+        auto hash = static_cast<uint32_t>(
+            std::visit(
+                [](const auto& t) {
+                    return MakeKey(t);
+                },
+                entry.variant)
+                .GetHash());
+        Erase(id, hash);
+
+        if (std::holds_alternative<FunctionType>(entry.variant)) {
+            FreeOnHeap(entry.flattened);
+        } else if (!std::holds_alternative<ListType>(entry.variant)) {
+            FreeOnHeap(GetChildren(entry));
+        }
+        for (const std::string_view* text : entry.rendered) {
+            if (text) {
+                std::allocator<std::byte>().deallocate(
+                    const_cast<std::byte*>(reinterpret_cast<const std::byte*>(text)),
+                    sizeof(std::string_view) + text->size());
+            }
+        }
+
+        std::destroy_at(&entry);
+        free_local_idxs.push_back(local_idx);
+        --types_num;
+    }
+
+    // Children are interned before their parents, so their properties are ready to be reused
+    Entry MakeEntry(const TypeKey& key, Type self, uint32_t generation) {
+        Variant variant = MakeVariant(key, generation);
+        bool is_concrete = std::visit(
+            [](const TypeLike auto& t) {
+                return t.IsConcrete();
+            },
+            variant);
+        bool should_be_shielded = std::visit(
+            [](const TypeLike auto& t) {
+                return t.ShouldBeShielded();
+            },
+            variant);
+        const auto* common = std::get_if<CommonType>(&variant);
+        bool is_type_var = common && !common->HasTypeParams() && !is_concrete;
+
+        uint32_t param_num = 0;
+        std::span<const Type> flattened;
+
+        if (const auto* func = std::get_if<FunctionType>(&variant)) {
+            bool from_singleton = func->Source() == Type::Singleton();
+
+            std::span<const Type> target_flattened = func->Target().FlattenFunction();
+            std::vector<Type> types;
+            types.reserve(target_flattened.size() + 1);
+            if (!from_singleton) {
+                types.push_back(func->Source());
+                param_num = 1 + static_cast<uint32_t>(func->Target().GetParamNum());
+            }
+            types.insert(types.end(), target_flattened.begin(), target_flattened.end());
+            flattened = CopyArray(generation, std::span<const Type>(types));
+        }
+
+        return Entry{.variant = std::move(variant),
+                     .self = self,
+                     .is_concrete = is_concrete,
+                     .should_be_shielded = should_be_shielded,
+                     .is_type_var = is_type_var,
+                     .param_num = param_num,
+                     .generation = generation,
+                     .flattened = flattened};
+    }
+
+    Variant MakeVariant(const TypeKey& key, uint32_t generation) {
+        constexpr size_t kCommonKind = VariantIndexOf<CommonType>(std::type_identity<Variant>{});
+        constexpr size_t kTupleKind = VariantIndexOf<TupleType>(std::type_identity<Variant>{});
+        constexpr size_t kFunctionKind =
+            VariantIndexOf<FunctionType>(std::type_identity<Variant>{});
+
+        std::span<const Type> children = key.GetChildren();
+
+        if (key.GetKind() == kCommonKind) {
+            return CommonType(key.GetName(), CopyArray(generation, children));
+        }
+        if (key.GetKind() == kTupleKind) {
+            return TupleType(CopyArray(generation, children));
+        }
+        if (key.GetKind() == kFunctionKind) {
+            return FunctionType(children[0], children[1]);
+        }
+        return ListType(children[0]);
+    }
+
+    void Insert(Slot new_slot) {
+        size_t mask = index.size() - 1;
+        for (size_t i = new_slot.hash & mask;; i = (i + 1) & mask) {
+            if (index[i].id == kNoType) {
+                index[i] = new_slot;
+                return;
+            }
+        }
+    }
+
+    // Backward shift deletion: entries after the erased one are moved closer to their
+    // home slots, so lookups never need tombstones
+    void Erase(uint32_t id, uint32_t hash) {
+        size_t mask = index.size() - 1;
+
+        size_t hole = hash & mask;
+        while (index[hole].id != id) {
+            hole = (hole + 1) & mask;
+        }
+
+        for (size_t i = (hole + 1) & mask; index[i].id != kNoType; i = (i + 1) & mask) {
+            size_t home = index[i].hash & mask;
+            // The entry can fill the hole unless its home lies cyclically in (hole, i]
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                index[hole] = index[i];
+                hole = i;
+            }
+        }
+
+        index[hole] = Slot{.id = kNoType, .hash = 0};
+    }
+
+    void Rehash(size_t new_size) {
+        std::vector<Slot> old_index(new_size, Slot{.id = kNoType, .hash = 0});
+        std::swap(index, old_index);
+
+        for (const Slot& slot : old_index) {
+            if (slot.id != kNoType) {
+                Insert(slot);
+            }
+        }
+    }
+
+    static std::pair<size_t, size_t> Locate(uint32_t idx) {
+        size_t n = static_cast<size_t>(idx) + 1;
+        size_t chunk_idx = std::bit_width(n) - 1;
+        return {chunk_idx, n - (size_t{1} << chunk_idx)};
+    }
+
+public:
+    std::shared_mutex mutex;
+
+private:
+    // Local indices ever used and the ones freed by released generations
+    uint32_t size{0};
+    std::vector<uint32_t> free_local_idxs;
+    size_t types_num{0};
+    std::unordered_map<uint32_t, Generation> generations;
+    // Child lists of common and tuple types, flattened functions and rendered text of
+    // permanent types
+    util::Arena permanent_arena;
+    // Open addressing over type ids, probed with the low half of the key hash
+    std::vector<Slot> index;
+};
+
+constinit std::array<Type::Entry, Type::kBuiltinsNum> Type::builtins_ = std::invoke([] {
+    auto builtin = [](BuiltinID id, Variant variant, bool is_concrete, bool should_be_shielded) {
+        return Entry{.variant = variant,
+                     .self = Type(id),
+                     .is_concrete = is_concrete,
+                     .should_be_shielded = should_be_shielded,
+                     .is_type_var = !is_concrete,
+                     .param_num = 0,
+                     .generation = TypeUniverse::kPermanentGeneration,
+                     .flattened = {&builtins_[id].self, 1}};
+    };
+
+    return std::array{
+        builtin(kAutoID, CommonType(BuiltinSymbol::kAuto, {}), false, false),
+        builtin(kSingletonID, CommonType(BuiltinSymbol::kSingleton, {}), true, false),
+        builtin(kIntID, CommonType(BuiltinSymbol::kInt, {}), true, false),
+        builtin(kFloatID, CommonType(BuiltinSymbol::kFloat, {}), true, false),
+        builtin(kDoubleID, CommonType(BuiltinSymbol::kDouble, {}), true, false),
+        builtin(kCharID, CommonType(BuiltinSymbol::kChar, {}), true, false),
+        builtin(kBoolID, CommonType(BuiltinSymbol::kBool, {}), true, false),
+        builtin(kStringID, ListType(Type::Char()), true, false),
+        builtin(kIOSingletonID,
+                CommonType(BuiltinSymbol::kIO, {&builtins_[kSingletonID].self, 1}), true, true),
+    };
+});
+
+// Chunk 0 of shard i holds exactly one type: builtin i
+constinit std::array<std::array<std::atomic<Type::Entry*>, Type::kChunksNum>, Type::kShardsNum>
+    Type::chunks_ = {{
+        {&builtins_[0]},
+        {&builtins_[1]},
+        {&builtins_[2]},
+        {&builtins_[3]},
+        {&builtins_[4]},
+        {&builtins_[5]},
+        {&builtins_[6]},
+        {&builtins_[7]},
+        {&builtins_[8]},
+    }};
+
+size_t Type::GetShardIdx(const TypeKey& key) {
+    // Low bits of the hash are used by the shard's index, so the shard is picked by
+    // the high bits of its Fibonacci scramble
+    static_assert(std::has_single_bit(kShardsNum));
+    return (key.GetHash() * 0x9e3779b97f4a7c15ULL) >> (64 - std::countr_zero(kShardsNum));
+}
+
+Type::Shard& Type::GetShard(size_t shard_idx) {
+    struct Shards {
+        Shards() {
+            for (uint32_t id = 0; id < kBuiltinsNum; ++id) {
+                shards[id].ReserveBuiltin();
+            }
+            // So that builtins are found by their keys too
+            for (const Entry& entry : builtins_) {
+                assert(entry.is_concrete == entry.self.Visit([](const TypeLike auto& t) {
+                    return t.IsConcrete();
+                }));
+                assert(entry.should_be_shielded == entry.self.Visit([](const TypeLike auto& t) {
+                    return t.ShouldBeShielded();
+                }));
+
+                TypeKey key = std::visit(
+                    [](const auto& t) {
+                        return MakeKey(t);
+                    },
+                    entry.variant);
+                shards[GetShardIdx(key)].IndexBuiltin(entry.self.id_,
+                                                     static_cast<uint32_t>(key.GetHash()));
+            }
+        }
+
+        std::array<Shard, kShardsNum> shards;
+    };
+
+    static Shards shards;
+    return shards.shards[shard_idx];
+}
+
+void Type::Release(uint32_t generation) {
+    std::lock_guard pins_lock(pins_mutex);
+    for (size_t shard_idx = 0; shard_idx < kShardsNum; ++shard_idx) {
+        Shard& shard = GetShard(shard_idx);
+        std::unique_lock lock(shard.mutex);
+        shard.Release(generation, shard_idx);
+    }
+    release_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::span<const Type> Type::GetChildren(const Entry& entry) {
+    return std::visit(
+        [](const auto& t) {
+            return GetNameAndChildren(t).second;
+        },
+        entry.variant);
 }
 
-Type::Type(const FunctionType& type) {
-    type_ = MakeType(type);
+bool Type::IsHeld(Type type, uint32_t generation, TypeUniverse* universe) {
+    uint32_t type_generation = Shard::LoadGeneration(type.GetEntry());
+    return type_generation == TypeUniverse::kPermanentGeneration ||
+           type_generation == generation || (universe && universe->IsBorrowed(type.id_));
 }
 
-Type::Type(const ListType& type) {
-    type_ = MakeType(type);
+void Type::Hold(Type type, TypeUniverse* universe) {
+    if (IsHeld(type, GetGeneration(universe), nullptr)) {
+        return;
+    }
+
+    if (!universe) {
+        Promote(type);
+    } else if (universe->Borrow(type.id_)) {
+        Pin(type);
+    }
 }
 
-Type::Type(const Variant* type)
-    : type_(type) {
+void Type::Pin(Type type) {
+    Shard& shard = GetShard(type.id_ % kShardsNum);
+    {
+        std::unique_lock lock(shard.mutex);
+        if (!shard.Pin(type.GetEntry())) {
+            return;
+        }
+    }
+
+    for (Type child : GetChildren(type.GetEntry())) {
+        Pin(child);
+    }
 }
 
-const Type::Variant* Type::GetVariantPointer() const {
-    return type_;
+void Type::Unpin(Type type) {
+    size_t shard_idx = type.id_ % kShardsNum;
+    Shard& shard = GetShard(shard_idx);
+
+    // The type may be freed along with the last pin
+    std::vector<Type> children;
+    {
+        std::unique_lock lock(shard.mutex);
+        const Entry& entry = type.GetEntry();
+        auto entry_children = GetChildren(entry);
+        children.assign(entry_children.begin(), entry_children.end());
+        if (!shard.Unpin(entry, shard_idx)) {
+            return;
+        }
+    }
+    release_epoch.fetch_add(1, std::memory_order_relaxed);
+
+    for (Type child : children) {
+        Unpin(child);
+    }
+}
+
+// Children go first, so a permanent type never has a released child
+void Type::Promote(Type type) {
+    const Entry& entry = type.GetEntry();
+    if (Shard::LoadGeneration(entry) == TypeUniverse::kPermanentGeneration) {
+        return;
+    }
+
+    for (Type child : GetChildren(entry)) {
+        Promote(child);
+    }
+
+    Shard& shard = GetShard(type.id_ % kShardsNum);
+    std::unique_lock lock(shard.mutex);
+    shard.Promote(entry);
+}
+
+std::string_view Type::StoreRendered(const Entry& entry, Style style, std::string_view text) {
+    Shard& shard = GetShard(entry.self.id_ % kShardsNum);
+    std::unique_lock lock(shard.mutex);
+
+    // Another thread could have rendered the same type while the lock was released
+    std::atomic_ref rendered(entry.rendered[static_cast<size_t>(style)]);
+    if (const std::string_view* stored = rendered.load(std::memory_order_relaxed)) {
+        return *stored;
+    }
+
+    const std::string_view* stored = shard.CopyString(Shard::LoadGeneration(entry), text);
+    rendered.store(stored, std::memory_order_release);
+    return *stored;
+}
+
+size_t Type::CountTypes(uint32_t generation) {
+    size_t types_num = 0;
+    for (size_t shard_idx = 0; shard_idx < kShardsNum; ++shard_idx) {
+        Shard& shard = GetShard(shard_idx);
+        std::shared_lock lock(shard.mutex);
+        types_num += shard.CountTypes(generation);
+    }
+    return types_num;
+}
+
+size_t Type::CountAllTypes() {
+    size_t types_num = 0;
+    for (size_t shard_idx = 0; shard_idx < kShardsNum; ++shard_idx) {
+        Shard& shard = GetShard(shard_idx);
+        std::shared_lock lock(shard.mutex);
+        types_num += shard.CountAllTypes();
+    }
+    return types_num;
+}
+
+template <typename T>
+std::pair<Symbol, std::span<const Type>> Type::GetNameAndChildren(const T& type) {
+    if constexpr (std::is_same_v<T, CommonType>) {
+        return {type.GetSymbol(), type.GetTypeParams()};
+    } else if constexpr (std::is_same_v<T, TupleType>) {
+        return {{}, type.GetTupleTypes()};
+    } else if constexpr (std::is_same_v<T, FunctionType>) {
+        return {{}, type.GetSourceAndTarget()};
+    } else {
+        static_assert(std::is_same_v<T, ListType>);
+        return {{}, std::span<const Type>(&type.inner_type_, 1)};
+    }
+}
+
+template <typename T>
+TypeKey Type::MakeKey(const T& type) {
+    constexpr size_t kKind = VariantIndexOf<T>(std::type_identity<Variant>{});
+    auto [name, children] = GetNameAndChildren(type);
+    return TypeKey(kKind, name, children);
+}
+
+bool Type::KeyMatches(const TypeKey& key, const Variant& type) {
+    if (key.GetKind() != type.index()) {
+        return false;
+    }
+
+    return std::visit(
+        [&key](const auto& t) {
+            auto [name, children] = GetNameAndChildren(t);
+            return key.GetName() == name && std::ranges::equal(key.GetChildren(), children);
+        },
+        type);
+}
+
+uint32_t Type::Intern(const TypeKey& key) {
+    TypeUniverse* universe = GetCurrentUniverse();
+    uint32_t generation = GetGeneration(universe);
+
+    // A type can't outlive its children
+    for (Type child : key.GetChildren()) {
+        if (!IsHeld(child, generation, universe)) {
+            std::lock_guard pins_lock(pins_mutex);
+            Hold(child, universe);
+        }
+    }
+
+    size_t shard_idx = GetShardIdx(key);
+    Shard& shard = GetShard(shard_idx);
+
+    std::optional<uint32_t> id;
+    {
+        std::shared_lock lock(shard.mutex);
+        id = shard.Find(key);
+        if (id && IsHeld(Type(id.value()), generation, universe)) {
+            return id.value();
+        }
+    }
+
+    if (!id) {
+        std::unique_lock lock(shard.mutex);
+
+        // Another thread could have interned the same type while the lock was released
+        id = shard.Find(key);
+        if (!id) {
+            return shard.Add(key, shard_idx, generation);
+        }
+        if (IsHeld(Type(id.value()), generation, universe)) {
+            return id.value();
+        }
+    }
+
+    // It belongs to another universe, which may be released any moment, so it's looked up
+    // again where it can't be
+    std::lock_guard pins_lock(pins_mutex);
+    {
+        std::unique_lock lock(shard.mutex);
+        id = shard.Find(key);
+        if (!id) {
+            return shard.Add(key, shard_idx, generation);
+        }
+    }
+
+    Hold(Type(id.value()), universe);
+    return id.value();
+}
+
+Type::Type(const CommonType& type)
+    : id_(Intern(MakeKey(type))) {
+}
+
+Type::Type(const TupleType& type)
+    : id_(Intern(MakeKey(type))) {
+}
+
+Type::Type(const FunctionType& type)
+    : id_(Intern(MakeKey(type))) {
+}
+
+Type::Type(const ListType& type)
+    : id_(Intern(MakeKey(type))) {
 }
 
 Type Type::Common(std::string name) {
-    return Parameterized(std::move(name), {});
+    return Parameterized(name, {});
 }
 
 Type Type::Simple(std::string name) {
     assert(!name.empty() && IsConcreteTypeName(name) && std::isalpha(name[0]));
-    return Parameterized(std::move(name), {});
+    return Parameterized(name, {});
 }
 
-Type Type::Parameterized(std::string name, std::vector<Type> params) {
-    if (name == "[]") {
+Type Type::Parameterized(Symbol name, std::vector<Type> params) {
+    if (name == BuiltinSymbol::kList) {
         assert(params.size() == 1);
         return Type::List(params[0]);
     }
 
-    auto id = CommonType::MakeID(name, params);
-    auto it = GetIndex().find(id);
-    if (it != GetIndex().end()) {
-        return Type(it->second);
-    }
-
-    Variant* new_type = &GetStorage().emplace_back(CommonType(std::move(name), std::move(params)));
-    GetIndex().emplace(std::move(id), new_type);
+    constexpr size_t kKind = VariantIndexOf<CommonType>(std::type_identity<Variant>{});
 
-    return Type(new_type);
+    return Type(Intern(TypeKey(kKind, name, params)));
 }
 
 Type Type::Tuple(std::vector<Type> types) {
-    auto id = TupleType::MakeID(types);
-    auto it = GetIndex().find(id);
-    if (it != GetIndex().end()) {
-        return Type(it->second);
-    }
+    constexpr size_t kKind = VariantIndexOf<TupleType>(std::type_identity<Variant>{});
 
-    Variant* new_type = &GetStorage().emplace_back(TupleType(std::move(types)));
-    GetIndex().emplace(std::move(id), new_type);
-
-    return Type(new_type);
+    return Type(Intern(TypeKey(kKind, {}, types)));
 }
 
 Type Type::TupleFromSimples(std::vector<std::string> names) {
@@ -106,16 +770,10 @@ Type Type::TupleFromSimples(std::vector<std::string> names) {
 }
 
 Type Type::Function(Type source, Type target) {
-    std::string key = FunctionType::MakeID(source, target);
-    auto it = GetIndex().find(key);
-    if (it != GetIndex().end()) {
-        return Type(it->second);
-    }
-
-    Variant* new_type = &GetStorage().emplace_back(FunctionType(source, target));
-    GetIndex().emplace(std::move(key), new_type);
+    constexpr size_t kKind = VariantIndexOf<FunctionType>(std::type_identity<Variant>{});
+    const std::array<Type, 2> source_and_target = {source, target};
 
-    return Type(new_type);
+    return Type(Intern(TypeKey(kKind, {}, source_and_target)));
 }
 
 // Function with multiple parameters
@@ -138,75 +796,194 @@ Type Type::FunctionChain(const std::vector<Type>& types) {
 }
 
 Type Type::List(Type inner_type) {
-    std::string key = ListType::MakeID(inner_type);
-    auto it = GetIndex().find(key);
-    if (it != GetIndex().end()) {
-        return Type(it->second);
-    }
-
-    Variant* new_type = &GetStorage().emplace_back(ListType(inner_type));
-    GetIndex().emplace(std::move(key), new_type);
+    constexpr size_t kKind = VariantIndexOf<ListType>(std::type_identity<Variant>{});
 
-    return Type(new_type);
+    return Type(Intern(TypeKey(kKind, {}, std::span<const Type>(&inner_type, 1))));
 }
 
 Type Type::Var(std::string name) {
     assert(!name.empty() && !IsConcreteTypeName(name) && std::isalpha(name[0]));
-    return Type::Parameterized(std::move(name), {});
+    return Type::Parameterized(name, {});
+}
+
+PinnedTypes::PinnedTypes(const PinnedTypes& other) {
+    std::lock_guard pins_lock(pins_mutex);
+    for (uint32_t id : other.ids_) {
+        Type::Pin(Type(id));
+    }
+    ids_ = other.ids_;
+}
+
+PinnedTypes::PinnedTypes(PinnedTypes&& other) noexcept
+    : ids_(std::exchange(other.ids_, {})) {
+}
+
+PinnedTypes& PinnedTypes::operator=(PinnedTypes other) noexcept {
+    std::swap(ids_, other.ids_);
+    return *this;
+}
+
+PinnedTypes::~PinnedTypes() {
+    Clear();
+}
+
+void PinnedTypes::Add(Type type) {
+    if (Type::Shard::LoadGeneration(type.GetEntry()) == TypeUniverse::kPermanentGeneration ||
+        !ids_.insert(type.id_).second) {
+        return;
+    }
+
+    std::lock_guard pins_lock(pins_mutex);
+    Type::Pin(type);
+}
+
+void PinnedTypes::Clear() {
+    if (ids_.empty()) {
+        return;
+    }
+
+    // Pins of types from other universes are handed over to the current one
+    TypeUniverse* universe = GetCurrentUniverse();
+    std::vector<Type> unpinned;
+
+    for (uint32_t id : ids_) {
+        uint32_t generation = Type::Shard::LoadGeneration(Type(id).GetEntry());
+        if (universe && !universe->is_closing_ && generation != universe->generation_ &&
+            generation != TypeUniverse::kPermanentGeneration && universe->Borrow(id)) {
+            continue;
+        }
+        unpinned.push_back(Type(id));
+    }
+    ids_.clear();
+
+    std::lock_guard pins_lock(pins_mutex);
+    for (Type type : unpinned) {
+        Type::Unpin(type);
+    }
 }
 
-Type Type::Auto() {
-    return Type::Var("auto");
+bool PinnedTypes::IsEmpty() const {
+    return ids_.empty();
 }
 
-Type Type::Singleton() {
-    return Type::Simple("S");
+TypeUniverse::TypeUniverse()
+    : generation_(next_generation.fetch_add(1, std::memory_order_relaxed)),
+      previous_(tls_universe) {
+    tls_universe = this;
 }
 
-Type Type::Int() {
-    return Type::Simple("Int");
+TypeUniverse::~TypeUniverse() {
+    assert(tls_universe == this);
+    is_closing_ = true;
+
+    kept_.clear();
+    {
+        std::lock_guard pins_lock(pins_mutex);
+        for (uint32_t id : borrowed_) {
+            Type::Unpin(Type(id));
+        }
+    }
+
+    tls_universe = previous_;
+    Type::Release(generation_);
 }
 
-Type Type::Float() {
-    return Type::Simple("Float");
+uint32_t TypeUniverse::GetGeneration() const {
+    return generation_;
 }
 
-Type Type::Double() {
-    return Type::Simple("Double");
+size_t TypeUniverse::GetTypesNum() const {
+    return Type::CountTypes(generation_);
 }
 
-Type Type::Char() {
-    return Type::Simple("Char");
+size_t TypeUniverse::GetAllTypesNum() {
+    return Type::CountAllTypes();
+}
+
+TypeUniverse* TypeUniverse::Current() {
+    return tls_universe;
+}
+
+void TypeUniverse::Keep(std::shared_ptr<const PinnedTypes> pins) {
+    if (!pins || pins->IsEmpty()) {
+        return;
+    }
+
+    TypeUniverse* universe = GetCurrentUniverse();
+    if (!universe) {
+        std::lock_guard pins_lock(pins_mutex);
+        for (uint32_t id : pins->ids_) {
+            Type::Promote(Type(id));
+        }
+        return;
+    }
+
+    std::lock_guard lock(universe->mutex_);
+    const PinnedTypes* key = pins.get();
+    universe->kept_.try_emplace(key, std::move(pins));
 }
 
-Type Type::Bool() {
-    return Type::Simple("Bool");
+bool TypeUniverse::IsBorrowed(uint32_t id) const {
+    std::shared_lock lock(mutex_);
+    return borrowed_.contains(id);
 }
 
-Type Type::String() {
-    return Type::List(Type::Char());
+bool TypeUniverse::Borrow(uint32_t id) {
+    std::lock_guard lock(mutex_);
+    return borrowed_.insert(id).second;
+}
+
+TypeUniverse::Scope::Scope(TypeUniverse* universe)
+    : previous_(tls_universe) {
+    tls_universe = universe;
+}
+
+TypeUniverse::Scope::~Scope() {
+    tls_universe = previous_;
+}
+
+TypeUniverse::PermanentScope::PermanentScope() {
+    ++tls_permanent_scopes;
+}
+
+TypeUniverse::PermanentScope::~PermanentScope() {
+    assert(tls_permanent_scopes > 0);
+    --tls_permanent_scopes;
 }
 
 std::string Type::ToString(Style style) const {
-    return this->Visit([style](const TypeLike auto& t) -> std::string {
-        return t.ToString(style);
+    return std::string(ToStringView(style));
+}
+
+std::string_view Type::ToStringView(Style style) const {
+    const Entry& entry = GetEntry();
+    std::atomic_ref rendered(entry.rendered[static_cast<size_t>(style)]);
+    if (const std::string_view* text = rendered.load(std::memory_order_acquire)) {
+        return *text;
+    }
+
+    // Rendered without the lock: children take their own shards' locks to store their texts
+    std::string text;
+    this->Visit([&text, style](const TypeLike auto& t) {
+        t.AppendTo(text, style);
     });
+    return StoreRendered(entry, style, text);
+}
+
+void Type::AppendTo(std::string& out, Style style) const {
+    out += ToStringView(style);
 }
 
 bool Type::IsConcrete() const {
-    return this->Visit([](const TypeLike auto& t) -> bool {
-        return t.IsConcrete();
-    });
+    return GetEntry().is_concrete;
 }
 
 bool Type::ShouldBeShielded() const {
-    return this->Visit([](const TypeLike auto& t) -> bool {
-        return t.ShouldBeShielded();
-    });
+    return GetEntry().should_be_shielded;
 }
 
-std::uintptr_t Type::GetID() const {
-    return reinterpret_cast<std::uintptr_t>(type_);
+uint32_t Type::GetID() const {
+    return id_;
 }
 
 Type Type::Pow(size_t n) const {
@@ -214,90 +991,55 @@ Type Type::Pow(size_t n) const {
 }
 
 size_t Type::GetComponentsNum() const {
-    return this->Visit(util::Overloaded{[](const TupleType& t) -> size_t {
-                                            return t.GetTypesNum();
-                                        },
-                                        [](const TypeLike auto&) -> size_t {
-                                            return 1;
-                                        }});
+    return GetComponents().size();
 }
 
-std::vector<Type> Type::GetComponents() const {
-    return this->Visit(util::Overloaded{[](const TupleType& t) -> std::vector<Type> {
-                                            return t.GetTupleTypes();
-                                        },
-                                        [this](const TypeLike auto&) -> std::vector<Type> {
-                                            return {*this};
-                                        }});
+std::span<const Type> Type::GetComponents() const {
+    const Entry& entry = GetEntry();
+    if (const auto* tuple = std::get_if<TupleType>(&entry.variant)) {
+        return tuple->GetTupleTypes();
+    }
+    return {&entry.self, 1};
 }
 
 size_t Type::GetParamNum() const {
-    return this->Visit(util::Overloaded{[](const FunctionType& t) -> size_t {
-                                            return t.GetParamNum();
-                                        },
-                                        [](const TypeLike auto&) -> size_t {
-                                            return 0;
-                                        }});
+    return GetEntry().param_num;
 }
 
 bool Type::IsValueType() const {
-    return this->Visit(util::Overloaded{[](const FunctionType& t) -> bool {
-                                            return t.IsValueType();
-                                        },
-                                        [](const TypeLike auto&) -> bool {
-                                            return true;
-                                        }});
-}
-
-std::vector<Type> Type::FlattenFunction() const {
-    return this->Visit(util::Overloaded{[](const FunctionType& t) -> std::vector<Type> {
-                                            std::vector<Type> types;
-                                            if (t.Source() != Type::Singleton()) {
-                                                types.push_back(t.Source());
-                                            }
-                                            types.insert_range(types.end(),
-                                                               t.Target().FlattenFunction());
-                                            return types;
-                                        },
-                                        [this](const TypeLike auto&) -> std::vector<Type> {
-                                            return {*this};
-                                        }});
+    return GetEntry().param_num == 0;
 }
 
-bool Type::IsTypeVar() const {
-    return Holds<CommonType>() && !GetVariant<CommonType>().HasTypeParams() && !IsConcrete();
+std::span<const Type> Type::FlattenFunction() const {
+    return GetEntry().flattened;
 }
 
-size_t Type::TypeVariantIndex() const {
-    return type_->index();
+bool Type::IsAuto() const {
+    return id_ == kAutoID;
 }
 
-Type Type::Pure() const {
-    std::vector<Type> types = FlattenFunction();
-    if (types.empty()) {
-        return Type::Singleton();
-    }
-    if (types.size() == 1) {
-        return types[0];
-    }
-    return Type::FunctionChain(types);
+bool Type::IsTypeVar() const {
+    return GetEntry().is_type_var;
 }
 
-bool Type::operator==(Type o) const {
-    // Because each type in storage is unique and never changes it's location
-    // we can just compare pointers
-    return type_ == o.type_;
+size_t Type::TypeVariantIndex() const {
+    return GetVariantPointer()->index();
 }
-bool Type::operator<(Type o) const {
-    return type_ < o.type_;
+
+Type Type::Pure() const {
+    return FunctionChainImpl(FlattenFunction());
 }
 
-TypeConstructor::TypeConstructor(std::string name, size_t num_params)
-    : name_(std::move(name)),
+TypeConstructor::TypeConstructor(Symbol name, size_t num_params)
+    : name_(name),
       num_params_(num_params) {
 }
 
 std::string TypeConstructor::ToString(Style) const {
+    return name_.GetName();
+}
+
+Symbol TypeConstructor::GetSymbol() const {
     return name_;
 }
 
@@ -313,37 +1055,39 @@ bool TypeConstructor::operator<(const TypeConstructor& o) const {
     if (num_params_ != o.num_params_) {
         return num_params_ < o.num_params_;
     }
-    return name_ < o.name_;
+    return name_.GetName() < o.name_.GetName();
 }
 
-CommonType::CommonType(std::string name, std::vector<Type> params)
-    : name_(std::move(name)),
-      params_(std::move(params)) {
-    assert(!name_.empty());
+std::string CommonType::ToString(Style style) const {
+    std::string res;
+    AppendTo(res, style);
+    return res;
 }
 
-std::string CommonType::ToString(Style style) const {
+void CommonType::AppendTo(std::string& out, Style style) const {
     if (style == Style::Debug) {
-        return ToStringDebug();
+        AppendDebug(out);
+        return;
     }
-    if (style == Style::Haskell && name_ == "S") {
-        return "()";
+    if (style == Style::Haskell && name_ == BuiltinSymbol::kSingleton) {
+        out += "()";
+        return;
     }
-    if (style == Style::Haskell && name_ == "Str") {
-        return "String";
+    if (style == Style::Haskell && name_ == BuiltinSymbol::kStr) {
+        out += "String";
+        return;
     }
 
-    std::string res = name_;
+    out += name_.GetName();
 
     for (const auto& param : params_) {
-        res += " " + util::Shield(param.ToString(style), param.ShouldBeShielded());
+        out += ' ';
+        AppendShielded(out, param, style);
     }
-
-    return res;
 }
 
 bool CommonType::IsConcrete() const {
-    if (std::islower(name_.front())) {
+    if (std::islower(name_.GetName().front())) {
         return false;
     }
 
@@ -359,15 +1103,15 @@ bool CommonType::ShouldBeShielded() const {
     return !params_.empty();
 }
 
-std::string CommonType::GetID() const {
-    return MakeID(name_, params_);
+const std::string& CommonType::GetName() const {
+    return name_.GetName();
 }
 
-const std::string& CommonType::GetName() const {
+Symbol CommonType::GetSymbol() const {
     return name_;
 }
 
-const std::vector<Type>& CommonType::GetTypeParams() const {
+std::span<const Type> CommonType::GetTypeParams() const {
     return params_;
 }
 
@@ -380,43 +1124,45 @@ bool CommonType::HasTypeParams() const {
 }
 
 bool CommonType::IsAuto() const {
-    return name_ == "auto";
+    return name_ == BuiltinSymbol::kAuto;
 }
 
 bool CommonType::operator==(const CommonType& o) const {
-    return name_ == o.name_ && util::VecEq(params_, o.params_);
+    return name_ == o.name_ && std::ranges::equal(params_, o.params_);
 }
 
-std::string CommonType::MakeID(const std::string& name, const std::vector<Type>& params) {
-    std::string id = name;
-    for (const auto& param : params) {
-        id += "_" + std::to_string(param.GetID());
-    }
-    return id;
-}
-
-std::string CommonType::ToStringDebug() const {
-    std::string res;
-    res += "Common{" + name_ + ":";
+void CommonType::AppendDebug(std::string& out) const {
+    out += "Common{";
+    out += name_.GetName();
+    out += ':';
     for (const auto& param : params_) {
-        res += " " + param.ToString(Style::Debug);
+        out += ' ';
+        param.AppendTo(out, Style::Debug);
     }
-    res += "}";
-    return res;
+    out += '}';
 }
 
-TupleType::TupleType(std::vector<Type> inner_types)
-    : inner_types_(std::move(inner_types)) {
+TupleType::TupleType(std::span<const Type> inner_types)
+    : inner_types_(inner_types) {
 }
 
 std::string TupleType::ToString(Style style) const {
+    std::string res;
+    AppendTo(res, style);
+    return res;
+}
+
+void TupleType::AppendTo(std::string& out, Style style) const {
     switch (style) {
         case Style::Komaru:
-            return ToStringKomaru();
+            AppendKomaru(out);
+            break;
         case Style::Haskell:
-            return ToStringHaskell();
+            AppendHaskell(out);
+            break;
         case Style::Debug:
-            return ToStringDebug();
+            AppendDebug(out);
+            break;
     }
 }
 
@@ -433,7 +1179,7 @@ bool TupleType::ShouldBeShielded() const {
     return false;
 }
 
-const std::vector<Type>& TupleType::GetTupleTypes() const {
+std::span<const Type> TupleType::GetTupleTypes() const {
     return inner_types_;
 }
 
@@ -441,81 +1187,60 @@ size_t TupleType::GetTypesNum() const {
     return inner_types_.size();
 }
 
-std::string TupleType::GetID() const {
-    return MakeID(inner_types_);
-}
-
 bool TupleType::operator==(const TupleType& o) const {
-    if (inner_types_.size() != o.inner_types_.size()) {
-        return false;
-    }
-    for (size_t i = 0; i < inner_types_.size(); ++i) {
-        if (inner_types_[i] != o.inner_types_[i]) {
-            return false;
-        }
-    }
-    return true;
-}
-
-std::string TupleType::MakeID(const std::vector<Type>& types) {
-    std::string id = "(";
-    for (size_t i = 0; i < types.size(); ++i) {
-        id += std::to_string(types[i].GetID());
-        if (i + 1 != types.size()) {
-            id += ",";
-        }
-    }
-    return id + ")";
+    return std::ranges::equal(inner_types_, o.inner_types_);
 }
 
-std::string TupleType::ToStringKomaru() const {
-    std::string res;
+void TupleType::AppendKomaru(std::string& out) const {
     for (size_t i = 0; i < inner_types_.size(); ++i) {
-        res += util::Shield(inner_types_[i].ToString(Style::Komaru),
-                            inner_types_[i].ShouldBeShielded());
+        AppendShielded(out, inner_types_[i], Style::Komaru);
         if (i + 1 != inner_types_.size()) {
-            res += " x ";
+            out += " x ";
         }
     }
-    return res;
 }
 
-std::string TupleType::ToStringHaskell() const {
-    std::string res = "(";
+void TupleType::AppendHaskell(std::string& out) const {
+    out += '(';
     for (size_t i = 0; i < inner_types_.size(); ++i) {
-        res += inner_types_[i].ToString(Style::Haskell);
+        inner_types_[i].AppendTo(out, Style::Haskell);
         if (i + 1 != inner_types_.size()) {
-            res += ", ";
+            out += ", ";
         }
     }
-    return res + ")";
+    out += ')';
 }
 
-std::string TupleType::ToStringDebug() const {
-    std::string res = "Tuple{";
+void TupleType::AppendDebug(std::string& out) const {
+    out += "Tuple{";
     for (size_t i = 0; i < inner_types_.size(); ++i) {
-        res += inner_types_[i].ToString(Style::Debug);
+        inner_types_[i].AppendTo(out, Style::Debug);
         if (i + 1 != inner_types_.size()) {
-            res += ", ";
+            out += ", ";
         }
     }
-    return res + "}";
+    out += '}';
 }
 
 FunctionType::FunctionType(Type source, Type target)
-    : source_(source),
-      target_(target) {
+    : source_and_target_({source, target}) {
 }
 
 std::string FunctionType::ToString(Style style) const {
+    std::string res;
+    AppendTo(res, style);
+    return res;
+}
+
+void FunctionType::AppendTo(std::string& out, Style style) const {
     if (style == Style::Haskell && Source() == Type::Singleton()) {
-        return Target().ToString(style);
+        Target().AppendTo(out, style);
+        return;
     }
 
-    std::string source_str = util::Shield(Source().ToString(style), Source().ShouldBeShielded());
-    std::string target_str = Target().ToString(style);
-
-    return std::format("{} -> {}", source_str, target_str);
+    AppendShielded(out, Source(), style);
+    out += " -> ";
+    Target().AppendTo(out, style);
 }
 
 bool FunctionType::IsConcrete() const {
@@ -526,23 +1251,23 @@ bool FunctionType::ShouldBeShielded() const {
     return true;
 }
 
-std::string FunctionType::GetID() const {
-    return MakeID(Source(), Target());
-}
-
 Type FunctionType::Source() const {
-    return source_;
+    return source_and_target_[0];
 }
 
 Type FunctionType::Target() const {
-    return target_;
+    return source_and_target_[1];
+}
+
+std::span<const Type> FunctionType::GetSourceAndTarget() const {
+    return source_and_target_;
 }
 
 size_t FunctionType::GetParamNum() const {
     if (Source() == Type::Singleton()) {
         return 0;
     }
-    return 1 + target_.GetParamNum();
+    return 1 + Target().GetParamNum();
 }
 
 bool FunctionType::IsValueType() const {
@@ -553,16 +1278,16 @@ bool FunctionType::operator==(const FunctionType& o) const {
     return Source() == o.Source() && Target() == o.Target();
 }
 
-std::string FunctionType::MakeID(Type source, Type target) {
-    return std::format("{} -> {}", source.GetID(), target.GetID());
-}
-
-ListType::ListType(Type inner_type)
-    : inner_type_(inner_type) {
+std::string ListType::ToString(Style style) const {
+    std::string res;
+    AppendTo(res, style);
+    return res;
 }
 
-std::string ListType::ToString(Style style) const {
-    return std::format("[{}]", inner_type_.ToString(style));
+void ListType::AppendTo(std::string& out, Style style) const {
+    out += '[';
+    inner_type_.AppendTo(out, style);
+    out += ']';
 }
 
 bool ListType::IsConcrete() const {
@@ -573,10 +1298,6 @@ bool ListType::ShouldBeShielded() const {
     return false;
 }
 
-std::string ListType::GetID() const {
-    return MakeID(inner_type_);
-}
-
 Type ListType::Inner() const {
     return inner_type_;
 }
@@ -585,8 +1306,35 @@ bool ListType::operator==(const ListType& o) const {
     return inner_type_ == o.inner_type_;
 }
 
-std::string ListType::MakeID(Type inner_type) {
-    return std::format("[{}]", inner_type.GetID());
+TypeKey::TypeKey(size_t kind, Symbol name, std::span<const Type> children)
+    : kind_(kind),
+      name_(name),
+      children_(children),
+      hash_(util::HashCombine(kind, name.GetID())) {
+    for (Type child : children_) {
+        hash_ = util::HashCombine(hash_, child.GetID());
+    }
+}
+
+size_t TypeKey::GetKind() const {
+    return kind_;
+}
+
+Symbol TypeKey::GetName() const {
+    return name_;
+}
+
+std::span<const Type> TypeKey::GetChildren() const {
+    return children_;
+}
+
+size_t TypeKey::GetHash() const {
+    return hash_;
+}
+
+bool TypeKey::operator==(const TypeKey& o) const {
+    return hash_ == o.hash_ && kind_ == o.kind_ && name_ == o.name_ &&
+           std::ranges::equal(children_, o.children_);
 }
 
 Type operator*(Type t1, Type t2) {
@@ -629,13 +1377,31 @@ bool IsConcreteTypeName(const std::string& name) {
     return true;
 }
 
+namespace {
+
+util::SmallVector<std::pair<size_t, Type>, 4> ToArgTypes(const std::map<size_t, Type>& arg_mapping) {
+    util::SmallVector<std::pair<size_t, Type>, 4> arg_types;
+    arg_types.reserve(arg_mapping.size());
+    for (const auto& [pos, type] : arg_mapping) {
+        arg_types.emplace_back(pos, type);
+    }
+    return arg_types;
+}
+
+}  // namespace
+
 std::optional<Type> TryDeduceTypes(Type func_type, Type arg_type) {
-    return TryDeduceTypes(func_type, std::map<size_t, Type>{{0, arg_type}});
+    std::pair<size_t, Type> arg{0, arg_type};
+    return TryDeduceTypes(func_type, ArgTypes(&arg, 1));
 }
 
 std::optional<Type> TryDeduceTypes(Type func_type, const std::map<size_t, Type>& arg_mapping) {
+    return TryDeduceTypes(func_type, ToArgTypes(arg_mapping));
+}
+
+std::optional<Type> TryDeduceTypes(Type func_type, ArgTypes arg_types) {
     if (func_type.IsValueType()) {
-        if (arg_mapping.size() == 1 && arg_mapping.begin()->second == Type::Singleton()) {
+        if (arg_types.size() == 1 && arg_types.front().second == Type::Singleton()) {
             return func_type;
         }
         return std::nullopt;
@@ -648,17 +1414,18 @@ std::optional<Type> TryDeduceTypes(Type func_type, const std::map<size_t, Type>&
     auto types = func_type.FlattenFunction();
     MatchMap match_map;
 
-    for (size_t i = 0; i < types.size(); ++i) {
-        auto it = arg_mapping.find(i);
-        if (it != arg_mapping.end()) {
-            auto maybe_mapping = TryMatchTypes(types[i], it->second);
-            if (!maybe_mapping) {
-                return std::nullopt;
-            }
+    for (const auto& [pos, arg_type] : arg_types) {
+        if (pos >= types.size()) {
+            break;
+        }
 
-            if (!MergeMatchMaps(match_map, maybe_mapping.value())) {
-                return std::nullopt;
-            }
+        auto maybe_mapping = TryMatchTypes(types[pos], arg_type);
+        if (!maybe_mapping) {
+            return std::nullopt;
+        }
+
+        if (!MergeMatchMaps(match_map, maybe_mapping.value())) {
+            return std::nullopt;
         }
     }
 
@@ -674,7 +1441,11 @@ Type DeduceTypes(Type func_type, Type arg_type) {
 }
 
 Type DeduceTypes(Type func_type, const std::map<size_t, Type>& arg_mapping) {
-    if (auto deduced = TryDeduceTypes(func_type, arg_mapping)) {
+    return DeduceTypes(func_type, ToArgTypes(arg_mapping));
+}
+
+Type DeduceTypes(Type func_type, ArgTypes arg_types) {
+    if (auto deduced = TryDeduceTypes(func_type, arg_types)) {
         return deduced.value();
     }
 
@@ -682,14 +1453,18 @@ Type DeduceTypes(Type func_type, const std::map<size_t, Type>& arg_mapping) {
 }
 
 std::optional<Type> TryMakeSubstitution(Type func_type, const std::map<size_t, Type>& arg_mapping) {
+    return TryMakeSubstitution(func_type, ToArgTypes(arg_mapping));
+}
+
+std::optional<Type> TryMakeSubstitution(Type func_type, ArgTypes arg_types) {
     if (func_type.IsValueType()) {
-        if (arg_mapping.size() == 1 && arg_mapping.begin()->second == Type::Singleton()) {
+        if (arg_types.size() == 1 && arg_types.front().second == Type::Singleton()) {
             return func_type.FlattenFunction()[0];
         }
         return std::nullopt;
     }
 
-    auto maybe_func_type = TryDeduceTypes(func_type, arg_mapping);
+    auto maybe_func_type = TryDeduceTypes(func_type, arg_types);
     if (!maybe_func_type) {
         return std::nullopt;
     }
@@ -699,15 +1474,18 @@ std::optional<Type> TryMakeSubstitution(Type func_type, const std::map<size_t, T
     auto types = func_type.FlattenFunction();
     std::vector<Type> new_types;
 
+    auto bound = arg_types.begin();
     for (size_t i = 0; i + 1 < types.size(); ++i) {
-        if (!arg_mapping.contains(i)) {
+        if (bound != arg_types.end() && bound->first == i) {
+            ++bound;
+        } else {
             new_types.push_back(types[i]);
         }
     }
 
     new_types.push_back(types.back());
 
-    if (arg_mapping.size() + new_types.size() != types.size()) {
+    if (arg_types.size() + new_types.size() != types.size()) {
         return std::nullopt;
     }
 
@@ -737,6 +1515,108 @@ Type MakeSubstitution(Type func_type, const std::map<size_t, Type>& arg_mapping)
     return new_type;
 }
 
+namespace {
+
+// Direct-mapped table: a new entry simply evicts whatever was in its slot
+template <typename K, typename V>
+class MemoTable {
+public:
+    explicit MemoTable(size_t capacity)
+        : slots_(std::bit_ceil(std::max<size_t>(capacity, 1))) {
+    }
+
+    const V* Find(const K& key, size_t hash) {
+        auto& slot = slots_[hash & (slots_.size() - 1)];
+        if (slot.has_value() && slot->first == key) {
+            ++hits_;
+            return &slot->second;
+        }
+        ++misses_;
+        return nullptr;
+    }
+
+    void Insert(K key, size_t hash, V value) {
+        slots_[hash & (slots_.size() - 1)].emplace(std::move(key), std::move(value));
+    }
+
+    void Clear() {
+        std::ranges::fill(slots_, std::nullopt);
+    }
+
+    size_t GetHits() const {
+        return hits_;
+    }
+
+    size_t GetMisses() const {
+        return misses_;
+    }
+
+private:
+    std::vector<std::optional<std::pair<K, V>>> slots_;
+    size_t hits_{0};
+    size_t misses_{0};
+};
+
+struct MatchCaches {
+    explicit MatchCaches(size_t capacity)
+        : match(capacity),
+          substitution(capacity) {
+    }
+
+    MemoTable<std::pair<Type, Type>, std::optional<MatchMap>> match;
+    MemoTable<std::pair<Type, MatchMap>, Type> substitution;
+    // Ids of released types are reused, so results are only valid within one epoch
+    uint64_t epoch{release_epoch.load(std::memory_order_relaxed)};
+};
+
+constexpr size_t kDefaultMatchCacheCapacity = 1024;
+
+// Per thread, so types can be matched from several threads without locking
+MatchCaches& GetMatchCaches() {
+    thread_local MatchCaches caches(kDefaultMatchCacheCapacity);
+
+    uint64_t epoch = release_epoch.load(std::memory_order_relaxed);
+    if (caches.epoch != epoch) {
+        caches.match.Clear();
+        caches.substitution.Clear();
+        caches.epoch = epoch;
+    }
+    return caches;
+}
+
+size_t HashMatchMap(const MatchMap& mapping) {
+    size_t hash = mapping.size();
+    for (const auto& [type_var_name, type_or_constructor] : mapping) {
+        hash = util::HashCombine(hash, type_var_name.GetID());
+        hash = util::HashCombine(
+            hash, std::visit(util::Overloaded{[](Type t) -> size_t {
+                                                  return t.GetID();
+                                              },
+                                              [](const TypeConstructor& c) -> size_t {
+                                                  return util::HashCombine(c.GetSymbol().GetID(),
+                                                                           c.GetNumParams());
+                                              }},
+                             type_or_constructor));
+    }
+    return hash;
+}
+
+}  // namespace
+
+MatchCacheStats GetMatchCacheStats() {
+    const auto& caches = GetMatchCaches();
+    return MatchCacheStats{
+        .match_hits = caches.match.GetHits(),
+        .match_misses = caches.match.GetMisses(),
+        .substitution_hits = caches.substitution.GetHits(),
+        .substitution_misses = caches.substitution.GetMisses(),
+    };
+}
+
+void ResetMatchCache(size_t capacity) {
+    GetMatchCaches() = MatchCaches(capacity);
+}
+
 std::optional<MatchMap> TryMatchTypes(const CommonType& param_type, const CommonType& arg_type) {
     if (param_type.IsAuto()) {
         return MatchMap{};
@@ -750,15 +1630,15 @@ std::optional<MatchMap> TryMatchTypes(const CommonType& param_type, const Common
     bool is_arg_name_concrete = IsConcreteTypeName(arg_type.GetName());
 
     if (is_param_name_concrete && is_arg_name_concrete &&
-        param_type.GetName() != arg_type.GetName()) {
+        param_type.GetSymbol() != arg_type.GetSymbol()) {
         return std::nullopt;
     }
 
     MatchMap mapping;
 
     if (!is_param_name_concrete && is_arg_name_concrete) {
-        mapping.emplace(param_type.GetName(),
-                        TypeConstructor(arg_type.GetName(), arg_type.NumTypeParams()));
+        mapping.emplace(param_type.GetSymbol(),
+                        TypeConstructor(arg_type.GetSymbol(), arg_type.NumTypeParams()));
     }
 
     for (size_t i = 0; i < param_type.NumTypeParams(); ++i) {
@@ -791,7 +1671,7 @@ std::optional<MatchMap> TryMatchTypes(const CommonType& param_type, const ListTy
     }
 
     if (param_type.NumTypeParams() == 0) {
-        return MatchMap{{param_type.GetName(), lang::Type(arg_type)}};
+        return MatchMap{{param_type.GetSymbol(), lang::Type(arg_type)}};
     }
     if (param_type.NumTypeParams() == 1) {
         auto maybe_match_map = TryMatchTypes(param_type.GetTypeParams()[0], arg_type.Inner());
@@ -800,7 +1680,7 @@ std::optional<MatchMap> TryMatchTypes(const CommonType& param_type, const ListTy
         }
         auto match_map = std::move(maybe_match_map.value());
         if (!MergeMatchMaps(match_map,
-                            MatchMap{{param_type.GetName(), TypeConstructor("[]", 1)}})) {
+                            MatchMap{{param_type.GetSymbol(), TypeConstructor("[]", 1)}})) {
             return std::nullopt;
         }
         return match_map;
@@ -867,15 +1747,15 @@ std::optional<MatchMap> TryMatchTypes(const ListType& param_type, const ListType
     return mapping.value();
 }
 
-std::optional<MatchMap> TryMatchTypes(Type param_type, Type arg_type) {
+static std::optional<MatchMap> TryMatchTypesUncached(Type param_type, Type arg_type) {
     MatchMap mapping;
 
-    if (param_type == Type::Auto() || arg_type.IsTypeVar()) {
+    if (param_type.IsAuto() || arg_type.IsTypeVar()) {
         return mapping;
     }
 
     if (param_type.IsTypeVar()) {
-        mapping.emplace(param_type.ToString(), arg_type);
+        mapping.emplace(param_type.GetVariant<CommonType>().GetSymbol(), arg_type);
         return mapping;
     }
 
@@ -894,6 +1774,25 @@ std::optional<MatchMap> TryMatchTypes(Type param_type, Type arg_type) {
         });
 }
 
+std::optional<MatchMap> TryMatchTypes(Type param_type, Type arg_type) {
+    // Identical types match without binding anything
+    if (param_type == arg_type) {
+        return MatchMap{};
+    }
+
+    auto& cache = GetMatchCaches().match;
+    std::pair key(param_type, arg_type);
+    size_t hash = util::HashCombine(param_type.GetID(), arg_type.GetID());
+
+    if (const auto* cached = cache.Find(key, hash)) {
+        return *cached;
+    }
+
+    auto result = TryMatchTypesUncached(param_type, arg_type);
+    cache.Insert(key, hash, result);
+    return result;
+}
+
 MatchMap MatchTypes(Type param_type, Type arg_type) {
     auto mapping = TryMatchTypes(param_type, arg_type);
     if (!mapping) {
@@ -904,15 +1803,15 @@ MatchMap MatchTypes(Type param_type, Type arg_type) {
 }
 
 Type ApplyMatchMap(const CommonType& type, const MatchMap& mapping) {
-    std::string new_name = type.GetName();
+    Symbol new_name = type.GetSymbol();
 
-    auto it = mapping.find(type.GetName());
+    auto it = mapping.find(new_name);
     if (it != mapping.end()) {
         if (std::holds_alternative<Type>(it->second)) {
             assert(type.NumTypeParams() == 0);
             return std::get<Type>(it->second);
         } else {
-            new_name = std::get<TypeConstructor>(it->second).ToString();
+            new_name = std::get<TypeConstructor>(it->second).GetSymbol();
         }
     }
 
@@ -921,7 +1820,7 @@ Type ApplyMatchMap(const CommonType& type, const MatchMap& mapping) {
         new_params.push_back(ApplyMatchMap(param, mapping));
     }
 
-    return Type::Parameterized(std::move(new_name), std::move(new_params));
+    return Type::Parameterized(new_name, std::move(new_params));
 }
 
 Type ApplyMatchMap(const TupleType& type, const MatchMap& mapping) {
@@ -943,9 +1842,23 @@ Type ApplyMatchMap(const ListType& type, const MatchMap& mapping) {
 }
 
 Type ApplyMatchMap(Type type, const MatchMap& mapping) {
-    return type.Visit([&]<TypeLike T>(const T& unboxed_type) -> Type {
+    if (mapping.empty()) {
+        return type;
+    }
+
+    auto& cache = GetMatchCaches().substitution;
+    std::pair key(type, mapping);
+    size_t hash = util::HashCombine(type.GetID(), HashMatchMap(mapping));
+
+    if (const auto* cached = cache.Find(key, hash)) {
+        return *cached;
+    }
+
+    Type result = type.Visit([&]<TypeLike T>(const T& unboxed_type) -> Type {
         return ApplyMatchMap(unboxed_type, mapping);
     });
+    cache.Insert(std::move(key), hash, result);
+    return result;
 }
 
 bool CanBeSubstituted(Type param_type, Type arg_type, const MatchMap& mapping) {
@@ -960,7 +1873,8 @@ bool CanBeSubstituted(Type param_type, Type arg_type, const MatchMap& mapping) {
 
 Type CurryFunction(Type source, Type target) {
     return source.Visit(util::Overloaded{[&](const TupleType& t) -> Type {
-                                             std::vector<Type> new_types = t.GetTupleTypes();
+                                             std::vector<Type> new_types(t.GetTupleTypes().begin(),
+                                                                         t.GetTupleTypes().end());
                                              new_types.push_back(target);
                                              return Type::FunctionChain(new_types);
                                          },
@@ -3,17 +3,32 @@
 #include <komaru/util/non_copyable_non_movable.hpp>
 #include <komaru/util/derive_variant.hpp>
 #include <komaru/lang/style.hpp>
-
+#include <komaru/lang/symbol.hpp>
+#include <komaru/util/flat_map.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <bit>
+#include <format>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <span>
+#include <array>
 #include <variant>
 #include <vector>
 #include <deque>
 #include <map>
+#include <memory>
+#include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace komaru::lang {
 
 class Type;
+class TypeKey;
+class TypeUniverse;
 
 class CommonType;    // Int, Char, Either Int Char, Maybe Char, ...
 class TupleType;     // (A, B, C)
@@ -32,8 +47,8 @@ class Type : public util::DeriveVariant<Type> {
     using Variant = std::variant<CommonType, TupleType, FunctionType, ListType>;
 
 public:
-    Type()
-        : type_(Type::Auto().GetVariantPointer()) {
+    constexpr Type()
+        : id_(kAutoID) {
     }
 
     explicit Type(const CommonType& type);
@@ -46,7 +61,7 @@ public:
 
     static Type Common(std::string name);
     static Type Simple(std::string name);
-    static Type Parameterized(std::string name, std::vector<Type> params);
+    static Type Parameterized(Symbol name, std::vector<Type> params);
     static Type Tuple(std::vector<Type> types);
     static Type TupleFromSimples(std::vector<std::string> names);
     static Type Function(Type source, Type target);
@@ -54,111 +69,186 @@ public:
     static Type Var(std::string name);
     static Type List(Type inner_type);
 
-    static Type Auto();
-    static Type Singleton();
-    static Type Int();
-    static Type Float();
-    static Type Double();
-    static Type Char();
-    static Type Bool();
-    static Type String();
+    static constexpr Type Auto();
+    static constexpr Type Singleton();
+    static constexpr Type Int();
+    static constexpr Type Float();
+    static constexpr Type Double();
+    static constexpr Type Char();
+    static constexpr Type Bool();
+    static constexpr Type String();
 
     std::string ToString(Style style = Style::Komaru) const;
+    // Rendered once per style and kept next to the type, valid for as long as the type is
+    std::string_view ToStringView(Style style = Style::Komaru) const;
+    void AppendTo(std::string& out, Style style = Style::Komaru) const;
     bool IsConcrete() const;
     bool ShouldBeShielded() const;
-    std::uintptr_t GetID() const;
+    uint32_t GetID() const;
     Type Pow(size_t n) const;
     size_t GetComponentsNum() const;
-    std::vector<Type> GetComponents() const;
+    // Tuple elements or the type itself
+    std::span<const Type> GetComponents() const;
     size_t GetParamNum() const;
     bool IsValueType() const;
-    std::vector<Type> FlattenFunction() const;
+    // Parameters followed by the result, the type itself for non-functions
+    std::span<const Type> FlattenFunction() const;
+    bool IsAuto() const;
     bool IsTypeVar() const;
     size_t TypeVariantIndex() const;
     Type Pure() const;
 
-    bool operator==(Type o) const;
-    bool operator<(Type o) const;  // Used for containers like std::map
+    // Because each type in storage is unique we can just compare ids
+    constexpr bool operator==(Type o) const {
+        return id_ == o.id_;
+    }
+    // Used for containers like std::map
+    constexpr bool operator<(Type o) const {
+        return id_ < o.id_;
+    }
 
     // For CRTP
     const Variant* GetVariantPointer() const;
 
 private:
-    explicit Type(const Variant* type);
+    friend class TypeUniverse;
+    friend class PinnedTypes;
 
-    template <typename T>
-    static Type::Variant* MakeType(const T& type);
+    constexpr explicit Type(uint32_t id)
+        : id_(id) {
+    }
+
+    // Interned type together with its properties computed once at interning
+    struct Entry;
+    const Entry& GetEntry() const;
 
-    static std::deque<Variant>& GetStorage();
-    static std::unordered_map<std::string, Variant*>& GetIndex();
+    static uint32_t Intern(const TypeKey& key);
+    template <typename T>
+    static TypeKey MakeKey(const T& type);
+    template <typename T>
+    static std::pair<Symbol, std::span<const Type>> GetNameAndChildren(const T& type);
+    static bool KeyMatches(const TypeKey& key, const Variant& type);
+
+    // Types are interned into kShardsNum independently locked shards chosen by key hash,
+    // so types can be created from several threads at once.
+    // Id of a type is its index inside the shard followed by the shard's index.
+    struct Shard;
+    static constexpr size_t kShardsNum = 64;
+    // As many as let every id fit in 32 bits below the max value, which shards reserve
+    static constexpr size_t kChunksNum = 26;
+    static_assert(((size_t{1} << kChunksNum) - 1) * kShardsNum <=
+                  std::numeric_limits<uint32_t>::max());
+    static constexpr size_t kStylesNum = 3;
+
+    // Builtins are constant-initialized into the first slots of the first shards,
+    // so their ids are known at compile time and never released
+    enum BuiltinID : uint32_t {
+        kAutoID,
+        kSingletonID,
+        kIntID,
+        kFloatID,
+        kDoubleID,
+        kCharID,
+        kBoolID,
+        kStringID,
+        kIOSingletonID,
+        kBuiltinsNum,
+    };
+    static_assert(kBuiltinsNum <= kShardsNum);
+
+    static std::array<Entry, kBuiltinsNum> builtins_;
+
+    static size_t GetShardIdx(const TypeKey& key);
+    static Shard& GetShard(size_t shard_idx);
+    static void Release(uint32_t generation);
+    static size_t CountTypes(uint32_t generation);
+    static size_t CountAllTypes();
+    static std::span<const Type> GetChildren(const Entry& entry);
+
+    // Lifetime of a type handed out to a universe, see TypeUniverse. Taking a type of another
+    // universe or an unpinned one takes the pins mutex, which the rest must be called with.
+    static bool IsHeld(Type type, uint32_t generation, TypeUniverse* universe);
+    static void Hold(Type type, TypeUniverse* universe);
+    static void Pin(Type type);
+    static void Unpin(Type type);
+    static void Promote(Type type);
+    static std::string_view StoreRendered(const Entry& entry, Style style, std::string_view text);
+
+    // Chunk i of a shard holds its types [2^i - 1, 2^(i + 1) - 1). Chunks are never moved
+    // and the table is constant-initialized, so a type is read by id without locks or guards.
+    static std::array<std::array<std::atomic<Entry*>, kChunksNum>, kShardsNum> chunks_;
 
 private:
-    const Variant* type_{nullptr};
+    uint32_t id_;
 };
 
 class TypeConstructor {
 public:
-    TypeConstructor(std::string name, size_t num_params);
+    TypeConstructor(Symbol name, size_t num_params);
 
     std::string ToString(Style style = Style::Komaru) const;
+    Symbol GetSymbol() const;
     size_t GetNumParams() const;
 
     bool operator==(const TypeConstructor& o) const;
     bool operator<(const TypeConstructor& o) const;
 
 private:
-    std::string name_;
+    Symbol name_;
     size_t num_params_;
 };
 
+// Type parameters and tuple elements are views into the type store,
+// which keeps them alive for as long as the types themselves
 class CommonType {
 public:
-    explicit CommonType(std::string name, std::vector<Type> params);
+    constexpr explicit CommonType(Symbol name, std::span<const Type> params)
+        : name_(name),
+          params_(params) {
+        assert(!name_.IsEmpty());
+    }
 
     std::string ToString(Style style = Style::Komaru) const;
+    void AppendTo(std::string& out, Style style) const;
     bool IsConcrete() const;
     bool ShouldBeShielded() const;
-    std::string GetID() const;
     const std::string& GetName() const;
-    const std::vector<Type>& GetTypeParams() const;
+    Symbol GetSymbol() const;
+    std::span<const Type> GetTypeParams() const;
     size_t NumTypeParams() const;
     bool HasTypeParams() const;
     bool IsAuto() const;
 
     bool operator==(const CommonType& o) const;
 
-    static std::string MakeID(const std::string& name, const std::vector<Type>& params);
-
 private:
-    std::string ToStringDebug() const;
+    void AppendDebug(std::string& out) const;
 
 private:
-    std::string name_;
-    std::vector<Type> params_;
+    Symbol name_;
+    std::span<const Type> params_;
 };
 
 class TupleType {
 public:
-    explicit TupleType(std::vector<Type> inner_types);
+    explicit TupleType(std::span<const Type> inner_types);
 
     std::string ToString(Style style = Style::Komaru) const;
+    void AppendTo(std::string& out, Style style) const;
     bool IsConcrete() const;
     bool ShouldBeShielded() const;
-    std::string GetID() const;
-    const std::vector<Type>& GetTupleTypes() const;
+    std::span<const Type> GetTupleTypes() const;
     size_t GetTypesNum() const;
 
     bool operator==(const TupleType& o) const;
 
-    static std::string MakeID(const std::vector<Type>& types);
-
 private:
-    std::string ToStringKomaru() const;
-    std::string ToStringHaskell() const;
-    std::string ToStringDebug() const;
+    void AppendKomaru(std::string& out) const;
+    void AppendHaskell(std::string& out) const;
+    void AppendDebug(std::string& out) const;
 
 private:
-    std::vector<Type> inner_types_;
+    std::span<const Type> inner_types_;
 };
 
 class FunctionType {
@@ -166,38 +256,38 @@ public:
     FunctionType(Type source, Type target);
 
     std::string ToString(Style style = Style::Komaru) const;
+    void AppendTo(std::string& out, Style style) const;
     bool IsConcrete() const;
     bool ShouldBeShielded() const;
-    std::string GetID() const;
     Type Source() const;
     Type Target() const;
+    std::span<const Type> GetSourceAndTarget() const;
     size_t GetParamNum() const;
     bool IsValueType() const;
 
     bool operator==(const FunctionType& o) const;
 
-    static std::string MakeID(Type source, Type target);
-
 private:
-    Type source_;
-    Type target_;
+    std::array<Type, 2> source_and_target_;
 };
 
 class ListType {
 public:
-    explicit ListType(Type inner_type);
+    constexpr explicit ListType(Type inner_type)
+        : inner_type_(inner_type) {
+    }
 
     std::string ToString(Style style = Style::Komaru) const;
+    void AppendTo(std::string& out, Style style) const;
     bool IsConcrete() const;
     bool ShouldBeShielded() const;
-    std::string GetID() const;
     Type Inner() const;
 
     bool operator==(const ListType& o) const;
 
-    static std::string MakeID(Type inner_type);
-
 private:
+    friend class Type;  // Type::GetNameAndChildren views inner_type_ as a one-element span
+
     Type inner_type_;
 };
 
@@ -208,16 +298,192 @@ static_assert(TypeLike<ListType>);
 
 static_assert(TypeLike<Type>);
 
-using MatchMap = std::map<std::string, std::variant<Type, TypeConstructor>>;
+struct Type::Entry {
+    Variant variant;
+    Type self;
+    bool is_concrete;
+    bool should_be_shielded;
+    bool is_type_var;
+    uint32_t param_num;
+    // Only changes to the permanent one, see TypeUniverse
+    uint32_t generation;
+    // Changed under the shard's lock with the pins mutex held
+    mutable uint32_t pins_num{0};
+    // Views either the type's own data or self
+    std::span<const Type> flattened;
+    // Filled on first use under the shard's lock, read through std::atomic_ref
+    mutable std::array<const std::string_view*, kStylesNum> rendered{};
+};
+
+inline const Type::Entry& Type::GetEntry() const {
+    size_t n = id_ / kShardsNum + 1;
+    size_t chunk_idx = std::bit_width(n) - 1;
+    return chunks_[id_ % kShardsNum][chunk_idx].load(std::memory_order_acquire)
+        [n - (size_t{1} << chunk_idx)];
+}
+
+inline const Type::Variant* Type::GetVariantPointer() const {
+    return &GetEntry().variant;
+}
+
+constexpr Type Type::Auto() {
+    return Type(kAutoID);
+}
+
+constexpr Type Type::Singleton() {
+    return Type(kSingletonID);
+}
+
+constexpr Type Type::Int() {
+    return Type(kIntID);
+}
+
+constexpr Type Type::Float() {
+    return Type(kFloatID);
+}
+
+constexpr Type Type::Double() {
+    return Type(kDoubleID);
+}
+
+constexpr Type Type::Char() {
+    return Type(kCharID);
+}
+
+constexpr Type Type::Bool() {
+    return Type(kBoolID);
+}
+
+constexpr Type Type::String() {
+    return Type(kStringID);
+}
+
+// Pins of types kept past the universe they were made in, e.g. by a cache. Pins are counted,
+// a type is pinned once per holder and unpinned when the holder drops it. A type unpinned
+// while a universe is open on the thread stays alive until that universe is released, so
+// whatever was handed out of the holder during it is still valid.
+class PinnedTypes {
+public:
+    PinnedTypes() = default;
+    PinnedTypes(const PinnedTypes& other);
+    PinnedTypes(PinnedTypes&& other) noexcept;
+    PinnedTypes& operator=(PinnedTypes other) noexcept;
+    ~PinnedTypes();
+
+    // Pins the type and the types it's built of, permanent ones need no pins
+    void Add(Type type);
+    void Clear();
+    bool IsEmpty() const;
+
+private:
+    friend class TypeUniverse;
+
+    std::unordered_set<uint32_t> ids_;
+};
+
+// Generation of the type store. Types created while a universe is open belong to it and are
+// released together with it, so a long-running process doesn't keep types of programs it
+// has already forgotten. A universe is current on the thread that opened it, so independent
+// cooks may run on separate threads. Tasks of a cook on other threads enter its universe
+// with Scope and must be done before it's released.
+// Types of other universes, found by interning or used to build new ones, are borrowed:
+// they are pinned until this universe is released too. Types outside of any universe, as
+// well as the builtins (Int, Bool, S, IO S, ...), are permanent. Using a type of a released
+// universe is a use-after-free, so whatever keeps types past the current universe has to pin
+// them with PinnedTypes.
+class TypeUniverse : public util::NonCopyableNonMovable {
+public:
+    static constexpr uint32_t kPermanentGeneration = 0;
+
+    // Becomes the current universe of the thread until destroyed
+    TypeUniverse();
+    ~TypeUniverse();
+
+    uint32_t GetGeneration() const;
+    // Types created in the universe, the pinned ones included until it's released
+    size_t GetTypesNum() const;
+    // Types alive in the whole store, permanent ones included
+    static size_t GetAllTypesNum();
+
+    // Current universe of the thread, nullptr outside of universes
+    static TypeUniverse* Current();
+    // Keeps the types alive until the current universe is released, e.g. the ones handed out
+    // of a cache entry that may be dropped meanwhile. Outside of universes they're made
+    // permanent.
+    static void Keep(std::shared_ptr<const PinnedTypes> pins);
+
+    // Makes `universe` current on this thread while alive, e.g. for thread pool tasks
+    class Scope : public util::NonCopyableNonMovable {
+    public:
+        explicit Scope(TypeUniverse* universe);
+        ~Scope();
+
+    private:
+        TypeUniverse* previous_;
+    };
+
+    // Makes every type interned on this thread while it's alive permanent, new or already
+    // existing, e.g. for symbols of libraries
+    class PermanentScope : public util::NonCopyableNonMovable {
+    public:
+        PermanentScope();
+        ~PermanentScope();
+    };
+
+private:
+    friend class Type;
+    friend class PinnedTypes;
+
+    bool IsBorrowed(uint32_t id) const;
+    // Returns false if it's already borrowed
+    bool Borrow(uint32_t id);
+
+private:
+    uint32_t generation_;
+    TypeUniverse* previous_;
+    // Pins dropped while it's closing are dropped for real
+    bool is_closing_{false};
+    mutable std::shared_mutex mutex_;
+    std::unordered_set<uint32_t> borrowed_;
+    std::unordered_map<const PinnedTypes*, std::shared_ptr<const PinnedTypes>> kept_;
+};
+
+// Structural identity of an interned type: variant kind, name and child types.
+// It only views the data it describes, so probing the index with it never allocates.
+class TypeKey {
+public:
+    TypeKey(size_t kind, Symbol name, std::span<const Type> children);
+
+    size_t GetKind() const;
+    Symbol GetName() const;
+    std::span<const Type> GetChildren() const;
+    size_t GetHash() const;
+
+    bool operator==(const TypeKey& o) const;
+
+private:
+    size_t kind_;
+    Symbol name_;
+    std::span<const Type> children_;
+    size_t hash_;
+};
+
+// Type variable -> type or type constructor it is bound to
+using MatchMap = util::FlatMap<Symbol, std::variant<Type, TypeConstructor>>;
+// Argument position -> argument type, sorted by position
+using ArgTypes = std::span<const std::pair<size_t, Type>>;
 
 Type operator*(Type t1, Type t2);
 bool IsConcreteTypeName(const std::string& name);
 std::optional<Type> TryDeduceTypes(Type func_type, Type arg_type);
 std::optional<Type> TryDeduceTypes(Type func_type, const std::map<size_t, Type>& arg_mapping);
+std::optional<Type> TryDeduceTypes(Type func_type, ArgTypes arg_types);
 Type DeduceTypes(Type func_type, Type arg_type);
 Type DeduceTypes(Type func_type, const std::map<size_t, Type>& arg_mapping);
+Type DeduceTypes(Type func_type, ArgTypes arg_types);
 // It will automatically deduce types too
 std::optional<Type> TryMakeSubstitution(Type func_type, const std::map<size_t, Type>& arg_mapping);
+std::optional<Type> TryMakeSubstitution(Type func_type, ArgTypes arg_types);
 Type MakeSubstitution(Type func_type, const std::map<size_t, Type>& arg_mapping);
 [[nodiscard]] bool MergeMatchMaps(MatchMap& mapping, const MatchMap& sub_mapping);
 std::optional<MatchMap> TryMatchTypes(Type param_type, Type arg_type);
@@ -228,8 +494,27 @@ Type CurryFunction(Type source, Type target);
 std::string ArgMappingToString(const std::map<size_t, Type>& arg_mapping);
 std::optional<Type> FindCommonType(const std::vector<Type>& types);
 
+// TryMatchTypes and ApplyMatchMap results are memoized per thread in bounded tables
+struct MatchCacheStats {
+    size_t match_hits{0};
+    size_t match_misses{0};
+    size_t substitution_hits{0};
+    size_t substitution_misses{0};
+};
+
+MatchCacheStats GetMatchCacheStats();
+// Drops the calling thread's memoized results and counters
+void ResetMatchCache(size_t capacity);
+
 }  // namespace komaru::lang
 
+template <>
+struct std::hash<komaru::lang::TypeKey> {
+    std::size_t operator()(const komaru::lang::TypeKey& key) const noexcept {
+        return key.GetHash();
+    }
+};
+
 template <>
 struct std::hash<komaru::lang::Type> {
     std::size_t operator()(const komaru::lang::Type& t) const noexcept {
@@ -237,6 +522,13 @@ struct std::hash<komaru::lang::Type> {
     }
 };
 
+template <>
+struct std::formatter<komaru::lang::Type> : std::formatter<std::string_view> {
+    auto format(komaru::lang::Type type, std::format_context& ctx) const {
+        return std::formatter<std::string_view>::format(type.ToStringView(), ctx);
+    }
+};
+
 template <>
 struct std::hash<const komaru::lang::Type> {
     std::size_t operator()(const komaru::lang::Type& t) const noexcept {
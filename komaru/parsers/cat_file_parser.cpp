@@ -0,0 +1,464 @@
+#include "cat_file_parser.hpp"
+
+#include <komaru/util/filesystem.hpp>
+#include <komaru/util/std_extensions.hpp>
+#include <komaru/util/string.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <format>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+namespace komaru::parsers {
+
+using NodeID = translate::RawCatProgram::NodeID;
+
+namespace {
+
+void AppendUtf8(std::string& s, uint32_t code_point) {
+    if (code_point < 0x80) {
+        s.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        s.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        s.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        s.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        s.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        s.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        s.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+bool IsSurrogate(uint32_t code_point, uint32_t first) {
+    return code_point >= first && code_point < first + 0x400;
+}
+
+bool CanBeInScalar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '-' || c == '.';
+}
+
+}  // namespace
+
+CatFileParser::CatFileParser(std::string_view json)
+    : json_(json) {
+}
+
+ParserResult<CatFile> CatFileParser::Parse() {
+    try {
+        ParseRoot();
+        if (Peek() != '\0') {
+            Fail("expected end of file");
+        }
+        MakeConnections();
+    } catch (std::exception& e) {
+        return MakeParserError(std::format("error while parsing .cat file: {}", e.what()));
+    }
+
+    return std::move(file_);
+}
+
+void CatFileParser::ParseRoot() {
+    ParseObject([&](std::string_view key) {
+        if (key == "nodes") {
+            ParseArray([&]() {
+                ParseNode();
+            });
+        } else if (key == "packages") {
+            ParseStrings(file_.packages);
+        } else if (key == "imports") {
+            ParseStrings(file_.imports);
+        } else {
+            SkipValue();
+        }
+    });
+}
+
+// Mirrors what the editor makes of its nodes in ConvertNodeGraphToRawCatProgram
+void CatFileParser::ParseNode() {
+    int64_t id = 0;
+    bool has_input = false;
+    size_t pins_num = 0;
+
+    type_.clear();
+    name_.clear();
+    branchers_.clear();
+    labeled_.clear();
+
+    ParseObject([&](std::string_view key) {
+        if (key == "id") {
+            id = ParseInteger();
+        } else if (key == "main_text") {
+            type_ = ParseString();
+        } else if (key == "tag_text") {
+            name_ = ParseString();
+        } else if (key == "has_input_pin") {
+            has_input = ParseBool();
+        } else if (key == "out_pins") {
+            ParseArray([&]() {
+                ParseOutPin(pins_num++);
+            });
+        } else {
+            SkipValue();
+        }
+    });
+
+    if (pins_num == 1 && !labeled_.front()) {
+        branchers_.front() = "*";
+    } else if (pins_num > 1) {
+        for (auto [i, labeled] : util::Enumerate(labeled_)) {
+            if (!labeled) {
+                Fail(std::format("out pin {} of node {} has no label", i, id));
+            }
+        }
+    }
+
+    std::optional<std::string> name;
+    if (!name_.empty()) {
+        name = name_;
+    }
+
+    file_.program.NewNodeGeneric(type_, std::move(name), branchers_, has_input);
+    node_ids_.push_back(id);
+}
+
+void CatFileParser::ParseOutPin(size_t pin_idx) {
+    branchers_.emplace_back();
+    labeled_.push_back(false);
+
+    ParseObject([&](std::string_view key) {
+        if (key == "label") {
+            branchers_[pin_idx] = ParseString();
+            labeled_[pin_idx] = true;
+        } else if (key == "connections") {
+            ParseArray([&]() {
+                ParseConnection(pin_idx);
+            });
+        } else {
+            SkipValue();
+        }
+    });
+}
+
+void CatFileParser::ParseConnection(size_t pin_idx) {
+    auto& conn = connections_.emplace_back(PendingConnection{
+        .source_node = file_.program.GetNodes().size(),
+        .target_id = 0,
+        .pin_idx = pin_idx,
+        .morphism = "",
+    });
+
+    ParseObject([&](std::string_view key) {
+        if (key == "node") {
+            conn.target_id = ParseInteger();
+        } else if (key == "text") {
+            conn.morphism = ParseString();
+        } else {
+            SkipValue();
+        }
+    });
+}
+
+void CatFileParser::ParseStrings(std::vector<std::string>& strings) {
+    ParseArray([&]() {
+        strings.emplace_back(ParseString());
+    });
+}
+
+void CatFileParser::MakeConnections() {
+    constexpr NodeID kNoNode = std::numeric_limits<NodeID>::max();
+    auto nodes_num = static_cast<int64_t>(node_ids_.size());
+    std::vector<NodeID> id2node(node_ids_.size(), kNoNode);
+
+    for (auto [node, id] : util::Enumerate(node_ids_)) {
+        if (id < 0 || id >= nodes_num) {
+            throw std::runtime_error(std::format("node id {} is out of range", id));
+        }
+        if (id2node[id] != kNoNode) {
+            throw std::runtime_error(std::format("node id {} is used twice", id));
+        }
+        id2node[id] = node;
+    }
+
+    for (const auto& conn : connections_) {
+        if (conn.target_id < 0 || conn.target_id >= nodes_num) {
+            throw std::runtime_error(
+                std::format("connection to unknown node id {}", conn.target_id));
+        }
+        file_.program.Connect(conn.source_node, id2node[conn.target_id], conn.pin_idx,
+                              conn.morphism);
+    }
+
+    connections_.clear();
+}
+
+template <typename F>
+void CatFileParser::ParseObject(F&& on_key) {
+    Expect('{');
+    if (ConsumeIf('}')) {
+        return;
+    }
+
+    do {
+        // on_key must be done with the key before parsing the value
+        std::string_view key = ParseString();
+        Expect(':');
+        on_key(key);
+    } while (ConsumeIf(','));
+
+    Expect('}');
+}
+
+template <typename F>
+void CatFileParser::ParseArray(F&& on_item) {
+    Expect('[');
+    if (ConsumeIf(']')) {
+        return;
+    }
+
+    do {
+        on_item();
+    } while (ConsumeIf(','));
+
+    Expect(']');
+}
+
+std::string_view CatFileParser::ParseString() {
+    Expect('"');
+
+    size_t start = cur_pos_;
+    size_t end = json_.find_first_of("\"\\", start);
+    if (end == std::string_view::npos) {
+        Fail("unterminated string");
+    }
+
+    if (json_[end] == '"') {
+        cur_pos_ = end + 1;
+        return json_.substr(start, end - start);
+    }
+
+    unescaped_.assign(json_.substr(start, end - start));
+    cur_pos_ = end;
+
+    auto read_hex4 = [&]() {
+        uint32_t value = 0;
+        auto [ptr, ec] = std::from_chars(json_.data() + cur_pos_,
+                                         json_.data() + std::min(cur_pos_ + 4, json_.size()),
+                                         value, 16);
+        if (ec != std::errc{} || ptr != json_.data() + cur_pos_ + 4) {
+            Fail("expected 4 hex digits");
+        }
+        cur_pos_ += 4;
+        return value;
+    };
+
+    while (true) {
+        if (cur_pos_ >= json_.size()) {
+            Fail("unterminated string");
+        }
+
+        char c = json_[cur_pos_++];
+        if (c == '"') {
+            break;
+        }
+        if (c != '\\') {
+            unescaped_.push_back(c);
+            continue;
+        }
+
+        if (cur_pos_ >= json_.size()) {
+            Fail("unterminated string");
+        }
+
+        switch (char esc = json_[cur_pos_++]) {
+            case '"':
+            case '\\':
+            case '/':
+                unescaped_.push_back(esc);
+                break;
+            case 'b':
+                unescaped_.push_back('\b');
+                break;
+            case 'f':
+                unescaped_.push_back('\f');
+                break;
+            case 'n':
+                unescaped_.push_back('\n');
+                break;
+            case 'r':
+                unescaped_.push_back('\r');
+                break;
+            case 't':
+                unescaped_.push_back('\t');
+                break;
+            case 'u': {
+                uint32_t code_point = read_hex4();
+
+                if (IsSurrogate(code_point, 0xD800)) {
+                    if (json_.substr(cur_pos_, 2) != "\\u") {
+                        Fail("expected low surrogate");
+                    }
+                    cur_pos_ += 2;
+
+                    uint32_t low = read_hex4();
+                    if (!IsSurrogate(low, 0xDC00)) {
+                        Fail("expected low surrogate");
+                    }
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                } else if (IsSurrogate(code_point, 0xDC00)) {
+                    Fail("unpaired low surrogate");
+                }
+
+                AppendUtf8(unescaped_, code_point);
+                break;
+            }
+            default:
+                Fail(std::format("invalid escape '\\{}'", esc));
+        }
+    }
+
+    return unescaped_;
+}
+
+int64_t CatFileParser::ParseInteger() {
+    SkipSpaces();
+
+    int64_t value = 0;
+    auto [ptr, ec] = std::from_chars(json_.data() + cur_pos_, json_.data() + json_.size(), value);
+    if (ec != std::errc{}) {
+        Fail("expected integer");
+    }
+
+    cur_pos_ = static_cast<size_t>(ptr - json_.data());
+
+    if (cur_pos_ < json_.size() && CanBeInScalar(json_[cur_pos_])) {
+        Fail("expected integer");
+    }
+
+    return value;
+}
+
+bool CatFileParser::ParseBool() {
+    SkipSpaces();
+
+    if (json_.substr(cur_pos_, 4) == "true") {
+        cur_pos_ += 4;
+        return true;
+    }
+    if (json_.substr(cur_pos_, 5) == "false") {
+        cur_pos_ += 5;
+        return false;
+    }
+
+    Fail("expected boolean");
+}
+
+// Only brackets are matched inside skipped values, their scalars aren't validated
+void CatFileParser::SkipValue() {
+    size_t depth = 0;
+
+    do {
+        switch (Peek()) {
+            case '{':
+            case '[':
+                ++depth;
+                ++cur_pos_;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) {
+                    Fail("expected value");
+                }
+                --depth;
+                ++cur_pos_;
+                break;
+            case ',':
+            case ':':
+                if (depth == 0) {
+                    Fail("expected value");
+                }
+                ++cur_pos_;
+                break;
+            case '"':
+                SkipString();
+                break;
+            case '\0':
+                Fail("unexpected end of file");
+            default: {
+                size_t start = cur_pos_;
+                while (cur_pos_ < json_.size() && CanBeInScalar(json_[cur_pos_])) {
+                    ++cur_pos_;
+                }
+                if (cur_pos_ == start) {
+                    Fail(std::format("unexpected character '{}'", json_[cur_pos_]));
+                }
+            }
+        }
+    } while (depth > 0);
+}
+
+void CatFileParser::SkipString() {
+    Expect('"');
+
+    while (true) {
+        size_t end = json_.find_first_of("\"\\", cur_pos_);
+        if (end == std::string_view::npos) {
+            Fail("unterminated string");
+        }
+
+        cur_pos_ = end + 1;
+        if (json_[end] == '"') {
+            return;
+        }
+        ++cur_pos_;
+    }
+}
+
+char CatFileParser::Peek() {
+    SkipSpaces();
+    return cur_pos_ < json_.size() ? json_[cur_pos_] : '\0';
+}
+
+void CatFileParser::Expect(char c) {
+    if (Peek() != c) {
+        Fail(std::format("expected '{}'", c));
+    }
+    ++cur_pos_;
+}
+
+bool CatFileParser::ConsumeIf(char c) {
+    if (Peek() != c) {
+        return false;
+    }
+    ++cur_pos_;
+    return true;
+}
+
+void CatFileParser::SkipSpaces() {
+    while (cur_pos_ < json_.size() && util::IsSpace(json_[cur_pos_])) {
+        ++cur_pos_;
+    }
+}
+
+void CatFileParser::Fail(std::string_view what) const {
+    throw std::runtime_error(std::format("{} at byte {}", what, cur_pos_));
+}
+
+ParserResult<CatFile> ReadCatFile(const std::filesystem::path& path) {
+    auto maybe_file = util::MappedFile::Open(path);
+    if (!maybe_file) {
+        return MakeParserError(std::format("failed to read \"{}\": {}", path.string(),
+                                           maybe_file.error().message()));
+    }
+
+    // Everything the program keeps is copied out, so the file can be unmapped afterwards
+    return CatFileParser(maybe_file->View()).Parse();
+}
+
+}  // namespace komaru::parsers
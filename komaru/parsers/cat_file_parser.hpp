@@ -0,0 +1,83 @@
+#pragma once
+
+#include <komaru/parsers/parser_result.hpp>
+#include <komaru/translate/raw_cat_program.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace komaru::parsers {
+
+// Contents of a .cat file saved by the editor
+struct CatFile {
+    translate::RawCatProgram program;
+    std::vector<std::string> packages;
+    std::vector<std::string> imports;
+};
+
+// Reads .cat json in one pass without building a json tree: nodes and connections go to the
+// program as soon as their objects are read. Strings without escapes are viewed in place.
+// Unknown keys are skipped, like node positions that only matter to the editor.
+class CatFileParser {
+public:
+    explicit CatFileParser(std::string_view json);
+
+    ParserResult<CatFile> Parse();
+
+private:
+    // Target nodes may come later in the file, so connections are made once all nodes are read
+    struct PendingConnection {
+        translate::RawCatProgram::NodeID source_node;
+        int64_t target_id;
+        size_t pin_idx;
+        std::string morphism;
+    };
+
+    void ParseRoot();
+    void ParseNode();
+    void ParseOutPin(size_t pin_idx);
+    void ParseConnection(size_t pin_idx);
+    void ParseStrings(std::vector<std::string>& strings);
+    void MakeConnections();
+
+    template <typename F>
+    void ParseObject(F&& on_key);
+    template <typename F>
+    void ParseArray(F&& on_item);
+
+    // Views either the json or unescaped_, so it's valid until the next string is parsed
+    std::string_view ParseString();
+    int64_t ParseInteger();
+    bool ParseBool();
+    void SkipValue();
+    void SkipString();
+
+    char Peek();
+    void Expect(char c);
+    bool ConsumeIf(char c);
+    void SkipSpaces();
+    [[noreturn]] void Fail(std::string_view what) const;
+
+private:
+    std::string_view json_;
+    size_t cur_pos_{0};
+    std::string unescaped_;
+    CatFile file_;
+
+    // Fields of the node being read, reused from node to node
+    std::string type_;
+    std::string name_;
+    std::vector<std::string> branchers_;
+    std::vector<bool> labeled_;
+
+    std::vector<int64_t> node_ids_;
+    std::vector<PendingConnection> connections_;
+};
+
+// Maps the file into memory and parses it in place
+ParserResult<CatFile> ReadCatFile(const std::filesystem::path& path);
+
+}  // namespace komaru::parsers
@@ -79,7 +79,7 @@ lang::MorphismPtr MorphismParser::ParseExprInCurrentScope() {
     }
 
     auto cur_expr = ParseSubExpr();
-    std::map<size_t, lang::MorphismPtr> mapping;
+    lang::BindingMap mapping;
     size_t arg_idx = 0;
 
     while (CanStartSubExpr(Peek().type)) {
@@ -0,0 +1,237 @@
+#include "parse_cache.hpp"
+
+#include <komaru/parsers/cat_type_parser.hpp>
+#include <komaru/parsers/morphism_parser.hpp>
+#include <komaru/parsers/pattern_parser.hpp>
+
+#include <algorithm>
+#include <cctype>
+
+namespace komaru::parsers {
+
+namespace {
+
+void PinTypes(const lang::Type& type, lang::PinnedTypes& pins) {
+    pins.Add(type);
+}
+
+void PinTypes(const lang::MorphismPtr& morphism, lang::PinnedTypes& pins) {
+    lang::PinTypes(*morphism, pins);
+}
+
+// Patterns are made of names and literals only
+void PinTypes(const lang::Pattern&, lang::PinnedTypes&) {
+}
+
+}  // namespace
+
+double ParseCache::Counters::HitRate() const {
+    size_t total = hits + misses;
+    return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+}
+
+ParseCache::ParseCache(translate::hs::HaskellSymbolsRegistry& symbols_registry,
+                       size_t max_texts_num)
+    : symbols_registry_(symbols_registry),
+      lib_generation_(symbols_registry.GetLibGeneration()),
+      max_texts_num_(std::max<size_t>(max_texts_num, 1)) {
+}
+
+ParserResult<lang::Type> ParseCache::ParseType(const std::string& raw) {
+    return ParseType(raw, symbols_registry_);
+}
+
+ParserResult<lang::MorphismPtr> ParseCache::ParseMorphism(const std::string& raw) {
+    return ParseMorphism(raw, symbols_registry_);
+}
+
+ParserResult<lang::Pattern> ParseCache::ParsePattern(const std::string& raw) {
+    return ParsePattern(raw, symbols_registry_);
+}
+
+// Types refer to type constructors only, so local and global functions don't matter for them
+ParserResult<lang::Type> ParseCache::ParseType(
+    const std::string& raw, translate::hs::HaskellSymbolsRegistry& symbols_registry) {
+    return Lookup<lang::Type, CatTypeParser>(types_, type_counters_, false, raw,
+                                             symbols_registry);
+}
+
+ParserResult<lang::MorphismPtr> ParseCache::ParseMorphism(
+    const std::string& raw, translate::hs::HaskellSymbolsRegistry& symbols_registry) {
+    return Lookup<lang::MorphismPtr, MorphismParser>(morphisms_, morphism_counters_, true, raw,
+                                                     symbols_registry);
+}
+
+ParserResult<lang::Pattern> ParseCache::ParsePattern(
+    const std::string& raw, translate::hs::HaskellSymbolsRegistry& symbols_registry) {
+    return Lookup<lang::Pattern, PatternParser>(patterns_, pattern_counters_, true, raw,
+                                                symbols_registry);
+}
+
+const ParseCache::Counters& ParseCache::GetTypeCounters() const {
+    return type_counters_;
+}
+
+const ParseCache::Counters& ParseCache::GetMorphismCounters() const {
+    return morphism_counters_;
+}
+
+const ParseCache::Counters& ParseCache::GetPatternCounters() const {
+    return pattern_counters_;
+}
+
+size_t ParseCache::GetTextsNum() {
+    std::shared_lock lock(mutex_);
+    return types_.size() + morphisms_.size() + patterns_.size();
+}
+
+void ParseCache::Clear() {
+    std::lock_guard lock(mutex_);
+    types_.clear();
+    morphisms_.clear();
+    patterns_.clear();
+}
+
+template <typename T, typename Parser>
+ParserResult<T> ParseCache::Lookup(Entries<T>& entries, Counters& counters,
+                                   bool depends_on_functions, const std::string& raw,
+                                   translate::hs::HaskellSymbolsRegistry& symbols_registry) {
+    {
+        std::shared_lock lock(mutex_);
+
+        auto it = entries.find(raw);
+        if (symbols_registry.GetLibGeneration() == lib_generation_ && it != entries.end()) {
+            auto& text_entries = it->second.entries;
+            auto entry_it = std::ranges::find_if(text_entries, [&](const Entry<T>& entry) {
+                return StillResolves(entry.resolved, symbols_registry);
+            });
+            if (entry_it != text_entries.end()) {
+                ++counters.hits;
+                it->second.last_used.store(++clock_, std::memory_order_relaxed);
+                lang::TypeUniverse::Keep(entry_it->pins);
+                return entry_it->result;
+            }
+        }
+    }
+
+    // Parsed without the lock, so another thread may add the same result meanwhile
+    ++counters.misses;
+    ParserResult<T> res = Parser(raw, symbols_registry).Parse();
+    Resolved resolved = depends_on_functions ? Resolve(raw, symbols_registry) : Resolved{};
+
+    auto pins = std::make_shared<lang::PinnedTypes>();
+    if (res) {
+        PinTypes(res.value(), *pins);
+    }
+    for (const auto& [_, maybe_type] : resolved) {
+        if (maybe_type) {
+            pins->Add(maybe_type.value());
+        }
+    }
+
+    std::lock_guard lock(mutex_);
+    DropIfLibChanged(symbols_registry);
+
+    auto& text = entries[raw];
+    if (text.entries.size() == kMaxEntriesPerText) {
+        text.entries.erase(text.entries.begin());
+    }
+    text.entries.push_back(
+        Entry<T>{.resolved = std::move(resolved), .result = res, .pins = std::move(pins)});
+    text.last_used.store(++clock_, std::memory_order_relaxed);
+
+    if (entries.size() > max_texts_num_) {
+        DropLeastRecentlyUsed(entries);
+    }
+
+    return res;
+}
+
+// A quarter of the texts is dropped at once, so that finding the oldest ones is paid for by
+// the lookups that filled the cache. Pins of the dropped results go away with them.
+template <typename T>
+void ParseCache::DropLeastRecentlyUsed(Entries<T>& entries) {
+    size_t kept_num = max_texts_num_ - max_texts_num_ / 4;
+
+    std::vector<uint64_t> ticks;
+    ticks.reserve(entries.size());
+    for (const auto& [_, text] : entries) {
+        ticks.push_back(text.last_used.load(std::memory_order_relaxed));
+    }
+
+    auto oldest_kept = ticks.end() - static_cast<ptrdiff_t>(kept_num);
+    std::ranges::nth_element(ticks, oldest_kept);
+    uint64_t min_tick = *oldest_kept;
+
+    std::erase_if(entries, [min_tick](const auto& raw_and_text) {
+        return raw_and_text.second.last_used.load(std::memory_order_relaxed) < min_tick;
+    });
+}
+
+bool ParseCache::StillResolves(const Resolved& resolved,
+                               const translate::hs::HaskellSymbolsRegistry& symbols_registry) {
+    return std::ranges::all_of(resolved, [&](const auto& name_and_type) {
+        return symbols_registry.FindProgramFunction(name_and_type.first) ==
+               name_and_type.second;
+    });
+}
+
+// Every word of the text and every part of it is taken for a name, since lexers of morphisms
+// and patterns split names differently. A result may depend on more names than it really
+// does, but never on fewer.
+ParseCache::Resolved ParseCache::Resolve(
+    const std::string& raw, const translate::hs::HaskellSymbolsRegistry& symbols_registry) {
+    Resolved resolved;
+
+    auto add = [&](std::string name) {
+        if (name.empty() ||
+            std::ranges::find(resolved, name, &Resolved::value_type::first) != resolved.end()) {
+            return;
+        }
+        auto maybe_type = symbols_registry.FindProgramFunction(name);
+        resolved.emplace_back(std::move(name), std::move(maybe_type));
+    };
+
+    auto is_name_char = [](char c) {
+        return std::isalnum(c) || c == '_' || c == '\'' || c == '.';
+    };
+
+    for (size_t i = 0; i < raw.size();) {
+        size_t j = i;
+        while (j < raw.size() && is_name_char(raw[j])) {
+            ++j;
+        }
+
+        if (j == i) {
+            ++i;
+            continue;
+        }
+
+        add(raw.substr(i, j - i));
+        for (size_t k = i; k < j;) {
+            size_t end = k;
+            while (end < j && raw[end] != '.' && raw[end] != '_') {
+                ++end;
+            }
+            if (k != i || end != j) {
+                add(raw.substr(k, end - k));
+            }
+            k = end + 1;
+        }
+        i = j;
+    }
+
+    return resolved;
+}
+
+// Nothing parsed before a reload can be used after it
+void ParseCache::DropIfLibChanged(const translate::hs::HaskellSymbolsRegistry& symbols_registry) {
+    if (symbols_registry.GetLibGeneration() != lib_generation_) {
+        types_.clear();
+        morphisms_.clear();
+        patterns_.clear();
+        lib_generation_ = symbols_registry.GetLibGeneration();
+    }
+}
+
+}  // namespace komaru::parsers
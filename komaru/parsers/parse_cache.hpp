@@ -0,0 +1,120 @@
+#pragma once
+
+#include <komaru/lang/morphism.hpp>
+#include <komaru/lang/pattern.hpp>
+#include <komaru/lang/type.hpp>
+#include <komaru/parsers/parser_result.hpp>
+#include <komaru/translate/haskell/hs_symbols_registry.hpp>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace komaru::parsers {
+
+// Memoizes CatTypeParser, MorphismParser and PatternParser results, errors included.
+// Results are keyed by the raw text. A morphism or pattern result also remembers what the
+// names in its text resolved to among local and global functions, and is only handed out
+// while they resolve the same. Adding a function the text doesn't mention keeps it valid.
+// Everything is dropped once the registry is reloaded. At most `max_texts_num` texts of every
+// kind are kept, the least recently used ones are dropped past that. Types of a result are
+// pinned while it's kept, so they outlive the type universe they were parsed in, and are kept
+// by every universe the result is handed out to. Dropping a result releases its pins.
+//
+// It's safe to use from several threads at once, e.g. by functions cooked in parallel, each
+// parsing with its own fork of the registry.
+class ParseCache {
+public:
+    struct Counters {
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+
+        double HitRate() const;
+    };
+
+    static constexpr size_t kDefaultMaxTextsNum = 4096;
+
+    explicit ParseCache(translate::hs::HaskellSymbolsRegistry& symbols_registry,
+                        size_t max_texts_num = kDefaultMaxTextsNum);
+
+    ParserResult<lang::Type> ParseType(const std::string& raw);
+    ParserResult<lang::MorphismPtr> ParseMorphism(const std::string& raw);
+    ParserResult<lang::Pattern> ParsePattern(const std::string& raw);
+    // Parse with `symbols_registry` instead of the cache's own one, e.g. with a fork of it
+    ParserResult<lang::Type> ParseType(const std::string& raw,
+                                       translate::hs::HaskellSymbolsRegistry& symbols_registry);
+    ParserResult<lang::MorphismPtr> ParseMorphism(
+        const std::string& raw, translate::hs::HaskellSymbolsRegistry& symbols_registry);
+    ParserResult<lang::Pattern> ParsePattern(
+        const std::string& raw, translate::hs::HaskellSymbolsRegistry& symbols_registry);
+
+    const Counters& GetTypeCounters() const;
+    const Counters& GetMorphismCounters() const;
+    const Counters& GetPatternCounters() const;
+    // Distinct texts kept for types, morphisms and patterns together
+    size_t GetTextsNum();
+
+    void Clear();
+
+private:
+    // Names of the text and their local or global functions, nullopt for none
+    using Resolved = std::vector<std::pair<std::string, std::optional<lang::Type>>>;
+
+    template <typename T>
+    struct Entry {
+        Resolved resolved;
+        ParserResult<T> result;
+        std::shared_ptr<const lang::PinnedTypes> pins;
+    };
+
+    // Results of the same text for a few different sets of functions, the oldest is dropped
+    // once there are more
+    template <typename T>
+    struct TextEntries {
+        std::vector<Entry<T>> entries;
+        // Tick of the last lookup, bumped under the shared lock
+        std::atomic<uint64_t> last_used{0};
+    };
+
+    template <typename T>
+    using Entries = std::unordered_map<std::string, TextEntries<T>>;
+
+    static constexpr size_t kMaxEntriesPerText = 4;
+
+    template <typename T, typename Parser>
+    ParserResult<T> Lookup(Entries<T>& entries, Counters& counters, bool depends_on_functions,
+                           const std::string& raw,
+                           translate::hs::HaskellSymbolsRegistry& symbols_registry);
+    static bool StillResolves(const Resolved& resolved,
+                              const translate::hs::HaskellSymbolsRegistry& symbols_registry);
+    static Resolved Resolve(const std::string& raw,
+                            const translate::hs::HaskellSymbolsRegistry& symbols_registry);
+
+    // Must be called with the mutex locked exclusively
+    void DropIfLibChanged(const translate::hs::HaskellSymbolsRegistry& symbols_registry);
+    template <typename T>
+    void DropLeastRecentlyUsed(Entries<T>& entries);
+
+private:
+    translate::hs::HaskellSymbolsRegistry& symbols_registry_;
+    // Lookups share it, only adding results and dropping them takes it exclusively
+    std::shared_mutex mutex_;
+    uint64_t lib_generation_;
+    size_t max_texts_num_;
+    std::atomic<uint64_t> clock_{0};
+
+    Entries<lang::Type> types_;
+    Entries<lang::MorphismPtr> morphisms_;
+    Entries<lang::Pattern> patterns_;
+
+    Counters type_counters_;
+    Counters morphism_counters_;
+    Counters pattern_counters_;
+};
+
+}  // namespace komaru::parsers
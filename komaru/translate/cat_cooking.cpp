@@ -1,11 +1,14 @@
 #include "cat_cooking.hpp"
 
-#include <komaru/parsers/cat_type_parser.hpp>
-#include <komaru/parsers/morphism_parser.hpp>
-#include <komaru/parsers/pattern_parser.hpp>
+#include <komaru/parsers/parse_cache.hpp>
+#include <komaru/parsers/cat_type_lexer.hpp>
+#include <komaru/parsers/morphism_lexer.hpp>
+#include <komaru/parsers/pattern_lexer.hpp>
 #include <komaru/translate/simple_symbols_registry.hpp>
 #include <komaru/util/string.hpp>
 #include <komaru/util/std_extensions.hpp>
+#include <komaru/util/thread_pool.hpp>
+#include <komaru/util/csr_graph.hpp>
 
 #include <format>
 #include <cstdlib>
@@ -13,47 +16,79 @@
 #include <optional>
 #include <numeric>
 #include <cassert>
+#include <cctype>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace komaru::translate {
 
-using CookedNode = lang::CatProgram::Node;
-using CookedArrow = lang::CatProgram::Arrow;
-using CookedOutPin = lang::CatProgram::OutPin;
+using CookedNode = lang::CatProgramBuilder::Node;
+using CookedOutPin = lang::CatProgramBuilder::OutPin;
 using CookedBrancher = CookedOutPin::Brancher;
 
 class Cooker {
+    friend class IncrementalCooker;
+
 public:
-    explicit Cooker(const RawCatProgram& raw_program, hs::HaskellSymbolsRegistry& symbols_registry)
+    Cooker(const RawCatProgram& raw_program, hs::HaskellSymbolsRegistry& symbols_registry,
+           parsers::ParseCache& parse_cache, util::ThreadPool& thread_pool)
         : raw_program_(raw_program),
-          symbols_registry_(symbols_registry) {
+          symbols_registry_(symbols_registry),
+          parse_cache_(parse_cache),
+          thread_pool_(thread_pool) {
     }
 
     CookingResult<lang::CatProgram> Cook();
 
 private:
-    std::optional<CookingError> CookNodeTypes();
+    void PrefetchSymbols(std::span<const size_t> node_ids);
+    std::optional<CookingError> CookNodeTypes(std::span<const size_t> node_ids);
     CookingResult<std::vector<size_t>> DiscoverFunctions();
+    std::vector<std::vector<size_t>> GroupNodesByFunction(
+        const std::vector<size_t>& root_ids) const;
     std::optional<CookingError> AddFunctionsToRegistry(const std::vector<size_t>& root_ids);
-    std::optional<CookingError> CookFunction(size_t root_id);
-    std::optional<CookingError> CookNodeAndIncomingArrows(size_t node_id);
+    CookingResult<lang::Type> CookFunctionType(size_t root_id);
+
+    // What cooking of a single function writes to: its local symbols and its cooked nodes
+    struct FunctionScope {
+        hs::HaskellSymbolsRegistry& symbols_registry;
+        lang::CatProgramBuilder& builder;
+    };
+
+    std::optional<CookingError> CookFunction(size_t root_id, FunctionScope& scope);
+    std::optional<CookingError> CookNodeAndIncomingArrows(size_t node_id, FunctionScope& scope);
+    CookingResult<std::vector<lang::CatProgram>> CookFunctionsInParallel(
+        std::span<const size_t> root_ids);
 
-    CookingResult<lang::MorphismPtr> CookMorphism(const std::string& raw);
-    CookingResult<CookedBrancher> CookBrancher(const std::string& raw);
-    CookingResult<lang::Pattern> CookPattern(const std::string& raw);
-    CookingResult<lang::Guard> CookGuard(const std::string& raw);
+    CookingResult<lang::MorphismPtr> CookMorphism(const std::string& raw, FunctionScope& scope);
+    CookingResult<CookedBrancher> CookBrancher(const std::string& raw, FunctionScope& scope);
+    CookingResult<lang::Pattern> CookPattern(const std::string& raw, FunctionScope& scope);
+    CookingResult<lang::Guard> CookGuard(const std::string& raw, FunctionScope& scope);
 
     void BuildGraphs();
     bool HasOrientedCycles() const;
-    void AddSymbolsForPattern(const lang::Pattern& pattern, lang::Type type);
+    void AddSymbolsForPattern(const lang::Pattern& pattern, lang::Type type,
+                              FunctionScope& scope);
+
+    std::string MakeFunctionKey(std::span<const size_t> node_ids) const;
+    Callees FindCallees(std::span<const size_t> node_ids,
+                        const std::unordered_map<std::string, lang::Type>& functions) const;
 
 private:
     const RawCatProgram& raw_program_;
     hs::HaskellSymbolsRegistry& symbols_registry_;
+    parsers::ParseCache& parse_cache_;
+    util::ThreadPool& thread_pool_;
     lang::CatProgramBuilder builder_;
     std::vector<lang::Type> node2type_;
+    std::vector<size_t> node2root_;
     std::vector<CookedNode*> node2cooked_;
-    std::vector<std::vector<std::pair<size_t, size_t>>> graph_;
-    std::vector<std::vector<std::pair<size_t, size_t>>> rgraph_;
+    // Edges are numbered after connections
+    util::CsrGraph graph_;
+    util::CsrGraph rgraph_;
 };
 
 CookingResult<lang::CatProgram> Cooker::Cook() {
@@ -63,7 +98,12 @@ CookingResult<lang::CatProgram> Cooker::Cook() {
         return MakeCookingError("program can't have oriented cycles");
     }
 
-    auto maybe_err = CookNodeTypes();
+    std::vector<size_t> node_ids(raw_program_.GetNodes().size());
+    std::iota(node_ids.begin(), node_ids.end(), 0);
+
+    PrefetchSymbols(node_ids);
+
+    auto maybe_err = CookNodeTypes(node_ids);
     if (maybe_err.has_value()) {
         return std::unexpected(maybe_err.value());
     }
@@ -80,10 +120,24 @@ CookingResult<lang::CatProgram> Cooker::Cook() {
         return std::unexpected(maybe_err.value());
     }
 
-    node2cooked_.resize(graph_.size(), nullptr);
+    node2cooked_.resize(graph_.Size(), nullptr);
+
+    if (func_roots.size() > 1 && thread_pool_.GetThreadsNum() > 0) {
+        auto maybe_programs = CookFunctionsInParallel(func_roots);
+        if (!maybe_programs) {
+            return std::unexpected(maybe_programs.error());
+        }
+
+        for (const auto& program : maybe_programs.value()) {
+            builder_.Append(program);
+        }
+        return builder_.Extract();
+    }
+
+    FunctionScope scope{symbols_registry_, builder_};
 
     for (size_t root_id : func_roots) {
-        auto maybe_err = CookFunction(root_id);
+        auto maybe_err = CookFunction(root_id, scope);
         if (maybe_err.has_value()) {
             return std::unexpected(maybe_err.value());
         }
@@ -92,108 +146,251 @@ CookingResult<lang::CatProgram> Cooker::Cook() {
     return builder_.Extract();
 }
 
-std::optional<CookingError> Cooker::CookNodeTypes() {
-    node2type_.reserve(raw_program_.GetNodes().size());
+// Library symbols that the nodes' types, branchers and incoming arrows may refer to are looked
+// up in one batch. Names are picked by the lexers; the ones the program binds itself are left
+// out, so GHCi's answers for them don't end up in the symbols cache. Errors are left for the
+// parsers to report.
+void Cooker::PrefetchSymbols(std::span<const size_t> node_ids) {
+    auto& nodes = raw_program_.GetNodes();
+    auto& conns = raw_program_.GetConnections();
 
-    for (const auto& node : raw_program_.GetNodes()) {
-        auto maybe_type = parsers::CatTypeParser(node.type, symbols_registry_).Parse();
+    // Functions of the program and values bound by its patterns, in any of its functions,
+    // since a name may be lexed where it isn't really used
+    std::unordered_set<std::string> program_names;
+    for (const auto& node : nodes) {
+        if (node.name) {
+            program_names.insert(*node.name);
+        }
+
+        for (const auto& brancher : node.branchers) {
+            auto stripped = util::Strip(brancher);
+            if (stripped.starts_with('|')) {
+                continue;
+            }
+
+            if (auto maybe_tokens = parsers::TokenizePattern(stripped)) {
+                for (const auto& tok : maybe_tokens.value()) {
+                    if (tok.type == parsers::PatternTokenType::Identifier &&
+                        !std::isupper(tok.raw.front())) {
+                        program_names.insert(tok.raw);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> functions;
+    std::vector<std::string> type_constructors;
+
+    auto add_function = [&](std::string name) {
+        if (!program_names.contains(name)) {
+            functions.push_back(std::move(name));
+        }
+    };
+
+    auto add_morphism_names = [&](const std::string& raw) {
+        auto maybe_tokens = parsers::TokenizeMorphism(raw);
+        if (!maybe_tokens) {
+            return;
+        }
+
+        for (const auto& tok : maybe_tokens.value()) {
+            if (tok.type == parsers::MorphismTokenType::Identifier && tok.raw != "_") {
+                add_function(tok.raw);
+            } else if (tok.type == parsers::MorphismTokenType::Operator && tok.raw != "$") {
+                add_function("(" + tok.raw + ")");
+            }
+        }
+    };
+
+    for (size_t node_id : node_ids) {
+        const auto& node = nodes[node_id];
+
+        if (auto maybe_tokens = parsers::TokenizeCatType(node.type)) {
+            for (const auto& tok : maybe_tokens.value()) {
+                if (tok.type == parsers::CatTypeTokenType::Identifier &&
+                    lang::IsConcreteTypeName(tok.raw)) {
+                    type_constructors.push_back(tok.raw);
+                }
+            }
+        }
+
+        for (const auto& brancher : node.branchers) {
+            auto stripped = util::Strip(brancher);
+
+            if (stripped.starts_with('|')) {
+                add_morphism_names(stripped.substr(1));
+            } else if (auto maybe_tokens = parsers::TokenizePattern(stripped)) {
+                // Only constructors are looked up, lowercase names bind values
+                for (const auto& tok : maybe_tokens.value()) {
+                    if (tok.type == parsers::PatternTokenType::Identifier &&
+                        std::isupper(tok.raw.front())) {
+                        add_function(tok.raw);
+                    }
+                }
+            }
+        }
+
+        for (auto [_, conn_id] : rgraph_[node_id]) {
+            add_morphism_names(conns[conn_id].morphism);
+        }
+    }
+
+    symbols_registry_.PrefetchTypeConstructors(type_constructors);
+    symbols_registry_.PrefetchFunctions(functions);
+}
+
+std::optional<CookingError> Cooker::CookNodeTypes(std::span<const size_t> node_ids) {
+    auto& nodes = raw_program_.GetNodes();
+    node2type_.resize(nodes.size());
+
+    for (size_t node_id : node_ids) {
+        auto maybe_type = parse_cache_.ParseType(nodes[node_id].type);
         if (!maybe_type) {
             return CookingError::From(maybe_type.error());
         }
 
-        node2type_.push_back(std::move(maybe_type.value()));
+        node2type_[node_id] = std::move(maybe_type.value());
     }
 
     return std::nullopt;
 }
 
+// Walks parents first, a node takes the root of its parents or becomes a root itself.
+// The graph has no cycles by now, so a node is never on the stack twice
 CookingResult<std::vector<size_t>> Cooker::DiscoverFunctions() {
-    std::vector<size_t> root_ids;
-    std::vector<size_t> node2root(rgraph_.size(), std::numeric_limits<size_t>::max());
+    constexpr size_t kNoRoot = std::numeric_limits<size_t>::max();
 
-    auto dfs = [&](auto& self, size_t v) -> bool {
-        for (auto [u, _] : rgraph_[v]) {
-            if (node2root[u] == std::numeric_limits<size_t>::max() && !self(self, u)) {
-                return false;
-            }
+    std::vector<size_t> root_ids;
+    node2root_.assign(rgraph_.Size(), kNoRoot);
 
-            if (node2root[v] != std::numeric_limits<size_t>::max() &&
-                node2root[v] != node2root[u]) {
-                return false;
-            }
+    // Node and the index of its next parent
+    std::vector<std::pair<size_t, size_t>> stack;
 
-            node2root[v] = node2root[u];
+    for (size_t start = 0; start < node2root_.size(); ++start) {
+        if (node2root_[start] != kNoRoot) {
+            continue;
         }
 
-        if (node2root[v] == std::numeric_limits<size_t>::max()) {
-            node2root[v] = v;
-            root_ids.push_back(v);
-        }
+        stack.emplace_back(start, 0);
 
-        return true;
-    };
+        while (!stack.empty()) {
+            auto& [v, next] = stack.back();
+
+            if (next == rgraph_[v].size()) {
+                if (node2root_[v] == kNoRoot) {
+                    node2root_[v] = v;
+                    root_ids.push_back(v);
+                }
+                stack.pop_back();
+                continue;
+            }
 
-    for (size_t v = 0; v < node2root.size(); ++v) {
-        if (node2root[v] == std::numeric_limits<size_t>::max()) {
-            if (!dfs(dfs, v)) {
+            size_t u = rgraph_[v][next].node;
+            if (node2root_[u] == kNoRoot) {
+                stack.emplace_back(u, 0);
+                continue;
+            }
+
+            if (node2root_[v] != kNoRoot && node2root_[v] != node2root_[u]) {
                 return MakeCookingError("found multiple roots for a single function");
             }
+
+            node2root_[v] = node2root_[u];
+            ++next;
         }
     }
 
     return root_ids;
 }
 
+// Nodes of every function in increasing order, functions go in the order of `root_ids`
+std::vector<std::vector<size_t>> Cooker::GroupNodesByFunction(
+    const std::vector<size_t>& root_ids) const {
+    std::unordered_map<size_t, size_t> root2func;
+    for (auto [i, root_id] : util::Enumerate(root_ids)) {
+        root2func.emplace(root_id, i);
+    }
+
+    std::vector<std::vector<size_t>> func2nodes(root_ids.size());
+    for (auto [node_id, root_id] : util::Enumerate(node2root_)) {
+        func2nodes[root2func.at(root_id)].push_back(node_id);
+    }
+
+    return func2nodes;
+}
+
 std::optional<CookingError> Cooker::AddFunctionsToRegistry(const std::vector<size_t>& root_ids) {
     symbols_registry_.ResetGlobalFunctions();
-    std::vector<lang::Type> node2ret(graph_.size());
-    std::vector<char> vis(graph_.size(), false);
-
-    auto dfs = [&](auto& self, size_t v) -> bool {
-        vis[v] = true;
+    auto& nodes = raw_program_.GetNodes();
 
-        if (graph_[v].empty()) {
-            node2ret[v] = node2type_[v];
-            return true;
+    for (size_t root_id : root_ids) {
+        auto maybe_type = CookFunctionType(root_id);
+        if (!maybe_type) {
+            return maybe_type.error();
         }
 
-        std::optional<lang::Type> ret = std::nullopt;
-        for (auto [u, _] : graph_[v]) {
-            if (!vis[u]) {
-                self(self, u);
-            }
-            if (!ret.has_value()) {
-                ret = node2ret[u];
-            } else if (ret.value() != node2ret[u]) {
-                return false;
-            }
-        }
-        node2ret[v] = ret.value();
-        return true;
+        symbols_registry_.AddGlobalFunction(nodes[root_id].name.value(), maybe_type->Pure());
+    }
+
+    return std::nullopt;
+}
+
+CookingResult<lang::Type> Cooker::CookFunctionType(size_t root_id) {
+    std::unordered_map<size_t, lang::Type> node2ret;
+
+    struct Frame {
+        size_t node;
+        size_t next;
+        std::optional<lang::Type> ret;
     };
 
-    auto& nodes = raw_program_.GetNodes();
+    // Children go first, a node returns what all of its children return
+    std::vector<Frame> stack;
+    stack.push_back(Frame{.node = root_id, .next = 0, .ret = std::nullopt});
 
-    for (size_t root_id : root_ids) {
-        if (!dfs(dfs, root_id)) {
-            return CookingError("found inconsistent return types for a single function");
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        auto edges = graph_[frame.node];
+
+        if (edges.empty()) {
+            node2ret.emplace(frame.node, node2type_[frame.node]);
+            stack.pop_back();
+            continue;
         }
 
-        if (!nodes[root_id].name.has_value()) {
-            return CookingError("unnamed functions are not allowed");
+        if (frame.next == edges.size()) {
+            node2ret.emplace(frame.node, frame.ret.value());
+            stack.pop_back();
+            continue;
         }
-        auto func_type = lang::Type::Function(node2type_[root_id], node2ret[root_id]);
 
-        symbols_registry_.AddGlobalFunction(nodes[root_id].name.value(), func_type.Pure());
+        size_t u = edges[frame.next].node;
+        auto it = node2ret.find(u);
+        if (it == node2ret.end()) {
+            stack.push_back(Frame{.node = u, .next = 0, .ret = std::nullopt});
+            continue;
+        }
+
+        if (frame.ret.has_value() && frame.ret.value() != it->second) {
+            return MakeCookingError("found inconsistent return types for a single function");
+        }
+
+        frame.ret = it->second;
+        ++frame.next;
     }
 
-    return std::nullopt;
+    if (!raw_program_.GetNodes()[root_id].name.has_value()) {
+        return MakeCookingError("unnamed functions are not allowed");
+    }
+
+    return lang::Type::Function(node2type_[root_id], node2ret[root_id]);
 }
 
-std::optional<CookingError> Cooker::CookFunction(size_t root_id) {
-    symbols_registry_.ResetLocalFunctions();
+std::optional<CookingError> Cooker::CookFunction(size_t root_id, FunctionScope& scope) {
+    scope.symbols_registry.ResetLocalFunctions();
     auto& nodes = raw_program_.GetNodes();
-    std::vector<size_t> node2views(graph_.size(), 0);
+    std::vector<size_t> node2views(graph_.Size(), 0);
     std::queue<size_t> normal_q;
     std::queue<size_t> branch_q;
 
@@ -209,7 +406,7 @@ std::optional<CookingError> Cooker::CookFunction(size_t root_id) {
             branch_q.pop();
         }
 
-        auto maybe_err = CookNodeAndIncomingArrows(node_id);
+        auto maybe_err = CookNodeAndIncomingArrows(node_id, scope);
         if (maybe_err) {
             return maybe_err;
         }
@@ -231,15 +428,17 @@ std::optional<CookingError> Cooker::CookFunction(size_t root_id) {
     return std::nullopt;
 }
 
-std::optional<CookingError> Cooker::CookNodeAndIncomingArrows(size_t node_id) {
+std::optional<CookingError> Cooker::CookNodeAndIncomingArrows(size_t node_id,
+                                                              FunctionScope& scope) {
     auto& nodes = raw_program_.GetNodes();
     auto& conns = raw_program_.GetConnections();
     auto& node = nodes[node_id];
-    CookedNode& cnode = builder_.NewNode(node2type_[node_id], nodes[node_id].name.value_or(""));
+    CookedNode& cnode =
+        scope.builder.NewNode(node2type_[node_id], nodes[node_id].name.value_or(""));
     node2cooked_[node_id] = &cnode;
 
     if (!cnode.GetName().empty() && !rgraph_[node_id].empty()) {
-        symbols_registry_.AddLocalFunction(cnode.GetName(), cnode.GetType());
+        scope.symbols_registry.AddLocalFunction(cnode.GetName(), cnode.GetType());
     }
 
     for (auto [parent_id, conn_id] : rgraph_[node_id]) {
@@ -249,17 +448,17 @@ std::optional<CookingError> Cooker::CookNodeAndIncomingArrows(size_t node_id) {
         assert(conn.pin_idx < parent_node->OutPins().size());
 
         auto& out_pin = parent_node->OutPins()[conn.pin_idx];
-        auto maybe_morphism = CookMorphism(conn.morphism);
+        auto maybe_morphism = CookMorphism(conn.morphism, scope);
 
         if (!maybe_morphism) {
             return maybe_morphism.error();
         }
 
-        builder_.Connect(out_pin, cnode, std::move(maybe_morphism.value()));
+        scope.builder.Connect(out_pin, cnode, std::move(maybe_morphism.value()));
     }
 
     for (const std::string& raw_brancher : node.branchers) {
-        auto maybe_brancher = CookBrancher(raw_brancher);
+        auto maybe_brancher = CookBrancher(raw_brancher, scope);
 
         if (!maybe_brancher) {
             return maybe_brancher.error();
@@ -268,7 +467,7 @@ std::optional<CookingError> Cooker::CookNodeAndIncomingArrows(size_t node_id) {
         auto& brancher = maybe_brancher.value();
 
         if (std::holds_alternative<lang::Pattern>(brancher)) {
-            AddSymbolsForPattern(std::get<lang::Pattern>(brancher), cnode.GetType());
+            AddSymbolsForPattern(std::get<lang::Pattern>(brancher), cnode.GetType(), scope);
         }
 
         std::visit(
@@ -281,8 +480,42 @@ std::optional<CookingError> Cooker::CookNodeAndIncomingArrows(size_t node_id) {
     return std::nullopt;
 }
 
-CookingResult<lang::MorphismPtr> Cooker::CookMorphism(const std::string& raw) {
-    auto maybe_morphism = parsers::MorphismParser(raw, symbols_registry_).Parse();
+// Functions only share node types, global functions and the parse cache, and only the cache is
+// written to by now. Each one gets its own local symbols and builder. Programs are returned in
+// the order of roots, so merging them gives the same result as cooking one by one.
+CookingResult<std::vector<lang::CatProgram>> Cooker::CookFunctionsInParallel(
+    std::span<const size_t> root_ids) {
+    std::vector<lang::CatProgramBuilder> builders(root_ids.size());
+    std::vector<std::optional<CookingError>> errors(root_ids.size());
+
+    // Workers intern types into the caller's universe
+    lang::TypeUniverse* universe = lang::TypeUniverse::Current();
+
+    thread_pool_.ParallelFor(root_ids.size(), [&](size_t i) {
+        lang::TypeUniverse::Scope universe_scope(universe);
+        auto symbols_registry = symbols_registry_.Fork();
+        FunctionScope scope{symbols_registry, builders[i]};
+
+        errors[i] = CookFunction(root_ids[i], scope);
+    });
+
+    std::vector<lang::CatProgram> programs;
+    programs.reserve(root_ids.size());
+
+    for (auto [builder, maybe_err] : std::views::zip(builders, errors)) {
+        if (maybe_err.has_value()) {
+            return std::unexpected(maybe_err.value());
+        }
+
+        programs.push_back(builder.Extract());
+    }
+
+    return programs;
+}
+
+CookingResult<lang::MorphismPtr> Cooker::CookMorphism(const std::string& raw,
+                                                      FunctionScope& scope) {
+    auto maybe_morphism = parse_cache_.ParseMorphism(raw, scope.symbols_registry);
     if (!maybe_morphism) {
         return std::unexpected(CookingError::From(maybe_morphism.error()));
     }
@@ -290,7 +523,7 @@ CookingResult<lang::MorphismPtr> Cooker::CookMorphism(const std::string& raw) {
     return std::move(maybe_morphism.value());
 }
 
-CookingResult<CookedBrancher> Cooker::CookBrancher(const std::string& raw) {
+CookingResult<CookedBrancher> Cooker::CookBrancher(const std::string& raw, FunctionScope& scope) {
     size_t pos = 0;
     while (pos < raw.size() && std::isspace(raw[pos])) {
         ++pos;
@@ -301,14 +534,14 @@ CookingResult<CookedBrancher> Cooker::CookBrancher(const std::string& raw) {
     }
 
     if (raw[pos] == '|') {
-        return CookGuard(raw.substr(pos + 1));
+        return CookGuard(raw.substr(pos + 1), scope);
     }
 
-    return CookPattern(raw);
+    return CookPattern(raw, scope);
 }
 
-CookingResult<lang::Pattern> Cooker::CookPattern(const std::string& raw) {
-    auto maybe_pattern = parsers::PatternParser(raw, symbols_registry_).Parse();
+CookingResult<lang::Pattern> Cooker::CookPattern(const std::string& raw, FunctionScope& scope) {
+    auto maybe_pattern = parse_cache_.ParsePattern(raw, scope.symbols_registry);
     if (!maybe_pattern) {
         return std::unexpected(CookingError::From(maybe_pattern.error()));
     }
@@ -316,8 +549,8 @@ CookingResult<lang::Pattern> Cooker::CookPattern(const std::string& raw) {
     return std::move(maybe_pattern.value());
 }
 
-CookingResult<lang::Guard> Cooker::CookGuard(const std::string& raw) {
-    auto maybe_morphism = parsers::MorphismParser(raw, symbols_registry_).Parse();
+CookingResult<lang::Guard> Cooker::CookGuard(const std::string& raw, FunctionScope& scope) {
+    auto maybe_morphism = parse_cache_.ParseMorphism(raw, scope.symbols_registry);
     if (!maybe_morphism) {
         return MakeCookingError(maybe_morphism.error().Error());
     }
@@ -332,52 +565,354 @@ CookingResult<lang::Guard> Cooker::CookGuard(const std::string& raw) {
 }
 
 void Cooker::BuildGraphs() {
-    graph_.resize(raw_program_.GetNodes().size());
-    rgraph_.resize(raw_program_.GetNodes().size());
-
-    for (auto [i, conn] : util::Enumerate(raw_program_.GetConnections())) {
-        graph_[conn.source_node].emplace_back(conn.target_node, i);
-        rgraph_[conn.target_node].emplace_back(conn.source_node, i);
-    }
+    size_t nodes_num = raw_program_.GetNodes().size();
+    const auto& conns = raw_program_.GetConnections();
+
+    graph_ = util::CsrGraph::Build(nodes_num, conns.size(), [&conns](size_t i) {
+        return std::pair{conns[i].source_node, conns[i].target_node};
+    });
+    rgraph_ = util::CsrGraph::Build(nodes_num, conns.size(), [&conns](size_t i) {
+        return std::pair{conns[i].target_node, conns[i].source_node};
+    });
 }
 
 bool Cooker::HasOrientedCycles() const {
-    std::vector<char> color(graph_.size(), 0);
+    // 0 - not visited, 1 - on the stack, 2 - done
+    std::vector<char> color(graph_.Size(), 0);
+    // Node and the index of its next child
+    std::vector<std::pair<size_t, size_t>> stack;
+
+    for (size_t start = 0; start < graph_.Size(); ++start) {
+        if (color[start]) {
+            continue;
+        }
 
-    auto dfs = [&](auto& self, size_t v) -> bool {
-        color[v] = 1;
-        for (auto [u, _] : graph_[v]) {
-            if (color[u] == 1) {
-                return true;
+        color[start] = 1;
+        stack.emplace_back(start, 0);
+
+        while (!stack.empty()) {
+            auto& [v, next] = stack.back();
+
+            if (next == graph_[v].size()) {
+                color[v] = 2;
+                stack.pop_back();
+                continue;
             }
 
-            if (!color[u] && self(self, u)) {
+            size_t u = graph_[v][next++].node;
+            if (color[u] == 1) {
                 return true;
             }
-        }
-        color[v] = 2;
-        return false;
-    };
 
-    for (size_t v = 0; v < graph_.size(); ++v) {
-        if (!color[v] && dfs(dfs, v)) {
-            return true;
+            if (!color[u]) {
+                color[u] = 1;
+                stack.emplace_back(u, 0);
+            }
         }
     }
 
     return false;
 }
 
-void Cooker::AddSymbolsForPattern(const lang::Pattern& pattern, lang::Type node_type) {
-    auto mapping = pattern.GetNamesMapping(symbols_registry_, node_type);
+void Cooker::AddSymbolsForPattern(const lang::Pattern& pattern, lang::Type node_type,
+                                  FunctionScope& scope) {
+    auto mapping = pattern.GetNamesMapping(scope.symbols_registry, node_type);
     for (auto&& [name, type] : mapping) {
-        symbols_registry_.AddLocalFunction(name, type);
+        scope.symbols_registry.AddLocalFunction(name, type);
     }
 }
 
+namespace {
+
+// Lengths go before strings, so that different contents can't make the same key
+void AppendToKey(std::string& key, size_t n) {
+    key.append(reinterpret_cast<const char*>(&n), sizeof(n));
+}
+
+void AppendToKey(std::string& key, std::string_view s) {
+    AppendToKey(key, s.size());
+    key += s;
+}
+
+// Kept functions outlive the type universe they were cooked in
+void PinTypes(const lang::CatProgram& program, lang::PinnedTypes& pins) {
+    for (const auto& node : program.GetNodes()) {
+        pins.Add(node.GetType());
+
+        for (const auto& out_pin : node.OutPins()) {
+            if (const auto* guard = std::get_if<lang::Guard>(&out_pin.GetBrancher())) {
+                lang::PinTypes(guard->GetMorphism(), pins);
+            }
+        }
+    }
+
+    // Children of interned morphisms are interned too
+    const lang::MorphismInterner& morphisms = program.GetMorphisms();
+    for (uint32_t id = 0; id < morphisms.Size(); ++id) {
+        const lang::Morphism& morphism = *morphisms.GetMorphism(id);
+        pins.Add(morphism.GetSource());
+        pins.Add(morphism.GetTarget());
+    }
+}
+
+}  // namespace
+
+// Everything the cooked function is made of, with nodes numbered within the function, so that
+// edits of other functions don't change it
+std::string Cooker::MakeFunctionKey(std::span<const size_t> node_ids) const {
+    auto& nodes = raw_program_.GetNodes();
+    auto& conns = raw_program_.GetConnections();
+
+    std::unordered_map<size_t, size_t> node2local;
+    for (auto [i, node_id] : util::Enumerate(node_ids)) {
+        node2local.emplace(node_id, i);
+    }
+
+    std::string key;
+    AppendToKey(key, node_ids.size());
+
+    for (size_t node_id : node_ids) {
+        const auto& node = nodes[node_id];
+
+        AppendToKey(key, node.type);
+        AppendToKey(key, node.name.has_value());
+        AppendToKey(key, node.name.value_or(""));
+        AppendToKey(key, node.has_input);
+
+        AppendToKey(key, node.branchers.size());
+        for (const auto& brancher : node.branchers) {
+            AppendToKey(key, brancher);
+        }
+
+        // In the order the cooked arrows are added
+        AppendToKey(key, rgraph_[node_id].size());
+        for (auto [parent_id, conn_id] : rgraph_[node_id]) {
+            AppendToKey(key, node2local.at(parent_id));
+            AppendToKey(key, conns[conn_id].pin_idx);
+            AppendToKey(key, conns[conn_id].morphism);
+        }
+    }
+
+    return key;
+}
+
+// Other functions that the function's morphisms and branchers may call, with their types.
+// Names are picked from the raw text, so it may list a function that isn't really called
+Callees Cooker::FindCallees(std::span<const size_t> node_ids,
+                            const std::unordered_map<std::string, lang::Type>& functions) const {
+    auto& nodes = raw_program_.GetNodes();
+    auto& conns = raw_program_.GetConnections();
+    Callees callees;
+
+    auto add_names = [&](const std::string& raw) {
+        for (size_t i = 0; i < raw.size();) {
+            size_t j = i;
+            while (j < raw.size() && (std::isalnum(raw[j]) || raw[j] == '_' || raw[j] == '\'')) {
+                ++j;
+            }
+
+            if (j == i) {
+                ++i;
+                continue;
+            }
+
+            auto it = functions.find(raw.substr(i, j - i));
+            if (it != functions.end()) {
+                callees.emplace_back(it->first, it->second);
+            }
+            i = j;
+        }
+    };
+
+    for (size_t node_id : node_ids) {
+        for (const auto& brancher : nodes[node_id].branchers) {
+            add_names(brancher);
+        }
+        for (auto [_, conn_id] : rgraph_[node_id]) {
+            add_names(conns[conn_id].morphism);
+        }
+    }
+
+    return callees;
+}
+
 CookingResult<lang::CatProgram> Cook(const RawCatProgram& raw_program,
                                      hs::HaskellSymbolsRegistry& symbols_registry) {
-    return Cooker(raw_program, symbols_registry).Cook();
+    return Cook(raw_program, symbols_registry, util::ThreadPool::Global());
+}
+
+CookingResult<lang::CatProgram> Cook(const RawCatProgram& raw_program,
+                                     hs::HaskellSymbolsRegistry& symbols_registry,
+                                     util::ThreadPool& thread_pool) {
+    parsers::ParseCache parse_cache(symbols_registry);
+    return Cooker(raw_program, symbols_registry, parse_cache, thread_pool).Cook();
+}
+
+IncrementalCooker::IncrementalCooker(hs::HaskellSymbolsRegistry& symbols_registry,
+                                     util::ThreadPool& thread_pool)
+    : symbols_registry_(symbols_registry),
+      thread_pool_(thread_pool),
+      parse_cache_(symbols_registry),
+      lib_generation_(symbols_registry.GetLibGeneration()) {
+}
+
+CookingResult<lang::CatProgram> IncrementalCooker::Cook(const RawCatProgram& raw_program) {
+    if (symbols_registry_.GetLibGeneration() != lib_generation_) {
+        Invalidate();
+        lib_generation_ = symbols_registry_.GetLibGeneration();
+    }
+
+    Cooker cooker(raw_program, symbols_registry_, parse_cache_, thread_pool_);
+    cooker.BuildGraphs();
+
+    if (cooker.HasOrientedCycles()) {
+        return MakeCookingError("program can't have oriented cycles");
+    }
+
+    auto maybe_func_roots = cooker.DiscoverFunctions();
+    if (!maybe_func_roots) {
+        return std::unexpected(maybe_func_roots.error());
+    }
+
+    const std::vector<size_t>& func_roots = maybe_func_roots.value();
+    auto func2nodes = cooker.GroupNodesByFunction(func_roots);
+    auto& nodes = raw_program.GetNodes();
+
+    std::vector<std::string> keys;
+    std::vector<lang::Type> func_types;
+    std::vector<char> has_node_types(func_roots.size(), false);
+
+    for (const auto& func_nodes : func2nodes) {
+        keys.push_back(cooker.MakeFunctionKey(func_nodes));
+    }
+
+    // Symbols are only looked up for functions that weren't cooked before
+    std::vector<size_t> new_node_ids;
+    for (auto [i, key] : util::Enumerate(keys)) {
+        if (!functions_.contains(key)) {
+            new_node_ids.insert(new_node_ids.end(), func2nodes[i].begin(), func2nodes[i].end());
+        }
+    }
+    cooker.PrefetchSymbols(new_node_ids);
+
+    // Node types are parsed only for functions that weren't cooked before
+    for (auto [i, root_id] : util::Enumerate(func_roots)) {
+        auto it = functions_.find(keys[i]);
+        if (it != functions_.end()) {
+            func_types.push_back(it->second.type);
+            continue;
+        }
+
+        auto maybe_err = cooker.CookNodeTypes(func2nodes[i]);
+        if (maybe_err.has_value()) {
+            return std::unexpected(maybe_err.value());
+        }
+        has_node_types[i] = true;
+
+        auto maybe_type = cooker.CookFunctionType(root_id);
+        if (!maybe_type) {
+            return std::unexpected(maybe_type.error());
+        }
+        func_types.push_back(maybe_type.value());
+    }
+
+    symbols_registry_.ResetGlobalFunctions();
+    std::unordered_map<std::string, lang::Type> global_functions;
+
+    for (auto [root_id, func_type] : std::views::zip(func_roots, func_types)) {
+        const std::string& name = nodes[root_id].name.value();
+        symbols_registry_.AddGlobalFunction(name, func_type.Pure());
+        global_functions.emplace(name, func_type.Pure());
+    }
+
+    cooker.node2cooked_.resize(nodes.size(), nullptr);
+
+    // Functions whose arrows or callees have changed are cooked again, all at once
+    std::vector<Callees> func_callees;
+    std::vector<size_t> recooked_ids;
+    std::vector<size_t> recooked_roots;
+
+    for (auto [i, root_id] : util::Enumerate(func_roots)) {
+        func_callees.push_back(cooker.FindCallees(func2nodes[i], global_functions));
+
+        auto it = functions_.find(keys[i]);
+        if (it != functions_.end() && it->second.callees == func_callees.back()) {
+            continue;
+        }
+
+        if (!has_node_types[i]) {
+            auto maybe_err = cooker.CookNodeTypes(func2nodes[i]);
+            if (maybe_err.has_value()) {
+                return std::unexpected(maybe_err.value());
+            }
+        }
+
+        recooked_ids.push_back(i);
+        recooked_roots.push_back(root_id);
+    }
+
+    std::vector<lang::CatProgram> recooked_programs;
+
+    if (recooked_roots.size() > 1 && thread_pool_.GetThreadsNum() > 0) {
+        auto maybe_programs = cooker.CookFunctionsInParallel(recooked_roots);
+        if (!maybe_programs) {
+            return std::unexpected(maybe_programs.error());
+        }
+        recooked_programs = std::move(maybe_programs.value());
+    } else {
+        for (size_t root_id : recooked_roots) {
+            lang::CatProgramBuilder func_builder;
+            Cooker::FunctionScope scope{symbols_registry_, func_builder};
+            auto maybe_err = cooker.CookFunction(root_id, scope);
+            if (maybe_err.has_value()) {
+                return std::unexpected(maybe_err.value());
+            }
+            recooked_programs.push_back(func_builder.Extract());
+        }
+    }
+
+    for (auto [i, program] : std::views::zip(recooked_ids, recooked_programs)) {
+        lang::PinnedTypes pins;
+        PinTypes(program, pins);
+        pins.Add(func_types[i]);
+        for (lang::Type callee_type : func_callees[i] | std::views::values) {
+            pins.Add(callee_type);
+        }
+        functions_.insert_or_assign(keys[i],
+                                    CookedFunction{.callees = std::move(func_callees[i]),
+                                                   .type = func_types[i],
+                                                   .program = std::move(program),
+                                                   .pins = std::move(pins)});
+    }
+    recooked_num_ = recooked_ids.size();
+
+    lang::CatProgramBuilder builder;
+    std::unordered_set<std::string_view> used_keys;
+
+    for (const auto& key : keys) {
+        builder.Append(functions_.at(key).program);
+        used_keys.insert(key);
+    }
+
+    // Whatever wasn't used is gone from the program
+    std::erase_if(functions_, [&](const auto& entry) {
+        return !used_keys.contains(entry.first);
+    });
+
+    return builder.Extract();
+}
+
+void IncrementalCooker::Invalidate() {
+    functions_.clear();
+    parse_cache_.Clear();
+}
+
+size_t IncrementalCooker::GetRecookedNum() const {
+    return recooked_num_;
+}
+
+const parsers::ParseCache& IncrementalCooker::GetParseCache() const {
+    return parse_cache_;
 }
 
 }  // namespace komaru::translate
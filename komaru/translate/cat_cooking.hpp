@@ -2,10 +2,16 @@
 
 #include <komaru/lang/cat_program.hpp>
 #include <komaru/parsers/parser_result.hpp>
+#include <komaru/parsers/parse_cache.hpp>
 #include <komaru/translate/raw_cat_program.hpp>
 #include <komaru/translate/haskell/hs_symbols_registry.hpp>
+#include <komaru/util/thread_pool.hpp>
 
 #include <expected>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace komaru::translate {
 
@@ -27,6 +33,9 @@ private:
     std::string msg_;
 };
 
+// Functions a function calls and their types, in the order of calls
+using Callees = std::vector<std::pair<std::string, lang::Type>>;
+
 template <typename T>
 using CookingResult = std::expected<T, CookingError>;
 
@@ -35,5 +44,41 @@ inline auto MakeCookingError(std::string msg) {
 }
 
 CookingResult<lang::CatProgram> Cook(const RawCatProgram& program, hs::HaskellSymbolsRegistry& reg);
+// Functions are cooked on the pool's workers, each one independently of the others
+CookingResult<lang::CatProgram> Cook(const RawCatProgram& program, hs::HaskellSymbolsRegistry& reg,
+                                     util::ThreadPool& thread_pool);
+
+// Cooks the same program over and over as it's being edited. Cooked functions are kept
+// between runs and reused until their nodes or arrows change, or until a function they may
+// call changes its type. Their types are pinned, so each run may have its own type universe.
+class IncrementalCooker {
+public:
+    // Changed functions are cooked again on the pool's workers
+    explicit IncrementalCooker(hs::HaskellSymbolsRegistry& symbols_registry,
+                               util::ThreadPool& thread_pool = util::ThreadPool::Global());
+
+    CookingResult<lang::CatProgram> Cook(const RawCatProgram& program);
+    // Drops everything cooked so far. Done by Cook itself once the registry is reloaded.
+    void Invalidate();
+    // How many functions the last Cook had to cook instead of reusing them
+    size_t GetRecookedNum() const;
+    const parsers::ParseCache& GetParseCache() const;
+
+private:
+    struct CookedFunction {
+        Callees callees;
+        lang::Type type;
+        lang::CatProgram program;
+        lang::PinnedTypes pins;
+    };
+
+    hs::HaskellSymbolsRegistry& symbols_registry_;
+    util::ThreadPool& thread_pool_;
+    parsers::ParseCache parse_cache_;
+    // By the function's raw nodes and arrows, see Cooker::MakeFunctionKey
+    std::unordered_map<std::string, CookedFunction> functions_;
+    uint64_t lib_generation_;
+    size_t recooked_num_{0};
+};
 
 }  // namespace komaru::translate
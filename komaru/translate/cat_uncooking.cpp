@@ -16,7 +16,7 @@ void UncookArrow(RawCatProgram& raw_program, const CPArrow& arrow, RawNodeID sou
 std::string ToString(const CPBrancher& brancher);
 
 RawCatProgram Uncook(const lang::CatProgram& program) {
-    auto& nodes = program.GetNodes();
+    auto nodes = program.GetNodes();
     RawCatProgram raw_program;
     std::unordered_map<const CPNode*, RawNodeID> node2id;
 
@@ -44,7 +44,7 @@ RawNodeID UncookNode(RawCatProgram& raw_program, const CPNode& node) {
         maybe_name.emplace(node.GetName());
     }
 
-    auto& out_pins = node.OutPins();
+    auto out_pins = node.OutPins();
     branchers.reserve(out_pins.size());
 
     for (const auto& pin : out_pins) {
@@ -1,16 +1,119 @@
 #include "cond.hpp"
 
-#include <komaru/util/string.hpp>
-
-#include <set>
+#include <algorithm>
+#include <bit>
+#include <cassert>
 
 namespace komaru::translate::common {
 
+namespace {
+
+template <typename Clause>
+void Trim(Clause& clause) {
+    while (!clause.empty() && clause.back() == 0) {
+        clause.pop_back();
+    }
+}
+
+template <typename Clause>
+uint64_t GetWord(const Clause& clause, size_t i) {
+    return i < clause.size() ? clause[i] : 0;
+}
+
+// Every literal of `a` is in `b`, i.e. `b` implies `a`
+template <typename Clause>
+bool IsSubset(const Clause& a, const Clause& b) {
+    if (a.size() > b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        if ((a[i] & ~b[i]) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename Clause>
+Clause Union(const Clause& a, const Clause& b) {
+    Clause res;
+    size_t size = std::max(a.size(), b.size());
+    res.reserve(size);
+
+    for (size_t i = 0; i < size; ++i) {
+        res.push_back(GetWord(a, i) | GetWord(b, i));
+    }
+
+    return res;
+}
+
+// Has both a variable and its negation
+template <typename Clause>
+bool IsContradictory(const Clause& clause) {
+    constexpr uint64_t kPositive = 0x5555555555555555ULL;
+
+    for (uint64_t word : clause) {
+        if ((word & (word >> 1) & kPositive) != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Shorter clauses first, so the absorbing ones come before the absorbed ones
+template <typename Clause>
+bool IsLess(const Clause& a, const Clause& b) {
+    size_t a_literals = 0;
+    size_t b_literals = 0;
+
+    for (uint64_t word : a) {
+        a_literals += std::popcount(word);
+    }
+    for (uint64_t word : b) {
+        b_literals += std::popcount(word);
+    }
+
+    if (a_literals != b_literals) {
+        return a_literals < b_literals;
+    }
+
+    return std::ranges::lexicographical_compare(a, b);
+}
+
+}  // namespace
+
 Cond::Cond() {
+    clauses_.emplace_back();
+}
+
+Cond::Cond(int32_t var_idx)
+    : Cond(var_idx >= 0 ? Literal(2 * static_cast<size_t>(var_idx))
+                        : Literal(2 * static_cast<size_t>(-static_cast<int64_t>(var_idx)) + 1)) {
 }
 
-Cond::Cond(int32_t var_idx) {
-    formula_ = {1, var_idx >= 0 ? var_idx + 1 : var_idx - 1};
+Cond Cond::False() {
+    Cond cond;
+    cond.clauses_.clear();
+    return cond;
+}
+
+Cond Cond::Not(uint32_t var_idx) {
+    return Literal(2 * static_cast<size_t>(var_idx) + 1);
+}
+
+Cond Cond::Literal(size_t bit) {
+    Clause clause;
+    for (size_t i = 0; i <= bit / 64; ++i) {
+        clause.push_back(0);
+    }
+    clause.back() |= uint64_t{1} << (bit % 64);
+
+    Cond cond = False();
+    cond.clauses_.push_back(std::move(clause));
+    return cond;
 }
 
 Cond Cond::operator|(const Cond& o) const {
@@ -19,25 +122,18 @@ Cond Cond::operator|(const Cond& o) const {
 }
 
 Cond Cond::operator&(const Cond& o) const {
-    if (formula_.empty()) {
+    if (IsTrue() || o.IsFalse()) {
         return o;
     }
-    if (o.formula_.empty()) {
+    if (o.IsTrue() || IsFalse()) {
         return *this;
     }
 
-    Cond cond;
-
-    for (size_t i = 0; i < formula_.size(); i += formula_[i] + 1) {
-        int32_t n1 = formula_[i];
-        for (size_t j = 0; j < o.formula_.size(); j += o.formula_[j] + 1) {
-            int32_t n2 = o.formula_[j];
+    Cond cond = False();
 
-            cond.formula_.push_back(n1 + n2);
-            cond.formula_.append_range(
-                std::ranges::subrange(formula_.begin() + i + 1, formula_.begin() + i + 1 + n1));
-            cond.formula_.append_range(
-                std::ranges::subrange(o.formula_.begin() + j + 1, o.formula_.begin() + j + 1 + n2));
+    for (const Clause& a : clauses_) {
+        for (const Clause& b : o.clauses_) {
+            cond.AddClause(Union(a, b));
         }
     }
 
@@ -45,12 +141,17 @@ Cond Cond::operator&(const Cond& o) const {
 }
 
 Cond& Cond::operator|=(const Cond& o) {
-    if (formula_.empty() || o.formula_.empty()) {
-        formula_ = {};
+    if (IsTrue() || o.IsFalse()) {
         return *this;
     }
+    if (o.IsTrue() || IsFalse()) {
+        return *this = o;
+    }
+
+    for (const Clause& clause : o.clauses_) {
+        AddClause(clause);
+    }
 
-    formula_.insert_range(formula_.end(), o.formula_);
     return *this;
 }
 
@@ -59,68 +160,88 @@ Cond& Cond::operator&=(const Cond& o) {
 }
 
 std::string Cond::ToString() const {
-    if (formula_.empty()) {
+    if (IsTrue()) {
         return "true";
     }
+    if (IsFalse()) {
+        return "false";
+    }
 
     std::string res;
 
-    auto var_to_string = [](int32_t var) {
-        if (var > 0) {
-            return "v" + std::to_string(var - 1);
-        }
-        return "~v" + std::to_string(-(var + 1));
-    };
-
-    for (size_t i = 0; i < formula_.size(); i += formula_[i] + 1) {
-        int32_t n = formula_[i];
-        if (n == 1) {
-            res += var_to_string(formula_[i + 1]);
-        } else {
-            res += "(";
-            for (int32_t j = 0; j < n; ++j) {
-                res += var_to_string(formula_[i + 1 + j]);
-                if (j + 1 != n) {
-                    res += " & ";
-                }
+    for (const auto& clause : clauses_) {
+        std::vector<std::string> literals;
+
+        for (size_t i = 0; i < clause.size(); ++i) {
+            for (uint64_t word = clause[i]; word != 0; word &= word - 1) {
+                size_t bit = 64 * i + std::countr_zero(word);
+                literals.push_back((bit % 2 == 0 ? "v" : "~v") + std::to_string(bit / 2));
             }
-            res += ")";
         }
 
-        if (i + n + 1 < formula_.size()) {
+        if (!res.empty()) {
             res += " | ";
         }
+
+        if (literals.size() == 1) {
+            res += literals[0];
+            continue;
+        }
+
+        res += "(";
+        for (size_t j = 0; j < literals.size(); ++j) {
+            res += literals[j];
+            if (j + 1 != literals.size()) {
+                res += " & ";
+            }
+        }
+        res += ")";
     }
 
     return res;
 }
 
+// Every clause must be subsumed by some clause of `o`. It's exact for formulas without
+// negations, with them it may miss implications that need case analysis
 bool Cond::DoesImply(const Cond& o) const {
-    if (o.formula_.empty()) {
+    if (o.IsTrue() || IsFalse() || *this == o) {
         return true;
     }
 
-    for (size_t i = 0; i < formula_.size(); i += formula_[i] + 1) {
-        int32_t n1 = formula_[i];
-        std::set<int32_t> st(formula_.begin() + i + 1, formula_.begin() + i + 1 + n1);
+    return std::ranges::all_of(clauses_, [&o](const Clause& clause) {
+        return std::ranges::any_of(o.clauses_, [&clause](const Clause& o_clause) {
+            return IsSubset(o_clause, clause);
+        });
+    });
+}
 
-        for (size_t j = 0; j < o.formula_.size(); j += o.formula_[j] + 1) {
-            int32_t n2 = o.formula_[j];
+bool Cond::IsTrue() const {
+    return clauses_.size() == 1 && clauses_.front().empty();
+}
 
-            bool ok = true;
+bool Cond::IsFalse() const {
+    return clauses_.empty();
+}
 
-            for (int32_t var_idx : std::ranges::subrange(o.formula_.begin() + j + 1,
-                                                         o.formula_.begin() + j + 1 + n2)) {
-                ok = ok && st.contains(var_idx);
-            }
+void Cond::AddClause(Clause clause) {
+    Trim(clause);
 
-            if (ok) {
-                return true;
-            }
+    if (IsContradictory(clause)) {
+        return;
+    }
+
+    for (const Clause& existing : clauses_) {
+        if (IsSubset(existing, clause)) {
+            return;
         }
     }
 
-    return false;
+    std::erase_if(clauses_, [&clause](const Clause& existing) {
+        return IsSubset(clause, existing);
+    });
+
+    auto it = std::ranges::lower_bound(clauses_, clause, IsLess<Clause>);
+    clauses_.insert(it, std::move(clause));
 }
 
 }  // namespace komaru::translate::common
@@ -1,28 +1,51 @@
 #pragma once
+#include <komaru/util/small_vector.hpp>
+
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace komaru::translate::common {
 
-// Boolean formula stored as DNF
+// Boolean formula stored as DNF in a canonical form: contradictory clauses are dropped,
+// a clause implied by another one is absorbed by it and clauses are sorted. Hence equal
+// formulas built in different orders compare equal and stay as small as possible
 class Cond {
 public:
+    // The true formula
     Cond();
+    // Variable var_idx, or the negation of variable -var_idx for negative indices
     explicit Cond(int32_t var_idx);
 
+    static Cond False();
+    // Negation of variable var_idx, variable 0 included
+    static Cond Not(uint32_t var_idx);
+
     Cond operator|(const Cond& o) const;
     Cond operator&(const Cond& o) const;
     Cond& operator|=(const Cond& o);
     Cond& operator&=(const Cond& o);
 
+    bool operator==(const Cond& o) const = default;
+
     std::string ToString() const;
+    // True, false and equal formulas are answered at once, others take a subset check
+    // for every pair of clauses
     bool DoesImply(const Cond& o) const;
+    bool IsTrue() const;
+    bool IsFalse() const;
+
+private:
+    // Conjunction of literals as a bitset: bit 2i is variable i and bit 2i + 1 is its negation.
+    // Trailing zero words are trimmed, so equal clauses have equal words
+    using Clause = util::SmallVector<uint64_t, 1>;
+
+    static Cond Literal(size_t bit);
+
+    void AddClause(Clause clause);
 
 private:
-    // stored in the format {n_1, i_1, i_2, ..., i_{n_1}, n_2, j_1, j_2, ..., j_{n_2}, ...}
-    // = (i_1 & i_2 & ... & i_{n_1}) | (j_1 & j_2 & ... & j_{n_2}) | ...
-    // boolean negation is represented by negative indices
-    std::vector<int32_t> formula_;
+    std::vector<Clause> clauses_;
 };
 
 }  // namespace komaru::translate::common
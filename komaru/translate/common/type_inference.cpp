@@ -0,0 +1,629 @@
+#include "type_inference.hpp"
+
+#include <komaru/util/flat_map.hpp>
+#include <komaru/util/std_extensions.hpp>
+
+#include <cassert>
+#include <format>
+#include <queue>
+#include <unordered_set>
+#include <array>
+#include <span>
+
+namespace komaru::translate::common {
+
+namespace {
+
+using CPNode = lang::CatProgram::Node;
+using CPArrow = lang::CatProgram::Arrow;
+
+using CellID = uint32_t;
+
+enum class CellKind : uint8_t {
+    Var,          // unknown type, name is only used for printing
+    Common,       // concrete type constructor `name` applied to children
+    App,          // type variable constructor (first child) applied to the rest of children
+    Constructor,  // concrete type constructor `name` with arity `children_num`
+    Tuple,
+    Function,  // children are source and target
+    List,
+};
+
+struct Cell {
+    CellKind kind;
+    lang::Symbol name;
+    uint32_t children_begin{0};
+    uint32_t children_num{0};
+};
+
+// Maps type variable names of one annotation to their cells
+using TypeEnv = util::FlatMap<lang::Symbol, CellID>;
+
+class TypeSolver {
+public:
+    CellID NewVar(lang::Symbol name = {}) {
+        return NewCell(CellKind::Var, name, {});
+    }
+
+    CellID NewCell(CellKind kind, lang::Symbol name, std::span<const CellID> children) {
+        auto id = static_cast<CellID>(cells_.size());
+        cells_.push_back(Cell{
+            .kind = kind,
+            .name = name,
+            .children_begin = static_cast<uint32_t>(children_.size()),
+            .children_num = static_cast<uint32_t>(children.size()),
+        });
+        children_.insert(children_.end(), children.begin(), children.end());
+        parent_.push_back(id);
+        rank_.push_back(0);
+        return id;
+    }
+
+    CellID Instantiate(lang::Type type, TypeEnv& env) {
+        // Concrete types have no variables inside, so their cells can be shared
+        bool is_concrete = type.IsConcrete();
+        if (is_concrete) {
+            auto it = concrete_cells_.find(type);
+            if (it != concrete_cells_.end()) {
+                return it->second;
+            }
+        }
+
+        CellID cell = type.Visit(util::Overloaded{
+            [&](const lang::CommonType& t) -> CellID {
+                if (t.IsAuto()) {
+                    return NewVar();
+                }
+
+                std::vector<CellID> children;
+                bool is_var = !lang::IsConcreteTypeName(t.GetName());
+                if (is_var) {
+                    children.push_back(EnvVar(t.GetSymbol(), env));
+                    if (!t.HasTypeParams()) {
+                        return children.front();
+                    }
+                }
+
+                for (lang::Type param : t.GetTypeParams()) {
+                    children.push_back(Instantiate(param, env));
+                }
+
+                return NewCell(is_var ? CellKind::App : CellKind::Common, t.GetSymbol(), children);
+            },
+            [&](const lang::TupleType& t) -> CellID {
+                std::vector<CellID> children;
+                for (lang::Type inner : t.GetTupleTypes()) {
+                    children.push_back(Instantiate(inner, env));
+                }
+                return NewCell(CellKind::Tuple, {}, children);
+            },
+            [&](const lang::FunctionType& t) -> CellID {
+                std::array children = {Instantiate(t.Source(), env), Instantiate(t.Target(), env)};
+                return NewCell(CellKind::Function, {}, children);
+            },
+            [&](const lang::ListType& t) -> CellID {
+                std::array children = {Instantiate(t.Inner(), env)};
+                return NewCell(CellKind::List, {}, children);
+            },
+        });
+
+        if (is_concrete) {
+            concrete_cells_.emplace(type, cell);
+        }
+
+        return cell;
+    }
+
+    CellID MakeFunctionChain(std::span<const CellID> cells) {
+        CellID res = cells.back();
+        for (size_t i = cells.size() - 1; i > 0; --i) {
+            std::array children = {cells[i - 1], res};
+            res = NewCell(CellKind::Function, {}, children);
+        }
+        return res;
+    }
+
+    CellID Find(CellID cell) {
+        CellID root = cell;
+        while (parent_[root] != root) {
+            root = parent_[root];
+        }
+
+        while (parent_[cell] != root) {
+            cell = std::exchange(parent_[cell], root);
+        }
+
+        return root;
+    }
+
+    // Components of the value stored in the cell: tuple elements or the cell itself
+    std::vector<CellID> GetComponents(CellID cell) {
+        cell = Find(cell);
+        if (cells_[cell].kind == CellKind::Tuple) {
+            auto children = Children(cell);
+            return {children.begin(), children.end()};
+        }
+        return {cell};
+    }
+
+    std::optional<CellID> GetChild(CellID cell, CellKind kind, size_t i) {
+        cell = Find(cell);
+        if (cells_[cell].kind != kind || i >= cells_[cell].children_num) {
+            return std::nullopt;
+        }
+        return Children(cell)[i];
+    }
+
+    bool Unify(CellID a, CellID b) {
+        pending_.clear();
+        pending_.emplace_back(a, b);
+
+        while (!pending_.empty()) {
+            auto [x, y] = pending_.back();
+            pending_.pop_back();
+
+            x = Find(x);
+            y = Find(y);
+            if (x == y) {
+                continue;
+            }
+
+            if (!UnifyRoots(x, y)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Fails on infinite types like `a ~ [a]`
+    std::optional<lang::Type> Resolve(CellID cell) {
+        cell = Find(cell);
+
+        if (resolved_.size() < cells_.size()) {
+            resolved_.resize(cells_.size());
+            in_progress_.resize(cells_.size());
+        }
+
+        if (resolved_[cell].has_value()) {
+            return resolved_[cell];
+        }
+        if (in_progress_[cell]) {
+            return std::nullopt;
+        }
+
+        in_progress_[cell] = true;
+        auto res = ResolveRoot(cell);
+        in_progress_[cell] = false;
+
+        resolved_[cell] = res;
+        return res;
+    }
+
+    std::string ToString(CellID cell) {
+        auto maybe_type = Resolve(cell);
+        if (!maybe_type.has_value()) {
+            return "<infinite type>";
+        }
+        return maybe_type->ToString();
+    }
+
+private:
+    std::span<const CellID> Children(CellID cell) const {
+        const Cell& c = cells_[cell];
+        return std::span(children_).subspan(c.children_begin, c.children_num);
+    }
+
+    CellID EnvVar(lang::Symbol name, TypeEnv& env) {
+        auto it = env.find(name);
+        if (it != env.end()) {
+            return it->second;
+        }
+        CellID var = NewVar(name);
+        env.emplace(name, var);
+        return var;
+    }
+
+    // Variables of different annotations may share a name, e.g. `a` of two library functions,
+    // so every unresolved variable gets a name no other one has
+    lang::Symbol GetVarName(CellID root) {
+        auto it = var_names_.find(root);
+        if (it != var_names_.end()) {
+            return it->second;
+        }
+
+        // Unnamed ones only get here as constructors applied to types
+        lang::Symbol base = cells_[root].name.IsEmpty() ? lang::Symbol("t") : cells_[root].name;
+        lang::Symbol name = base;
+        for (size_t i = 1; used_var_names_.contains(name); ++i) {
+            name = lang::Symbol(std::format("{}{}", base.GetName(), i));
+        }
+
+        used_var_names_.insert(name);
+        var_names_.emplace(root, name);
+        return name;
+    }
+
+    void Link(CellID from, CellID to) {
+        parent_[from] = to;
+    }
+
+    void LinkVars(CellID x, CellID y) {
+        if (rank_[x] > rank_[y]) {
+            std::swap(x, y);
+        }
+        if (rank_[x] == rank_[y]) {
+            ++rank_[y];
+        }
+        if (cells_[y].name.IsEmpty()) {
+            cells_[y].name = cells_[x].name;
+        }
+        Link(x, y);
+    }
+
+    void UnifyChildren(CellID x, CellID y) {
+        for (size_t i = 0; i < cells_[x].children_num; ++i) {
+            pending_.emplace_back(Children(x)[i], Children(y)[i]);
+        }
+    }
+
+    bool UnifyRoots(CellID x, CellID y) {
+        CellKind kx = cells_[x].kind;
+        CellKind ky = cells_[y].kind;
+
+        if (kx == CellKind::Var && ky == CellKind::Var) {
+            LinkVars(x, y);
+            return true;
+        }
+        if (kx == CellKind::Var) {
+            Link(x, y);
+            return true;
+        }
+        if (ky == CellKind::Var) {
+            Link(y, x);
+            return true;
+        }
+
+        if (ky == CellKind::App && kx != CellKind::App) {
+            std::swap(x, y);
+            std::swap(kx, ky);
+        }
+
+        if (kx == CellKind::App) {
+            return UnifyApp(x, y);
+        }
+
+        if (kx != ky || cells_[x].children_num != cells_[y].children_num) {
+            return false;
+        }
+
+        if ((kx == CellKind::Common || kx == CellKind::Constructor) &&
+            cells_[x].name != cells_[y].name) {
+            return false;
+        }
+
+        UnifyChildren(x, y);
+        Link(x, y);
+        return true;
+    }
+
+    // `x` is an application of a type variable constructor
+    bool UnifyApp(CellID x, CellID y) {
+        size_t num_args = cells_[x].children_num - 1;
+        CellID head = Children(x)[0];
+
+        switch (cells_[y].kind) {
+            case CellKind::App:
+                if (cells_[y].children_num != cells_[x].children_num) {
+                    return false;
+                }
+                UnifyChildren(x, y);
+                break;
+            case CellKind::Common:
+                if (cells_[y].children_num != num_args) {
+                    return false;
+                }
+                pending_.emplace_back(head, NewConstructor(cells_[y].name, num_args));
+                for (size_t i = 0; i < num_args; ++i) {
+                    pending_.emplace_back(Children(x)[i + 1], Children(y)[i]);
+                }
+                break;
+            case CellKind::List:
+                if (num_args != 1) {
+                    return false;
+                }
+                pending_.emplace_back(head, NewConstructor(lang::BuiltinSymbol::kList, 1));
+                pending_.emplace_back(Children(x)[1], Children(y)[0]);
+                break;
+            default:
+                return false;
+        }
+
+        Link(x, y);
+        return true;
+    }
+
+    CellID NewConstructor(lang::Symbol name, size_t num_params) {
+        CellID cell = NewCell(CellKind::Constructor, name, {});
+        cells_[cell].children_num = static_cast<uint32_t>(num_params);
+        return cell;
+    }
+
+    std::optional<std::vector<lang::Type>> ResolveChildren(CellID cell, size_t skip = 0) {
+        std::vector<lang::Type> types;
+        for (CellID child : Children(cell).subspan(skip)) {
+            auto maybe_type = Resolve(child);
+            if (!maybe_type.has_value()) {
+                return std::nullopt;
+            }
+            types.push_back(maybe_type.value());
+        }
+        return types;
+    }
+
+    std::optional<lang::Type> ResolveRoot(CellID cell) {
+        const Cell& c = cells_[cell];
+
+        if (c.kind == CellKind::Var) {
+            if (c.name.IsEmpty()) {
+                return lang::Type::Auto();
+            }
+            return lang::Type::Parameterized(GetVarName(cell), {});
+        }
+
+        if (c.kind == CellKind::Constructor) {
+            return lang::Type::Parameterized(c.name, {});
+        }
+
+        auto maybe_types = ResolveChildren(cell, c.kind == CellKind::App ? 1 : 0);
+        if (!maybe_types.has_value()) {
+            return std::nullopt;
+        }
+        auto types = std::move(maybe_types.value());
+
+        if (c.kind == CellKind::Common) {
+            return lang::Type::Parameterized(c.name, std::move(types));
+        }
+        if (c.kind == CellKind::App) {
+            // Either the constructor the variable was bound to or the variable itself
+            CellID head = Find(Children(cell)[0]);
+            lang::Symbol name =
+                cells_[head].kind == CellKind::Var ? GetVarName(head) : cells_[head].name;
+            return lang::Type::Parameterized(name, std::move(types));
+        }
+        if (c.kind == CellKind::Tuple) {
+            return lang::Type::Tuple(std::move(types));
+        }
+        if (c.kind == CellKind::Function) {
+            return lang::Type::Function(types[0], types[1]);
+        }
+
+        assert(c.kind == CellKind::List);
+        return lang::Type::List(types[0]);
+    }
+
+private:
+    std::vector<Cell> cells_;
+    std::vector<CellID> parent_;
+    std::vector<uint8_t> rank_;
+    std::vector<CellID> children_;
+    std::unordered_map<lang::Type, CellID> concrete_cells_;
+    std::vector<std::pair<CellID, CellID>> pending_;
+    std::vector<std::optional<lang::Type>> resolved_;
+    std::vector<bool> in_progress_;
+    std::unordered_map<CellID, lang::Symbol> var_names_;
+    std::unordered_set<lang::Symbol> used_var_names_;
+};
+
+class FunctionTypesInference {
+public:
+    explicit FunctionTypesInference(const CPNode& root)
+        : root_(root) {
+    }
+
+    TranslationResult<FunctionTypes> Infer() && {
+        if (auto maybe_err = Solve()) {
+            return std::unexpected(std::move(maybe_err.value()));
+        }
+
+        FunctionTypes types;
+
+        // Variables are named as they're met, so the order must not depend on pointers
+        for (auto [node, cell] : node_cells_) {
+            auto maybe_type = solver_.Resolve(cell);
+            if (!maybe_type.has_value()) {
+                return MakeTranslationError(
+                    std::format("infinite type deduced for node of type {}",
+                                node->GetType().ToString()));
+            }
+            types.node_types.emplace(node, maybe_type.value());
+        }
+
+        for (auto [arrow, cell] : arrow_cells_) {
+            auto maybe_type = solver_.Resolve(cell);
+            if (!maybe_type.has_value()) {
+                return MakeTranslationError(
+                    std::format("infinite type deduced for arrow with morphism {}",
+                                arrow->GetMorphism()->ToString()));
+            }
+            types.arrow_types.emplace(arrow, maybe_type.value());
+        }
+
+        for (auto [arrow, type] : position_arrow_types_) {
+            types.arrow_types.emplace(arrow, type);
+        }
+
+        if (ret_cell_.has_value()) {
+            auto maybe_type = solver_.Resolve(ret_cell_.value());
+            if (!maybe_type.has_value()) {
+                return MakeTranslationError("infinite type deduced for function result");
+            }
+            types.return_type = maybe_type.value();
+        }
+
+        return types;
+    }
+
+private:
+    std::optional<TranslationError> Solve() {
+        std::unordered_map<const CPNode*, size_t> node2views;
+
+        std::queue<const CPNode*> q;
+        q.push(&root_);
+
+        while (!q.empty()) {
+            const CPNode* node = q.front();
+            q.pop();
+
+            TypeEnv env;
+            CellID node_cell = solver_.Instantiate(node->GetType(), env);
+            node2cell_.emplace(node, node_cell);
+            node_cells_.emplace_back(node, node_cell);
+
+            for (const CPArrow* arrow : node->IncomingArrows()) {
+                if (auto maybe_err = AddArrowConstraints(arrow, node_cell)) {
+                    return maybe_err;
+                }
+            }
+
+            for (const auto& out_pin : node->OutPins()) {
+                for (const CPArrow& arrow : out_pin.Arrows()) {
+                    const CPNode& dst_node = arrow.TargetNode();
+                    size_t n_views = (node2views[&dst_node] += 1);
+
+                    if (n_views == dst_node.IncomingArrows().size()) {
+                        q.push(&dst_node);
+                    }
+                }
+            }
+
+            if (node->OutPins().empty()) {
+                if (!ret_cell_.has_value()) {
+                    ret_cell_ = node_cell;
+                } else if (!solver_.Unify(ret_cell_.value(), node_cell)) {
+                    return TranslationError(
+                        std::format("function returns values of different types: {} and {}",
+                                    solver_.ToString(ret_cell_.value()),
+                                    solver_.ToString(node_cell)));
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::optional<TranslationError> AddArrowConstraints(const CPArrow* arrow, CellID dst_cell) {
+        const CPNode* src_node = &arrow->SourcePin().GetNode();
+        CellID src_cell = node2cell_.at(src_node);
+        const auto& morphism = arrow->GetMorphism();
+
+        if (morphism->Holds<lang::PositionMorphism>()) {
+            return AddPositionConstraints(arrow, src_cell, dst_cell);
+        }
+
+        lang::Type arrow_type = morphism->GetType();
+        std::vector<CellID> src_components = solver_.GetComponents(src_cell);
+
+        auto deduction_error = [&]() {
+            return TranslationError(
+                std::format("failed to deduce destination type for arrow {} -> {}"
+                            "\narrow type: {}, source type: {}, morphism: {}",
+                            src_node->GetType().ToString(), arrow->TargetNode().GetType().ToString(),
+                            arrow_type.ToString(), solver_.ToString(src_cell),
+                            morphism->ToString()));
+        };
+
+        TypeEnv env;
+        CellID deduced_dst_cell = 0;
+
+        if (arrow_type.IsValueType()) {
+            CellID singleton_cell = solver_.Instantiate(lang::Type::Singleton(), env);
+            if (src_components.size() != 1 || !solver_.Unify(src_components[0], singleton_cell)) {
+                return deduction_error();
+            }
+            deduced_dst_cell = solver_.Instantiate(arrow_type.FlattenFunction()[0], env);
+        } else {
+            std::span<const lang::Type> types = arrow_type.FlattenFunction();
+            if (src_components.size() >= types.size()) {
+                return deduction_error();
+            }
+
+            std::vector<CellID> cells;
+            for (lang::Type type : types) {
+                cells.push_back(solver_.Instantiate(type, env));
+            }
+
+            for (size_t i = 0; i < src_components.size(); ++i) {
+                if (!solver_.Unify(cells[i], src_components[i])) {
+                    return deduction_error();
+                }
+            }
+
+            deduced_dst_cell =
+                solver_.MakeFunctionChain(std::span(cells).subspan(src_components.size()));
+        }
+
+        if (!solver_.Unify(dst_cell, deduced_dst_cell)) {
+            return TranslationError(
+                std::format("failed to match types for arrow {} -> {}"
+                            "\ndestination type: {}, deduced destination type: {}, morphism {}",
+                            src_node->GetType().ToString(), arrow->TargetNode().GetType().ToString(),
+                            solver_.ToString(dst_cell), solver_.ToString(deduced_dst_cell),
+                            morphism->ToString()));
+        }
+
+        src_components.push_back(dst_cell);
+        arrow_cells_.emplace_back(arrow, solver_.MakeFunctionChain(src_components));
+
+        return std::nullopt;
+    }
+
+    std::optional<TranslationError> AddPositionConstraints(const CPArrow* arrow, CellID src_cell,
+                                                           CellID dst_cell) {
+        const auto& pos_morphism = arrow->GetMorphism()->GetVariant<lang::PositionMorphism>();
+        position_arrow_types_.emplace_back(arrow, pos_morphism.GetType());
+
+        if (pos_morphism.IsNonePosition()) {
+            return std::nullopt;
+        }
+
+        size_t pos = pos_morphism.GetPosition();
+
+        // Positions of a list node are its elements
+        auto maybe_element_cell = solver_.GetChild(dst_cell, CellKind::List, 0);
+        if (!maybe_element_cell.has_value()) {
+            maybe_element_cell = solver_.GetChild(dst_cell, CellKind::Tuple, pos);
+        }
+
+        if (!maybe_element_cell.has_value()) {
+            return std::nullopt;
+        }
+
+        if (!solver_.Unify(maybe_element_cell.value(), src_cell)) {
+            return TranslationError(
+                std::format("failed to match types for position morphism {}: {} and {}",
+                            pos_morphism.ToString(), solver_.ToString(maybe_element_cell.value()),
+                            solver_.ToString(src_cell)));
+        }
+
+        return std::nullopt;
+    }
+
+private:
+    const CPNode& root_;
+    TypeSolver solver_;
+    std::unordered_map<const CPNode*, CellID> node2cell_;
+    // In BFS order from the root
+    std::vector<std::pair<const CPNode*, CellID>> node_cells_;
+    std::vector<std::pair<const CPArrow*, CellID>> arrow_cells_;
+    std::vector<std::pair<const CPArrow*, lang::Type>> position_arrow_types_;
+    std::optional<CellID> ret_cell_;
+};
+
+}  // namespace
+
+TranslationResult<FunctionTypes> InferFunctionTypes(const lang::CatProgram::Node& root) {
+    return FunctionTypesInference(root).Infer();
+}
+
+}  // namespace komaru::translate::common
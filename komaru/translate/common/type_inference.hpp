@@ -0,0 +1,23 @@
+#pragma once
+#include <komaru/translate/translator.hpp>
+
+#include <unordered_map>
+
+namespace komaru::translate::common {
+
+// Types of a single function's nodes and arrows deduced from each other
+struct FunctionTypes {
+    std::unordered_map<const lang::CatProgram::Node*, lang::Type> node_types;
+    std::unordered_map<const lang::CatProgram::Arrow*, lang::Type> arrow_types;
+    lang::Type return_type;
+};
+
+// Deduces types of the function rooted at `root`.
+// Every node annotation and arrow morphism type is instantiated into mutable type cells,
+// each arrow adds equality constraints between them and the constraints are solved with
+// union-find, so the whole function is solved at once in near-linear time.
+// Type variables are scoped by annotation: `a` in two different nodes are different variables,
+// `auto` is a fresh variable every time it appears.
+TranslationResult<FunctionTypes> InferFunctionTypes(const lang::CatProgram::Node& root);
+
+}  // namespace komaru::translate::common
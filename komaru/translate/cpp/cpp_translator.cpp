@@ -5,6 +5,7 @@
 #include <komaru/translate/cpp/cpp_literal.hpp>
 #include <komaru/translate/cpp/cpp_types.hpp>
 #include <komaru/translate/cpp/cpp_body_builder.hpp>
+#include <komaru/translate/common/type_inference.hpp>
 #include <komaru/util/std_extensions.hpp>
 #include <komaru/util/string.hpp>
 
@@ -120,6 +121,13 @@ void CppTranslator::LoadCatlib() {
 
 TranslationResult<CppFunction> CppTranslator::TranslateMorphismGraph(const CPNode* root) {
     local_name2type_.clear();
+    node2type_.clear();
+
+    auto maybe_types = common::InferFunctionTypes(*root);
+    if (!maybe_types.has_value()) {
+        return std::unexpected(std::move(maybe_types.error()));
+    }
+    node2type_ = std::move(maybe_types->node_types);
 
     auto make_node_name = [local_var_id = size_t(0)](const CPNode* node) mutable {
         if (!node->GetName().empty()) {
@@ -158,7 +166,7 @@ TranslationResult<CppFunction> CppTranslator::TranslateMorphismGraph(const CPNod
             std::string local_name = make_node_name(node);
             node2local_name_[node] = local_name;
             if (!node->GetName().empty()) {
-                local_name2type_.emplace(local_name, node->GetType());
+                local_name2type_.emplace(local_name, GetNodeType(node));
             }
             AddStatementsForNode(body_builder, node_cond, node, local_name);
         } else if (!first_visit) {
@@ -222,7 +230,7 @@ void CppTranslator::AddStatementsForNode(CppBodyBuilder& body_builder,
                                          const std::string& local_name) {
     if (IsIntersectionNode(node)) {
         std::string expr = MakeExprForIntersectionNode(node).AsWholeExpr();
-        auto statement = MakeStatement(node->GetType(), local_name, expr);
+        auto statement = MakeStatement(GetNodeType(node), local_name, expr);
         body_builder.AddStatement(node_cond, std::move(statement));
 
         if (node->OutPins().empty()) {
@@ -233,7 +241,7 @@ void CppTranslator::AddStatementsForNode(CppBodyBuilder& body_builder,
 
     for (const auto* arrow : node->IncomingArrows()) {
         std::string expr = MakeExprForArrow(arrow).AsWholeExpr();
-        auto statement = MakeStatement(node->GetType(), local_name, expr);
+        auto statement = MakeStatement(GetNodeType(node), local_name, expr);
         body_builder.AddStatement(pin2cond_[&arrow->SourcePin()], std::move(statement));
 
         if (node->OutPins().empty()) {
@@ -292,7 +300,15 @@ CppExpr CppTranslator::MakeExprForArrow(const CPArrow* arrow) {
     return MakeExprForMorphism(*arrow->GetMorphism(),
                                CppExpr(node2local_name_[&arrow->SourcePin().GetNode()],
                                        arrow->SourcePin().GetNode().GetType().GetComponentsNum()),
-                               arrow->TargetNode().GetType());
+                               GetNodeType(&arrow->TargetNode()));
+}
+
+lang::Type CppTranslator::GetNodeType(const CPNode* node) const {
+    auto it = node2type_.find(node);
+    if (it != node2type_.end() && it->second.IsConcrete()) {
+        return it->second;
+    }
+    return node->GetType();
 }
 
 std::vector<std::string> CppTranslator::MakeBranchExprs(const CPNode* node) {
@@ -507,36 +523,49 @@ std::optional<TranslationError> CppTranslator::CalcRoots(const lang::CatProgram&
     return std::nullopt;
 }
 
+// Parents go first, a node without incoming arrows is a root of itself
 std::optional<const CppTranslator::CPNode*> CppTranslator::GetRootOrCalcIt(const CPNode* node) {
-    auto it = node2root_.find(node);
-    if (it != node2root_.end()) {
-        return it->second;
-    }
+    struct Frame {
+        const CPNode* node;
+        size_t next_arrow;
+        const CPNode* root;
+    };
 
-    const auto& in_nodes = node->IncomingArrows() | std::views::transform([](CPArrow* arrow) {
-                               return &arrow->SourcePin().GetNode();
-                           });
+    std::vector<Frame> stack;
+    stack.push_back(Frame{.node = node, .next_arrow = 0, .root = nullptr});
 
-    if (in_nodes.empty()) {
-        node2root_.emplace(node, node);
-        return node;
-    }
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const auto& arrows = frame.node->IncomingArrows();
 
-    const CPNode* root = nullptr;
+        if (node2root_.contains(frame.node)) {
+            stack.pop_back();
+            continue;
+        }
 
-    for (const CPNode* in_node : in_nodes) {
-        if (auto in_root = GetRootOrCalcIt(in_node)) {
-            if (root && root != in_root.value()) {
-                return std::nullopt;
-            }
-            root = in_root.value();
-        } else {
+        if (frame.next_arrow == arrows.size()) {
+            node2root_.emplace(frame.node, frame.root ? frame.root : frame.node);
+            stack.pop_back();
+            continue;
+        }
+
+        const CPNode* in_node = &arrows[frame.next_arrow]->SourcePin().GetNode();
+        auto it = node2root_.find(in_node);
+
+        if (it == node2root_.end()) {
+            stack.push_back(Frame{.node = in_node, .next_arrow = 0, .root = nullptr});
+            continue;
+        }
+
+        if (frame.root && frame.root != it->second) {
             return std::nullopt;
         }
+
+        frame.root = it->second;
+        ++frame.next_arrow;
     }
 
-    node2root_.emplace(node, root);
-    return root;
+    return node2root_.at(node);
 }
 
 const CppTranslator::CPNode* CppTranslator::GetRoot(const CPNode* node) {
@@ -54,6 +54,9 @@ private:
     CppExpr MakeExprForMorphism(const lang::ListMorphism& morphism, const CppExpr& in_expr,
                                 lang::Type out_type);
 
+    // Inferred type of the node if it's concrete, otherwise the declared one
+    lang::Type GetNodeType(const CPNode* node) const;
+
     std::vector<std::string> MakeBranchExprs(const CPNode* node);
     std::string MakeStatement(lang::Type type, const std::string& var_name,
                               const std::string& expr);
@@ -77,6 +80,7 @@ private:
     std::unordered_map<const CPNode*, size_t> node2views_;
     std::unordered_map<const CPNode*, std::string> node2local_name_;
     std::unordered_map<const CPOutPin*, common::Cond> pin2cond_;
+    std::unordered_map<const CPNode*, lang::Type> node2type_;
     std::unordered_map<std::string, lang::Type> local_name2type_;
     std::unordered_map<std::string, lang::Type> global_name2type_;
 
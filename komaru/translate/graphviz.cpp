@@ -1,5 +1,6 @@
 #include "graphviz.hpp"
 
+#include <komaru/util/csr_graph.hpp>
 #include <komaru/util/std_extensions.hpp>
 #include <komaru/util/string.hpp>
 #include <komaru/translate/cat_uncooking.hpp>
@@ -12,17 +13,13 @@ using RNode = RawCatProgram::Node;
 using RNodeID = RawCatProgram::NodeID;
 using RConnection = RawCatProgram::Connection;
 
-struct Edge {
-    RNodeID node_id;
-    size_t conn_idx;
-};
-
 struct Component {
     std::vector<RNodeID> nodes;
     std::vector<size_t> connections;
 };
 
-using Graph = std::vector<std::vector<Edge>>;
+// Edges are numbered after connections
+using Graph = util::CsrGraph;
 
 bool IsRegularNode(const RNode& node);
 std::string MakeNodeLabel(const RNode& node);
@@ -31,34 +28,49 @@ std::string MakePinRef(const RNode& node, RNodeID id, size_t pin_idx);
 std::string EscapeGrpaphvizStr(const std::string& s);
 
 std::vector<Component> GetGraphComponents(const Graph& graph) {
-    std::vector<char> visited(graph.size(), false);
+    std::vector<char> visited(graph.Size(), false);
+    // Node and the index of its next edge
+    std::vector<std::pair<RNodeID, size_t>> stack;
+
+    // Nodes in preorder, every connection once it's walked
+    auto dfs = [&](Component& comp, RNodeID start) {
+        visited[start] = true;
+        comp.nodes.push_back(start);
+        stack.emplace_back(start, 0);
+
+        while (!stack.empty()) {
+            auto& [v, next] = stack.back();
+
+            if (next == graph[v].size()) {
+                stack.pop_back();
+                continue;
+            }
 
-    auto dfs = [&](auto& self, Component& comp, size_t v) -> void {
-        visited[v] = true;
-        comp.nodes.push_back(v);
+            auto [u, conn_idx] = graph[v][next++];
+            comp.connections.push_back(conn_idx);
 
-        for (const Edge& e : graph[v]) {
-            comp.connections.push_back(e.conn_idx);
-            if (!visited[e.node_id]) {
-                self(self, comp, e.node_id);
+            if (!visited[u]) {
+                visited[u] = true;
+                comp.nodes.push_back(u);
+                stack.emplace_back(u, 0);
             }
         }
     };
 
-    std::vector<size_t> deg(graph.size());
+    std::vector<size_t> deg(graph.Size());
 
-    for (RNodeID id = 0; id < graph.size(); ++id) {
-        for (const Edge& e : graph[id]) {
-            ++deg[e.node_id];
+    for (RNodeID id = 0; id < graph.Size(); ++id) {
+        for (const auto& e : graph[id]) {
+            ++deg[e.node];
         }
     }
 
     std::vector<Component> components;
 
-    for (RNodeID id = 0; id < graph.size(); ++id) {
+    for (RNodeID id = 0; id < graph.Size(); ++id) {
         if (!deg[id]) {
             components.emplace_back(Component{});
-            dfs(dfs, components.back(), id);
+            dfs(components.back(), id);
         }
     }
 
@@ -66,16 +78,13 @@ std::vector<Component> GetGraphComponents(const Graph& graph) {
 }
 
 Graph BuildGraph(const RawCatProgram& program) {
-    auto& nodes = program.GetNodes();
     auto& connections = program.GetConnections();
 
-    Graph graph(nodes.size());
-
-    for (const auto& [i, conn] : util::Enumerate(connections)) {
-        graph[conn.source_node].emplace_back(Edge{.node_id = conn.target_node, .conn_idx = i});
-    }
-
-    return graph;
+    return util::CsrGraph::Build(program.GetNodes().size(), connections.size(),
+                                 [&connections](size_t i) {
+                                     return std::pair{connections[i].source_node,
+                                                      connections[i].target_node};
+                                 });
 }
 
 std::string ComponentToGraphviz(const Component& component, const std::vector<RNode>& nodes,
@@ -3,16 +3,19 @@
 #include <komaru/parsers/hs_type_parser.hpp>
 
 #include <memory>
+#include <ranges>
 
 namespace komaru::translate::hs {
 
-GHCI::GHCI(PrivateDummy, const std::vector<std::string>& packages)
-    : util::CLIProgramManipulator(MakeStartCommand(packages), "ghci> ") {
+GHCI::GHCI(PrivateDummy, const std::vector<std::string>& packages, std::stop_token stop)
+    : util::CLIProgramManipulator(MakeStartCommand(packages), "ghci> ", true, std::nullopt,
+                                  std::move(stop)) {
 }
 
 std::optional<GHCIPtr> GHCI::CreateSession(const std::vector<std::string>& packages,
-                                           const std::vector<HaskellImport>& imports) {
-    auto ghci = std::make_unique<GHCI>(PrivateDummy{}, packages);
+                                           const std::vector<HaskellImport>& imports,
+                                           std::stop_token stop) {
+    auto ghci = std::make_unique<GHCI>(PrivateDummy{}, packages, std::move(stop));
 
     for (const auto& import : imports) {
         std::string resp = ghci->Interact(import.ToString() + "\n");
@@ -25,45 +28,46 @@ std::optional<GHCIPtr> GHCI::CreateSession(const std::vector<std::string>& packa
 }
 
 std::optional<lang::Type> GHCI::GetType(const std::string& name) {
-    std::string resp = Interact(":t " + name + "\n");
-    if (HasError(resp)) {
-        return std::nullopt;
-    }
+    return ParseTypeResponse(Interact(":t " + name + "\n"));
+}
 
-    auto pos = resp.find("=>");
-    if (pos != std::string::npos) {
-        auto maybe_type = parsers::HsTypeParser(resp.substr(pos + 2)).Parse();
-        if (!maybe_type) {
-            return std::nullopt;
-        }
-        return maybe_type.value();
+std::optional<lang::TypeConstructor> GHCI::GetTypeConstructor(const std::string& name) {
+    return ParseTypeConstructorResponse(name, Interact(":kind " + name + "\n"));
+}
+
+std::vector<std::optional<lang::Type>> GHCI::GetTypes(std::span<const std::string> names) {
+    std::vector<std::string> queries;
+    queries.reserve(names.size());
+    for (const auto& name : names) {
+        queries.push_back(":t " + name + "\n");
     }
 
-    pos = resp.find("::");
-    if (pos != std::string::npos) {
-        auto maybe_type = parsers::HsTypeParser(resp.substr(pos + 2)).Parse();
-        if (!maybe_type) {
-            return std::nullopt;
-        }
-        return maybe_type.value();
+    std::vector<std::optional<lang::Type>> types;
+    types.reserve(names.size());
+    for (const auto& resp : InteractMany(queries)) {
+        types.push_back(ParseTypeResponse(resp));
     }
 
-    return std::nullopt;
+    return types;
 }
 
-std::optional<lang::TypeConstructor> GHCI::GetTypeConstructor(const std::string& name) {
-    std::string resp = Interact(":kind " + name + "\n");
-    if (HasError(resp)) {
-        return std::nullopt;
+std::vector<std::optional<lang::TypeConstructor>> GHCI::GetTypeConstructors(
+    std::span<const std::string> names) {
+    std::vector<std::string> queries;
+    queries.reserve(names.size());
+    for (const auto& name : names) {
+        queries.push_back(":kind " + name + "\n");
     }
 
-    auto pos = resp.find("::");
+    auto responses = InteractMany(queries);
 
-    if (pos == std::string::npos) {
-        return std::nullopt;
+    std::vector<std::optional<lang::TypeConstructor>> type_constructors;
+    type_constructors.reserve(names.size());
+    for (const auto& [name, resp] : std::views::zip(names, responses)) {
+        type_constructors.push_back(ParseTypeConstructorResponse(name, resp));
     }
 
-    return ParseTypeConstructor(name, resp.substr(pos + 2));
+    return type_constructors;
 }
 
 std::vector<std::string> GHCI::MakeStartCommand(const std::vector<std::string>& packages) {
@@ -80,6 +84,46 @@ bool GHCI::HasError(const std::string& resp) {
     return resp.find("error:") != std::string::npos;
 }
 
+std::optional<lang::Type> GHCI::ParseType(const std::string& raw) {
+    // Constraints are dropped
+    auto pos = raw.find("=>");
+    auto maybe_type =
+        parsers::HsTypeParser(pos == std::string::npos ? raw : raw.substr(pos + 2)).Parse();
+    if (!maybe_type) {
+        return std::nullopt;
+    }
+    return maybe_type.value();
+}
+
+std::optional<lang::Type> GHCI::ParseTypeResponse(const std::string& resp) {
+    if (HasError(resp)) {
+        return std::nullopt;
+    }
+
+    // Operators like (>=>) can contain "=>" themselves, so it's only looked for in the type
+    auto pos = resp.find("::");
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+
+    return ParseType(resp.substr(pos + 2));
+}
+
+std::optional<lang::TypeConstructor> GHCI::ParseTypeConstructorResponse(const std::string& name,
+                                                                        const std::string& resp) {
+    if (HasError(resp)) {
+        return std::nullopt;
+    }
+
+    auto pos = resp.find("::");
+
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+
+    return ParseTypeConstructor(name, resp.substr(pos + 2));
+}
+
 std::optional<lang::TypeConstructor> GHCI::ParseTypeConstructor(const std::string& name,
                                                                 const std::string& raw) {
     bool expect_arrow = false;
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <vector>
+#include <span>
 #include <string>
 #include <optional>
+#include <stop_token>
 
 #include <komaru/lang/type.hpp>
 #include <komaru/translate/haskell/hs_import.hpp>
@@ -18,19 +20,31 @@ class GHCI : public util::CLIProgramManipulator {
     struct PrivateDummy {};
 
 public:
-    GHCI(PrivateDummy, const std::vector<std::string>& packages);
+    GHCI(PrivateDummy, const std::vector<std::string>& packages, std::stop_token stop);
 
+    // Throws if GHCi doesn't start or `stop` is requested meanwhile, the session is killed then
     static std::optional<GHCIPtr> CreateSession(const std::vector<std::string>& packages,
-                                                const std::vector<HaskellImport>& imports);
+                                                const std::vector<HaskellImport>& imports,
+                                                std::stop_token stop = {});
 
     std::optional<lang::Type> GetType(const std::string& name);
     std::optional<lang::TypeConstructor> GetTypeConstructor(const std::string& name);
+    // Same as asking for each name in turn, but queries are pipelined instead of waiting
+    // for every response before sending the next query
+    std::vector<std::optional<lang::Type>> GetTypes(std::span<const std::string> names);
+    std::vector<std::optional<lang::TypeConstructor>> GetTypeConstructors(
+        std::span<const std::string> names);
     static bool HasError(const std::string& resp);
+    // Parse what GHCi prints after "::" for a function's type and a type constructor's kind
+    static std::optional<lang::Type> ParseType(const std::string& raw);
+    static std::optional<lang::TypeConstructor> ParseTypeConstructor(const std::string& name,
+                                                                     const std::string& raw);
 
 private:
     std::vector<std::string> MakeStartCommand(const std::vector<std::string>& packages);
-    std::optional<lang::TypeConstructor> ParseTypeConstructor(const std::string& name,
-                                                              const std::string& raw);
+    static std::optional<lang::Type> ParseTypeResponse(const std::string& resp);
+    static std::optional<lang::TypeConstructor> ParseTypeConstructorResponse(
+        const std::string& name, const std::string& resp);
 };
 
 }  // namespace komaru::translate::hs
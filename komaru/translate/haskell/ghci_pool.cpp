@@ -0,0 +1,238 @@
+#include "ghci_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace komaru::translate::hs {
+
+GHCIPool::Lease& GHCIPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        Return();
+        pool_ = other.pool_;
+        key_ = std::move(other.key_);
+        ghci_ = std::move(other.ghci_);
+    }
+    return *this;
+}
+
+GHCIPool::Lease::~Lease() {
+    Return();
+}
+
+GHCI& GHCIPool::Lease::operator*() const {
+    return *ghci_;
+}
+
+GHCI* GHCIPool::Lease::operator->() const {
+    return ghci_.get();
+}
+
+GHCIPool::Lease::Lease(GHCIPool& pool, std::string key, GHCIPtr ghci)
+    : pool_(&pool),
+      key_(std::move(key)),
+      ghci_(std::move(ghci)) {
+}
+
+void GHCIPool::Lease::Return() {
+    if (ghci_) {
+        pool_->Release(key_, std::move(ghci_));
+    }
+}
+
+GHCIPool::GHCIPool(size_t standby_num, size_t max_idle_num,
+                   std::chrono::milliseconds health_check_period, size_t max_total_idle_num,
+                   std::chrono::milliseconds config_ttl)
+    : standby_num_(standby_num),
+      max_idle_num_(std::max(standby_num, max_idle_num)),
+      health_check_period_(health_check_period),
+      max_total_idle_num_(max_total_idle_num),
+      config_ttl_(config_ttl),
+      maintainer_([this](std::stop_token stop) {
+          MaintainerLoop(stop);
+      }) {
+}
+
+GHCIPool::~GHCIPool() {
+    // Sessions are only destroyed after the maintainer can't start new ones
+    maintainer_.request_stop();
+    maintainer_.join();
+}
+
+GHCIPool& GHCIPool::Global() {
+    static GHCIPool pool;
+    return pool;
+}
+
+std::optional<GHCIPool::Lease> GHCIPool::Acquire(const std::vector<std::string>& packages,
+                                                 const std::vector<HaskellImport>& imports) {
+    std::string key = MakeKey(packages, imports);
+    std::vector<GHCIPtr> dead;
+
+    {
+        std::lock_guard lock(mutex_);
+
+        auto [it, inserted] = configs_.try_emplace(key);
+        auto& config = it->second;
+        if (inserted) {
+            config.packages = packages;
+            config.imports = imports;
+        }
+        config.is_broken = false;
+        config.last_used = std::chrono::steady_clock::now();
+        ++config.leased_num;
+
+        while (!config.idle.empty()) {
+            GHCIPtr ghci = std::move(config.idle.back());
+            config.idle.pop_back();
+
+            if (ghci->IsAlive()) {
+                // Taking a standby makes the maintainer start another one
+                changed_.notify_all();
+                return Lease(*this, std::move(key), std::move(ghci));
+            }
+            dead.push_back(std::move(ghci));
+        }
+    }
+
+    changed_.notify_all();
+
+    auto maybe_ghci = GHCI::CreateSession(packages, imports);
+    if (!maybe_ghci) {
+        std::lock_guard lock(mutex_);
+        auto& config = configs_.at(key);
+        config.is_broken = true;
+        --config.leased_num;
+        return std::nullopt;
+    }
+
+    return Lease(*this, std::move(key), std::move(maybe_ghci.value()));
+}
+
+size_t GHCIPool::GetIdleNum(const std::vector<std::string>& packages,
+                            const std::vector<HaskellImport>& imports) const {
+    std::lock_guard lock(mutex_);
+
+    auto it = configs_.find(MakeKey(packages, imports));
+    return it == configs_.end() ? 0 : it->second.idle.size();
+}
+
+std::string GHCIPool::MakeKey(const std::vector<std::string>& packages,
+                              const std::vector<HaskellImport>& imports) {
+    std::string key;
+    for (const auto& package : packages) {
+        key += package + " ";
+    }
+    for (const auto& import : imports) {
+        key += "\n" + import.ToString();
+    }
+    return key;
+}
+
+void GHCIPool::Release(const std::string& key, GHCIPtr ghci) {
+    {
+        std::lock_guard lock(mutex_);
+
+        auto& config = configs_.at(key);
+        --config.leased_num;
+        config.last_used = std::chrono::steady_clock::now();
+        if (config.idle.size() < max_idle_num_ && GetTotalIdleNum() < max_total_idle_num_ &&
+            ghci->IsAlive()) {
+            config.idle.push_back(std::move(ghci));
+            return;
+        }
+    }
+
+    // A dead session may have left its configuration short of standbys
+    changed_.notify_all();
+}
+
+size_t GHCIPool::GetTotalIdleNum() const {
+    size_t idle_num = 0;
+    for (const auto& [_, config] : configs_) {
+        idle_num += config.idle.size();
+    }
+    return idle_num;
+}
+
+GHCIPool::Config* GHCIPool::FindConfigShortOfStandbys() {
+    size_t starting_num = 0;
+    for (const auto& [_, config] : configs_) {
+        starting_num += config.starting_num;
+    }
+    if (GetTotalIdleNum() + starting_num >= max_total_idle_num_) {
+        return nullptr;
+    }
+
+    for (auto& [_, config] : configs_) {
+        if (!config.is_broken && config.idle.size() + config.starting_num < standby_num_) {
+            return &config;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<GHCIPtr> GHCIPool::CollectGarbage() {
+    std::vector<GHCIPtr> garbage;
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto it = configs_.begin(); it != configs_.end();) {
+        auto& config = it->second;
+        bool is_expired = config.leased_num == 0 && config.starting_num == 0 &&
+                          now - config.last_used >= config_ttl_;
+
+        for (auto& ghci : config.idle) {
+            if (is_expired || !ghci->IsAlive()) {
+                garbage.push_back(std::move(ghci));
+            }
+        }
+        std::erase(config.idle, nullptr);
+
+        it = is_expired ? configs_.erase(it) : std::next(it);
+    }
+
+    return garbage;
+}
+
+void GHCIPool::MaintainerLoop(std::stop_token stop) {
+    std::unique_lock lock(mutex_);
+
+    while (!stop.stop_requested()) {
+        // Destroying a session kills GHCi and waits for it, which mustn't block the pool
+        if (auto garbage = CollectGarbage(); !garbage.empty()) {
+            lock.unlock();
+            garbage.clear();
+            lock.lock();
+        }
+
+        if (Config* config = FindConfigShortOfStandbys()) {
+            ++config->starting_num;
+            auto packages = config->packages;
+            auto imports = config->imports;
+
+            // A config isn't dropped while it starts a session, so the pointer stays valid.
+            // Stopping kills a GHCi that is still starting, so the pool's destruction doesn't
+            // wait for it.
+            lock.unlock();
+            std::optional<GHCIPtr> maybe_ghci;
+            try {
+                maybe_ghci = GHCI::CreateSession(packages, imports, stop);
+            } catch (std::exception&) {
+            }
+            lock.lock();
+
+            --config->starting_num;
+            if (maybe_ghci) {
+                config->idle.push_back(std::move(maybe_ghci.value()));
+            } else {
+                config->is_broken = true;
+            }
+            continue;
+        }
+
+        changed_.wait_for(lock, stop, health_check_period_, [this]() {
+            return FindConfigShortOfStandbys() != nullptr;
+        });
+    }
+}
+
+}  // namespace komaru::translate::hs
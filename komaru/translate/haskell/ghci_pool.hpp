@@ -0,0 +1,104 @@
+#pragma once
+
+#include <komaru/translate/haskell/ghci.hpp>
+#include <komaru/util/non_copyable.hpp>
+#include <komaru/util/non_copyable_non_movable.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace komaru::translate::hs {
+
+// Started GHCi sessions kept by packages and imports, so that a configuration seen before gets
+// a session without starting GHCi again. A session is leased for exclusive use and returns to
+// the pool when the lease ends. A background thread keeps a few standby sessions of every
+// configuration warm, replaces the ones that die and forgets configurations that haven't been
+// leased for a while. Must outlive its leases.
+class GHCIPool : public util::NonCopyableNonMovable {
+public:
+    class Lease : public util::NonCopyable {
+        friend class GHCIPool;
+
+    public:
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        GHCI& operator*() const;
+        GHCI* operator->() const;
+
+    private:
+        Lease(GHCIPool& pool, std::string key, GHCIPtr ghci);
+
+        void Return();
+
+    private:
+        GHCIPool* pool_;
+        std::string key_;
+        GHCIPtr ghci_;
+    };
+
+public:
+    // Keeps at least `standby_num` and at most `max_idle_num` idle sessions of a configuration
+    // and at most `max_total_idle_num` idle sessions overall. A configuration without leases
+    // for `config_ttl` is dropped along with its sessions.
+    explicit GHCIPool(size_t standby_num = 1, size_t max_idle_num = 4,
+                      std::chrono::milliseconds health_check_period = std::chrono::seconds(1),
+                      size_t max_total_idle_num = 16,
+                      std::chrono::milliseconds config_ttl = std::chrono::minutes(10));
+    ~GHCIPool();
+
+    // Shared by the whole process
+    static GHCIPool& Global();
+
+    // Takes an idle live session or starts a new one if there is none. Returns nullopt if
+    // GHCi fails to start, e.g. because of a bad import.
+    std::optional<Lease> Acquire(const std::vector<std::string>& packages,
+                                 const std::vector<HaskellImport>& imports);
+
+    size_t GetIdleNum(const std::vector<std::string>& packages,
+                      const std::vector<HaskellImport>& imports) const;
+
+private:
+    struct Config {
+        std::vector<std::string> packages;
+        std::vector<HaskellImport> imports;
+        std::vector<GHCIPtr> idle;
+        size_t starting_num{0};
+        // Leases out and acquires in progress, the config isn't dropped while there are any
+        size_t leased_num{0};
+        std::chrono::steady_clock::time_point last_used;
+        // GHCi failed to start with it, standbys aren't started until it's acquired again
+        bool is_broken{false};
+    };
+
+    static std::string MakeKey(const std::vector<std::string>& packages,
+                               const std::vector<HaskellImport>& imports);
+
+    void Release(const std::string& key, GHCIPtr ghci);
+    size_t GetTotalIdleNum() const;
+    Config* FindConfigShortOfStandbys();
+    // Moves dead sessions and the sessions of expired configs out of the pool
+    std::vector<GHCIPtr> CollectGarbage();
+    void MaintainerLoop(std::stop_token stop);
+
+private:
+    size_t standby_num_;
+    size_t max_idle_num_;
+    std::chrono::milliseconds health_check_period_;
+    size_t max_total_idle_num_;
+    std::chrono::milliseconds config_ttl_;
+    mutable std::mutex mutex_;
+    std::condition_variable_any changed_;
+    std::unordered_map<std::string, Config> configs_;
+    std::jthread maintainer_;
+};
+
+}  // namespace komaru::translate::hs
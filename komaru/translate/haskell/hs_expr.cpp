@@ -53,7 +53,7 @@ const std::vector<std::string>& HaskellExpr::GetNames() const {
 std::vector<lang::Type> HaskellExpr::GetTypes() const {
     return type_.Visit(util::Overloaded{
         [](const lang::TupleType& type) -> std::vector<lang::Type> {
-            return type.GetTupleTypes();
+            return {type.GetTupleTypes().begin(), type.GetTupleTypes().end()};
         },
         [this](const auto&) -> std::vector<lang::Type> {
             return {type_};
@@ -39,98 +39,19 @@ std::optional<TranslationError> HaskellFuncTranslationRequest::Init() {
 }
 
 std::optional<TranslationError> HaskellFuncTranslationRequest::DeduceNodeAndArrowTypes() {
-    std::unordered_map<const CPNode*, size_t> node2views;
-
-    std::queue<const CPNode*> q;
-    q.push(&root_);
-    node2deduced_type_[&root_] = root_.GetType();
-
-    while (!q.empty()) {
-        const CPNode* node = q.front();
-        q.pop();
-
-        for (const CPArrow* arrow : node->IncomingArrows()) {
-            const CPNode* src_node = &arrow->SourcePin().GetNode();
-            auto maybe_err = DeduceConnType(src_node, arrow, node);
-            if (maybe_err.has_value()) {
-                return maybe_err.value();
-            }
-        }
-
-        for (const CPOutPin& out_pin : node->OutPins()) {
-            for (const CPArrow& arrow : out_pin.Arrows()) {
-                const CPNode& dst_node = arrow.TargetNode();
-                size_t n_views = (node2views[&dst_node] += 1);
-
-                if (n_views == dst_node.IncomingArrows().size()) {
-                    q.push(&dst_node);
-                }
-            }
-        }
-
-        if (node->OutPins().empty()) {
-            ret_type_ = node2deduced_type_[node];
-        }
+    auto maybe_types = common::InferFunctionTypes(root_);
+    if (!maybe_types.has_value()) {
+        return maybe_types.error();
     }
 
-    func_type_ = lang::CurryFunction(root_.GetType(), ret_type_);
-    return std::nullopt;
-}
+    auto types = std::move(maybe_types.value());
 
-std::optional<TranslationError> HaskellFuncTranslationRequest::DeduceConnType(
-    const CPNode* src_node, const CPArrow* arrow, const CPNode* dst_node) {
-    lang::Type src_type = node2deduced_type_[src_node];
-    lang::Type arrow_type =
-        util::GetOr(arrow2deduced_type_, arrow, arrow->GetMorphism()->GetType());
-    lang::Type dst_type = util::GetOr(node2deduced_type_, dst_node, dst_node->GetType());
-
-    if (arrow->GetMorphism()->Holds<lang::PositionMorphism>()) {
-        // TODO: Deduce dst_type for position morphism
-        node2deduced_type_[dst_node] = dst_type;
-        arrow2deduced_type_[arrow] = arrow_type;
-        return std::nullopt;
-    }
-
-    std::map<size_t, lang::Type> arg_mapping;
-    std::vector<lang::Type> src_components = src_type.GetComponents();
-    for (size_t i = 0; i < src_components.size(); ++i) {
-        arg_mapping[i] = src_components[i];
-    }
-
-    auto maybe_deduced_dst_type = lang::TryMakeSubstitution(arrow_type, arg_mapping);
-    if (!maybe_deduced_dst_type.has_value()) {
-        return TranslationError(
-            std::format("failed to deduce destination type for arrow {}"
-                        "\narrow type: {}, type mapping: {}, morphism: {}",
-                        lang::CurryFunction(src_type, dst_type).ToString(), arrow_type.ToString(),
-                        lang::ArgMappingToString(arg_mapping), arrow->GetMorphism()->ToString()));
-    }
-
-    lang::Type deduced_dst_type = maybe_deduced_dst_type.value();
-
-    auto maybe_match_map = lang::TryMatchTypes(dst_type, deduced_dst_type);
-    if (!maybe_match_map.has_value()) {
-        return TranslationError(
-            std::format("failed to match types for arrow {} -> {}"
-                        "\ndestination type: {}, deduced destination type: {}, morphism {}",
-                        src_type.ToString(), dst_type.ToString(), dst_type.ToString(),
-                        deduced_dst_type.ToString(), arrow->GetMorphism()->ToString()));
-    }
-
-    deduced_dst_type = lang::ApplyMatchMap(dst_type, maybe_match_map.value());
-    node2deduced_type_[dst_node] = deduced_dst_type;
-
-    lang::Type conn_type = lang::CurryFunction(src_type, deduced_dst_type);
-
-    maybe_match_map = lang::TryMatchTypes(arrow_type, conn_type);
-    if (!maybe_match_map.has_value()) {
-        return TranslationError(std::format("failed to match types for arrow {} -> {}",
-                                            src_type.ToString(), dst_type.ToString()));
-    }
-
-    arrow_type = lang::ApplyMatchMap(arrow_type, maybe_match_map.value());
-    arrow2deduced_type_[arrow] = arrow_type;
+    node2deduced_type_ = std::move(types.node_types);
+    arrow2deduced_type_ = std::move(types.arrow_types);
+    ret_type_ = types.return_type;
 
+    // Variables of the declared type may have been renamed apart from others
+    func_type_ = lang::CurryFunction(node2deduced_type_.at(&root_), ret_type_);
     return std::nullopt;
 }
 
@@ -383,7 +304,7 @@ std::string HaskellFuncTranslationRequest::NewVarName() {
 }
 
 bool HaskellFuncTranslationRequest::HasNonTrivialBrancher(const CPNode* node) const {
-    auto& out_pins = node->OutPins();
+    auto out_pins = node->OutPins();
 
     if (out_pins.size() > 1) {
         return true;
@@ -458,26 +379,39 @@ TranslationResult<HaskellDefinition> HaskellFuncTranslationRequest::MakeHaskellD
 
     lang::Type dst_type = node2deduced_type_[&dst_node];
 
-    std::map<size_t, lang::MorphismPtr> mapping;
+    lang::BindingMap mapping;
 
     const CPNode* src_node = &arrow->SourcePin().GetNode();
     lang::Type src_type = node2deduced_type_[src_node];
-    std::vector<lang::Type> src_types(src_type.GetComponents());
+    std::span<const lang::Type> src_types = src_type.GetComponents();
 
     for (const auto [i, name] : util::Enumerate(node2unpack_[src_node])) {
         mapping[i] = lang::Morphism::CommonWithType(name, src_types[i]);
     }
 
-    auto full_morphism = std::invoke([&]() -> lang::MorphismPtr {
-        if (mapping.empty()) {
-            return arrow->GetMorphism();
-        }
-
-        return lang::Morphism::Binded(arrow->GetMorphism(), std::move(mapping));
-    });
+    // Bindings name this function's locals, so only the bare morphism's code is shared
+    std::string code;
+    if (mapping.empty()) {
+        code = MorphismToString(arrow->GetMorphism());
+    } else {
+        code = lang::Morphism::Binded(arrow->GetMorphism(), std::move(mapping))->ToString();
+    }
 
     return HaskellDefinition::Normal(local_name, {}, dst_type,
-                                     HaskellExpr::Simple(dst_type, full_morphism->ToString()));
+                                     HaskellExpr::Simple(dst_type, std::move(code)));
+}
+
+std::string HaskellFuncTranslationRequest::MorphismToString(const lang::MorphismPtr& morphism) {
+    auto maybe_id = morphisms_.FindID(*morphism);
+    if (!maybe_id) {
+        return morphism->ToString();
+    }
+
+    auto& str = morphism_strs_[*maybe_id];
+    if (!str) {
+        str = morphism->ToString();
+    }
+    return *str;
 }
 
 }  // namespace komaru::translate::hs
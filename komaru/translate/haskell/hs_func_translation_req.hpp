@@ -3,10 +3,15 @@
 #include <komaru/translate/translator.hpp>
 #include <komaru/translate/haskell/hs_definition.hpp>
 #include <komaru/translate/common/cond.hpp>
+#include <komaru/translate/common/type_inference.hpp>
 #include <komaru/translate/haskell/hs_expr_builder.hpp>
 
 namespace komaru::translate::hs {
 
+// Haskell code of a program's morphisms by their ids in CatProgram::GetMorphisms(), shared by
+// the requests of all its functions
+using MorphismStrings = std::vector<std::optional<std::string>>;
+
 class HaskellFuncTranslationRequest {
     using CPNode = lang::CatProgram::Node;
     using CPOutPin = lang::CatProgram::OutPin;
@@ -14,8 +19,12 @@ class HaskellFuncTranslationRequest {
     using CPBrancher = CPOutPin::Brancher;
 
 public:
-    explicit HaskellFuncTranslationRequest(const lang::CatProgram::Node& root)
-        : root_(root) {
+    HaskellFuncTranslationRequest(const lang::CatProgram::Node& root,
+                                  const lang::MorphismInterner& morphisms,
+                                  MorphismStrings& morphism_strs)
+        : root_(root),
+          morphisms_(morphisms),
+          morphism_strs_(morphism_strs) {
     }
 
     TranslationResult<HaskellDefinition> Translate() &&;
@@ -23,8 +32,6 @@ public:
 private:
     std::optional<TranslationError> Init();
     std::optional<TranslationError> DeduceNodeAndArrowTypes();
-    std::optional<TranslationError> DeduceConnType(const CPNode* src_node, const CPArrow* arrow,
-                                                   const CPNode* dst_node);
     void CalcParamNames();
     TranslationResult<HaskellExpr> TranslateExpr();
 
@@ -50,9 +57,12 @@ private:
         const CPNode* node, const std::string& local_name);
     TranslationResult<HaskellDefinition> MakeHaskellDefinitionForArrow(
         const CPArrow* arrow, const std::string& local_name);
+    std::string MorphismToString(const lang::MorphismPtr& morphism);
 
 private:
     const lang::CatProgram::Node& root_;
+    const lang::MorphismInterner& morphisms_;
+    MorphismStrings& morphism_strs_;
     lang::Type func_type_;
     lang::Type ret_type_;
     HaskellExprBuilder expr_builder_;
@@ -12,6 +12,8 @@ struct HaskellImport {
     std::vector<std::string> symbols;
 
     std::string ToString() const;
+
+    bool operator==(const HaskellImport&) const = default;
 };
 
 std::optional<HaskellImport> ParseHaskellImport(std::string s);
@@ -0,0 +1,422 @@
+#include "hs_interface_symbols.hpp"
+
+#include <komaru/util/filesystem.hpp>
+#include <komaru/util/string.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <format>
+#include <map>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+
+namespace komaru::translate::hs {
+
+namespace {
+
+constexpr std::string_view kHeader = "komaru-hs-interface 1";
+constexpr std::string_view kSignatureSep = " :: ";
+
+struct ModuleNames {
+    std::set<std::string> functions;
+    std::set<std::string> type_constructors;
+    // Constructors of a data type and methods of a class, which `T(..)` imports with T
+    std::map<std::string, std::set<std::string>> members;
+};
+
+std::vector<std::string> SplitLines(std::string_view s) {
+    std::vector<std::string> lines;
+    for (auto line : s | std::views::split('\n')) {
+        std::string_view view(line.begin(), line.end());
+        if (view.ends_with('\r')) {
+            view.remove_suffix(1);
+        }
+        lines.emplace_back(view);
+    }
+    return lines;
+}
+
+std::string FirstWord(const std::string& s) {
+    std::string stripped = util::Strip(s);
+    return stripped.substr(0, std::ranges::find_if(stripped, util::IsSpace) - stripped.begin());
+}
+
+// Drops a leading keyword and the words right after it that aren't names, e.g. "family"
+std::string DropKeywords(const std::string& s, std::initializer_list<std::string_view> keywords) {
+    std::string rest = util::Strip(s);
+    for (auto keyword : keywords) {
+        if (rest.starts_with(keyword) && rest.size() > keyword.size() &&
+            util::IsSpace(rest[keyword.size()])) {
+            rest = util::Strip(rest.substr(keyword.size()));
+        }
+    }
+    return rest;
+}
+
+bool IsOperator(const std::string& name) {
+    return name.size() > 2 && name.front() == '(' && name.back() == ')' &&
+           std::ranges::none_of(name, util::IsSpace);
+}
+
+bool IsName(const std::string& name) {
+    if (IsOperator(name)) {
+        return true;
+    }
+    if (name.empty() || !(std::isalpha(name[0]) || name[0] == '_')) {
+        return false;
+    }
+    return std::ranges::all_of(name, [](char c) {
+        return std::isalnum(c) || c == '_' || c == '\'' || c == '.';
+    });
+}
+
+bool IsTypeName(const std::string& name) {
+    return IsName(name) && std::isupper(name[0]);
+}
+
+// "(==), (/=) :: a -> a -> Bool" declares both operators
+void AddSignatureNames(const std::string& decl, std::set<std::string>& names) {
+    auto pos = decl.find("::");
+    if (pos == std::string::npos) {
+        return;
+    }
+
+    std::string lhs = DropKeywords(decl.substr(0, pos), {"pattern"});
+    for (auto part : lhs | std::views::split(',')) {
+        std::string name = util::Strip(std::string(part.begin(), part.end()));
+        if (IsName(name)) {
+            names.insert(std::move(name));
+        }
+    }
+}
+
+void AddDataDeclarationNames(const std::string& decl, ModuleNames& names) {
+    std::string rest = DropKeywords(decl, {"data", "newtype"});
+    if (rest.starts_with("family ") || rest.starts_with("instance ")) {
+        return;
+    }
+
+    auto eq_pos = rest.find(" = ");
+    std::string head = rest.substr(0, eq_pos);
+    if (auto ctx_pos = head.find("=>"); ctx_pos != std::string::npos) {
+        head = head.substr(ctx_pos + 2);
+    }
+
+    std::string type_name = FirstWord(head);
+    if (!IsTypeName(type_name)) {
+        return;
+    }
+    names.type_constructors.insert(type_name);
+
+    // GADT-style constructors aren't listed after "="
+    if (eq_pos == std::string::npos) {
+        return;
+    }
+
+    auto& members = names.members[type_name];
+
+    for (auto alternative : rest.substr(eq_pos + 3) | std::views::split('|')) {
+        std::string constructor(alternative.begin(), alternative.end());
+        std::string name = FirstWord(constructor);
+
+        if (!IsTypeName(name)) {
+            // Infix constructors like `a :| [a]`
+            std::string op = FirstWord(util::Strip(constructor).substr(name.size()));
+            if (!op.starts_with(':')) {
+                continue;
+            }
+            name = "(" + op + ")";
+        }
+
+        members.insert(name);
+        names.functions.insert(std::move(name));
+    }
+}
+
+void AddClassDeclarationNames(const std::vector<std::string>& decl, ModuleNames& names) {
+    std::string head = DropKeywords(decl.front(), {"class"});
+    if (auto ctx_pos = head.find("=>"); ctx_pos != std::string::npos) {
+        head = head.substr(ctx_pos + 2);
+    }
+
+    std::set<std::string> methods;
+    // Methods are the only lines of the body with "::" at their own indentation
+    for (const auto& line : decl | std::views::drop(1)) {
+        if (!util::Strip(line).starts_with("{-#")) {
+            AddSignatureNames(line, methods);
+        }
+    }
+
+    names.functions.insert(methods.begin(), methods.end());
+    if (std::string class_name = FirstWord(head); IsTypeName(class_name)) {
+        names.members[class_name].insert(methods.begin(), methods.end());
+    }
+}
+
+// Declarations in `:browse` output start at the line's beginning, the lines of the same
+// declaration after the first one are indented
+ModuleNames ParseBrowseResponse(const std::string& resp) {
+    std::vector<std::vector<std::string>> decls;
+
+    for (auto& line : SplitLines(resp)) {
+        if (util::Strip(line).empty()) {
+            continue;
+        }
+        if (util::IsSpace(line[0]) && !decls.empty()) {
+            decls.back().push_back(std::move(line));
+        } else {
+            decls.push_back({std::move(line)});
+        }
+    }
+
+    ModuleNames names;
+
+    for (const auto& decl : decls) {
+        const std::string& head = decl.front();
+
+        if (head.starts_with("class ")) {
+            AddClassDeclarationNames(decl, names);
+        } else if (head.starts_with("data ") || head.starts_with("newtype ")) {
+            std::string joined;
+            for (const auto& line : decl) {
+                joined += line + " ";
+            }
+            AddDataDeclarationNames(joined, names);
+        } else if (head.starts_with("type ")) {
+            std::string rest = DropKeywords(head, {"type", "family", "instance"});
+            if (std::string name = FirstWord(rest); IsTypeName(name)) {
+                names.type_constructors.insert(std::move(name));
+            }
+        } else {
+            AddSignatureNames(head, names.functions);
+        }
+    }
+
+    return names;
+}
+
+// "Maybe(..)" brings Maybe, Just and Nothing, "Maybe(Just)" only Maybe and Just
+bool IsImported(const HaskellImport& import, const std::string& name,
+                const ModuleNames& module_names) {
+    if (import.symbols.empty()) {
+        return true;
+    }
+    return std::ranges::any_of(import.symbols, [&](const std::string& symbol) {
+        auto pos = symbol.find('(', 1);
+        std::string owner = symbol.substr(0, pos);
+        if (symbol == name || owner == name) {
+            return true;
+        }
+        if (pos == std::string::npos || !symbol.ends_with(')')) {
+            return false;
+        }
+
+        std::string listed = util::Strip(symbol.substr(pos + 1, symbol.size() - pos - 2));
+        if (listed == "..") {
+            auto it = module_names.members.find(owner);
+            return it != module_names.members.end() && it->second.contains(name);
+        }
+        for (auto part : listed | std::views::split(',')) {
+            std::string member = util::Strip(std::string(part.begin(), part.end()));
+            if (member == name || "(" + member + ")" == name) {
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+std::string Qualify(const std::string& name, const std::string& ref_name) {
+    if (ref_name.empty()) {
+        return name;
+    }
+    if (IsOperator(name)) {
+        return std::format("({}.{})", ref_name, name.substr(1, name.size() - 2));
+    }
+    return std::format("{}.{}", ref_name, name);
+}
+
+// GHCi wraps long answers over several lines
+std::string CollapseSpaces(const std::string& s) {
+    std::string collapsed;
+    for (char c : util::Strip(s)) {
+        if (!util::IsSpace(c)) {
+            collapsed += c;
+        } else if (!collapsed.ends_with(' ')) {
+            collapsed += ' ';
+        }
+    }
+    return collapsed;
+}
+
+// Appends "<tag> <name> :: <signature>" lines for the answers Komaru can parse
+template <typename ParseFn>
+void DumpAnswers(GHCI& ghci, char tag, std::string_view command,
+                 const std::set<std::string>& names, ParseFn parse, std::string& out) {
+    std::vector<std::string> queries;
+    queries.reserve(names.size());
+    for (const auto& name : names) {
+        queries.push_back(std::format("{} {}\n", command, name));
+    }
+
+    auto responses = ghci.InteractMany(queries);
+
+    for (const auto& [name, resp] : std::views::zip(names, responses)) {
+        auto pos = resp.find("::");
+        if (GHCI::HasError(resp) || pos == std::string::npos) {
+            continue;
+        }
+
+        std::string signature = CollapseSpaces(resp.substr(pos + 2));
+        if (parse(name, signature)) {
+            out += std::format("{} {}{}{}\n", tag, name, kSignatureSep, signature);
+        }
+    }
+}
+
+void LoadLine(const std::string& line, std::unordered_map<std::string, lang::Type>& functions,
+              std::unordered_map<std::string, size_t>& type_constructors) {
+    auto pos = line.find(kSignatureSep);
+    if (line.size() < 2 || line[1] != ' ' || pos == std::string::npos) {
+        throw std::runtime_error(std::format("bad interface line: \"{}\"", line));
+    }
+
+    std::string name = line.substr(2, pos - 2);
+    std::string signature = line.substr(pos + kSignatureSep.size());
+
+    switch (line[0]) {
+        case 'f': {
+            auto maybe_type = GHCI::ParseType(signature);
+            if (!maybe_type) {
+                throw std::runtime_error(std::format("bad type of {}", name));
+            }
+            functions.insert_or_assign(std::move(name), *maybe_type);
+            break;
+        }
+        case 't': {
+            auto maybe_constructor = GHCI::ParseTypeConstructor(name, signature);
+            if (!maybe_constructor) {
+                throw std::runtime_error(std::format("bad kind of {}", name));
+            }
+            type_constructors.insert_or_assign(std::move(name),
+                                               maybe_constructor->GetNumParams());
+            break;
+        }
+        default:
+            throw std::runtime_error(std::format("unknown symbol tag '{}'", line[0]));
+    }
+}
+
+}  // namespace
+
+std::optional<HaskellInterfaceSymbols> HaskellInterfaceSymbols::Load(
+    const std::filesystem::path& path) {
+    auto maybe_file = util::MappedFile::Open(path);
+    if (!maybe_file) {
+        return std::nullopt;
+    }
+
+    HaskellInterfaceSymbols symbols;
+    bool has_header = false;
+
+    try {
+        for (const auto& line : SplitLines(maybe_file->View())) {
+            if (line.empty() || line.starts_with("--")) {
+                continue;
+            }
+            if (!has_header) {
+                if (line != kHeader) {
+                    throw std::runtime_error("interface of another version");
+                }
+                has_header = true;
+                continue;
+            }
+            LoadLine(line, symbols.functions_, symbols.type_constructors_);
+        }
+    } catch (std::exception&) {
+        return std::nullopt;
+    }
+
+    if (!has_header) {
+        return std::nullopt;
+    }
+
+    return symbols;
+}
+
+std::optional<lang::Type> HaskellInterfaceSymbols::FindFunction(const std::string& name) const {
+    auto it = functions_.find(name);
+    if (it == functions_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<lang::TypeConstructor> HaskellInterfaceSymbols::FindTypeConstructor(
+    const std::string& name) const {
+    auto it = type_constructors_.find(name);
+    if (it == type_constructors_.end()) {
+        return std::nullopt;
+    }
+    return lang::TypeConstructor(name, it->second);
+}
+
+std::optional<SymbolInfo> HaskellInterfaceSymbols::FindSymbol(const std::string& name) const {
+    if (auto maybe_type = FindFunction(name)) {
+        return *maybe_type;
+    }
+    if (auto maybe_constructor = FindTypeConstructor(name)) {
+        return *maybe_constructor;
+    }
+    return std::nullopt;
+}
+
+std::error_code DumpHaskellInterface(GHCI& ghci, const std::vector<HaskellImport>& imports,
+                                     const std::filesystem::path& path) {
+    std::vector<HaskellImport> modules = imports;
+    if (std::ranges::none_of(imports, [](const HaskellImport& import) {
+            return import.module_name == "Prelude";
+        })) {
+        // GHCi imports it implicitly
+        modules.insert(modules.begin(), HaskellImport{.module_name = "Prelude"});
+    }
+
+    ModuleNames names;
+
+    for (const auto& module : modules) {
+        auto module_names = ParseBrowseResponse(ghci.Interact(":browse " + module.module_name +
+                                                              "\n"));
+
+        for (const auto& name : module_names.functions) {
+            if (IsImported(module, name, module_names)) {
+                names.functions.insert(Qualify(name, module.ref_name));
+            }
+        }
+        for (const auto& name : module_names.type_constructors) {
+            if (IsImported(module, name, module_names)) {
+                names.type_constructors.insert(Qualify(name, module.ref_name));
+            }
+        }
+    }
+
+    std::string out = std::string(kHeader) + "\n";
+    for (const auto& import : imports) {
+        out += "-- " + import.ToString() + "\n";
+    }
+
+    DumpAnswers(ghci, 'f', ":t", names.functions,
+                [](const std::string&, const std::string& signature) {
+                    return GHCI::ParseType(signature).has_value();
+                },
+                out);
+    DumpAnswers(ghci, 't', ":kind", names.type_constructors,
+                [](const std::string& name, const std::string& signature) {
+                    return GHCI::ParseTypeConstructor(name, signature).has_value();
+                },
+                out);
+
+    return util::WriteFile(path, out);
+}
+
+}  // namespace komaru::translate::hs
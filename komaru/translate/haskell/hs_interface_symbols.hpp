@@ -0,0 +1,53 @@
+#pragma once
+
+#include <komaru/translate/symbols_registry_like.hpp>
+#include <komaru/translate/haskell/ghci.hpp>
+#include <komaru/translate/haskell/hs_import.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace komaru::translate::hs {
+
+// Library symbols answered from an interface file instead of GHCi, for reproducible builds and
+// for machines without GHC. Symbols the file doesn't have are unknown.
+//
+// The file is text made by DumpHaskellInterface, one symbol per line with what GHCi answered
+// about it:
+//
+//     komaru-hs-interface 1
+//     f zip :: [a] -> [b] -> [(a, b)]
+//     t Either :: * -> * -> *
+//
+// Lines starting with "--" are comments.
+class HaskellInterfaceSymbols {
+public:
+    // Returns nullopt for missing and broken files
+    static std::optional<HaskellInterfaceSymbols> Load(const std::filesystem::path& path);
+
+    std::optional<lang::Type> FindFunction(const std::string& name) const;
+    std::optional<lang::TypeConstructor> FindTypeConstructor(const std::string& name) const;
+    // Functions shadow type constructors of the same name
+    std::optional<SymbolInfo> FindSymbol(const std::string& name) const;
+
+private:
+    HaskellInterfaceSymbols() = default;
+
+private:
+    std::unordered_map<std::string, lang::Type> functions_;
+    std::unordered_map<std::string, size_t> type_constructors_;  // params num
+};
+
+static_assert(SymbolsRegistryLike<HaskellInterfaceSymbols>);
+
+// Asks `ghci` about everything Prelude and `imports` export and writes the answers to `path`.
+// Names are the ones a program would use, e.g. "M.lookup" for `import qualified Data.Map as M`.
+// Symbols whose types Komaru can't express are left out.
+std::error_code DumpHaskellInterface(GHCI& ghci, const std::vector<HaskellImport>& imports,
+                                     const std::filesystem::path& path);
+
+}  // namespace komaru::translate::hs
@@ -0,0 +1,323 @@
+#include "hs_symbols_cache.hpp"
+
+#include <komaru/util/cli.hpp>
+#include <komaru/util/filesystem.hpp>
+#include <komaru/util/std_extensions.hpp>
+#include <komaru/util/string.hpp>
+
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+namespace komaru::translate::hs {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x43534D4B;  // "KMSC"
+// Must be bumped whenever the layout changes
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+enum class TypeKind : uint32_t {
+    Common,
+    Tuple,
+    Function,
+    List,
+};
+
+// Unlike std::hash it's the same in every build, the hash ends up in file names
+uint64_t StableHash(std::string_view s) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : s) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Names and types get indices in the order they are first met, children before parents
+class CacheWriter {
+public:
+    uint32_t AddString(const std::string& s) {
+        auto [it, inserted] = string_idxs_.emplace(s, string_idxs_.size());
+        if (inserted) {
+            PutU32(strings_, static_cast<uint32_t>(s.size()));
+            strings_.append(s);
+        }
+        return it->second;
+    }
+
+    uint32_t AddType(lang::Type type) {
+        auto it = type_idxs_.find(type);
+        if (it != type_idxs_.end()) {
+            return it->second;
+        }
+
+        // Children are written first, so the type's own record can't be started before
+        std::vector<uint32_t> record = type.Visit(util::Overloaded{
+            [&](const lang::CommonType& common) {
+                std::vector<uint32_t> record = {static_cast<uint32_t>(TypeKind::Common),
+                                                AddString(common.GetName()),
+                                                static_cast<uint32_t>(common.NumTypeParams())};
+                for (lang::Type param : common.GetTypeParams()) {
+                    record.push_back(AddType(param));
+                }
+                return record;
+            },
+            [&](const lang::TupleType& tuple) {
+                std::vector<uint32_t> record = {static_cast<uint32_t>(TypeKind::Tuple),
+                                                static_cast<uint32_t>(tuple.GetTypesNum())};
+                for (lang::Type inner : tuple.GetTupleTypes()) {
+                    record.push_back(AddType(inner));
+                }
+                return record;
+            },
+            [&](const lang::FunctionType& function) {
+                return std::vector<uint32_t>{static_cast<uint32_t>(TypeKind::Function),
+                                             AddType(function.Source()),
+                                             AddType(function.Target())};
+            },
+            [&](const lang::ListType& list) {
+                return std::vector<uint32_t>{static_cast<uint32_t>(TypeKind::List),
+                                             AddType(list.Inner())};
+            },
+        });
+
+        for (uint32_t value : record) {
+            PutU32(types_, value);
+        }
+
+        auto idx = static_cast<uint32_t>(type_idxs_.size());
+        type_idxs_.emplace(type, idx);
+        return idx;
+    }
+
+    std::string Finish(const std::string& key, const std::string& symbols) {
+        std::string out;
+        PutU32(out, kMagic);
+        PutU32(out, kFormatVersion);
+        PutU32(out, static_cast<uint32_t>(key.size()));
+        out.append(key);
+        PutU32(out, static_cast<uint32_t>(string_idxs_.size()));
+        out.append(strings_);
+        PutU32(out, static_cast<uint32_t>(type_idxs_.size()));
+        out.append(types_);
+        out.append(symbols);
+        return out;
+    }
+
+    static void PutU32(std::string& out, uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> string_idxs_;
+    std::unordered_map<lang::Type, uint32_t> type_idxs_;
+    std::string strings_;
+    std::string types_;
+};
+
+// Throws on truncated or inconsistent data
+class CacheReader {
+public:
+    explicit CacheReader(std::string_view data)
+        : data_(data) {
+    }
+
+    uint32_t GetU32() {
+        uint32_t value = 0;
+        std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    std::string_view GetString() {
+        return Take(GetU32());
+    }
+
+    uint32_t GetIndex(size_t size) {
+        uint32_t idx = GetU32();
+        if (idx >= size) {
+            throw std::runtime_error("index out of range");
+        }
+        return idx;
+    }
+
+    bool IsEnd() const {
+        return pos_ == data_.size();
+    }
+
+private:
+    std::string_view Take(size_t n) {
+        if (n > data_.size() - pos_) {
+            throw std::runtime_error("unexpected end of cache");
+        }
+        auto taken = data_.substr(pos_, n);
+        pos_ += n;
+        return taken;
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_{0};
+};
+
+HaskellLibSymbols ReadSymbols(CacheReader& reader, const std::string& key) {
+    if (reader.GetU32() != kMagic || reader.GetU32() != kFormatVersion ||
+        reader.GetString() != key) {
+        throw std::runtime_error("cache of another version or key");
+    }
+
+    std::vector<std::string_view> strings(reader.GetU32());
+    for (auto& s : strings) {
+        s = reader.GetString();
+    }
+
+    std::vector<lang::Type> types(reader.GetU32());
+    std::vector<lang::Type> children;
+
+    for (auto [i, type] : util::Enumerate(types)) {
+        // Only types before this one can be referred to
+        auto get_type = [&]() {
+            return types[reader.GetIndex(i)];
+        };
+
+        children.clear();
+
+        switch (static_cast<TypeKind>(reader.GetU32())) {
+            case TypeKind::Common: {
+                std::string_view name = strings[reader.GetIndex(strings.size())];
+                if (name.empty()) {
+                    throw std::runtime_error("type without a name");
+                }
+                for (uint32_t n = reader.GetU32(); n > 0; --n) {
+                    children.push_back(get_type());
+                }
+                type = lang::Type::Parameterized(lang::Symbol(name), children);
+                break;
+            }
+            case TypeKind::Tuple:
+                for (uint32_t n = reader.GetU32(); n > 0; --n) {
+                    children.push_back(get_type());
+                }
+                type = lang::Type::Tuple(children);
+                break;
+            case TypeKind::Function: {
+                lang::Type source = get_type();
+                type = lang::Type::Function(source, get_type());
+                break;
+            }
+            case TypeKind::List:
+                type = lang::Type::List(get_type());
+                break;
+            default:
+                throw std::runtime_error("unknown type kind");
+        }
+    }
+
+    HaskellLibSymbols symbols;
+
+    for (uint32_t n = reader.GetU32(); n > 0; --n) {
+        std::string name(strings[reader.GetIndex(strings.size())]);
+        uint32_t type_idx = reader.GetU32();
+        symbols.functions.emplace(std::move(name), type_idx == kNone
+                                                       ? std::nullopt
+                                                       : std::optional(types.at(type_idx)));
+    }
+
+    for (uint32_t n = reader.GetU32(); n > 0; --n) {
+        std::string name(strings[reader.GetIndex(strings.size())]);
+        uint32_t params_num = reader.GetU32();
+        symbols.type_constructors.emplace(std::move(name),
+                                          params_num == kNone ? std::nullopt
+                                                              : std::optional<size_t>(params_num));
+    }
+
+    if (!reader.IsEnd()) {
+        throw std::runtime_error("trailing data in cache");
+    }
+
+    return symbols;
+}
+
+}  // namespace
+
+std::optional<std::string> MakeSymbolsCacheKey(const std::vector<std::string>& packages,
+                                               const std::vector<HaskellImport>& imports) {
+    auto version = util::PerformCLICommand(std::vector<std::string>{"ghc", "--numeric-version"});
+    if (version.Fail()) {
+        return std::nullopt;
+    }
+
+    std::string key = std::format("ghc {}\npackages", util::Strip(version.Stdout()));
+    for (const auto& package : packages) {
+        key += " " + package;
+    }
+    for (const auto& import : imports) {
+        key += "\n" + import.ToString();
+    }
+
+    return key;
+}
+
+std::filesystem::path GetSymbolsCachePath(const std::filesystem::path& cache_dir,
+                                          const std::string& key) {
+    return cache_dir / std::format("symbols-{:016x}.bin", StableHash(key));
+}
+
+std::optional<HaskellLibSymbols> LoadSymbolsCache(const std::filesystem::path& path,
+                                                  const std::string& key) {
+    auto maybe_file = util::MappedFile::Open(path);
+    if (!maybe_file) {
+        return std::nullopt;
+    }
+
+    try {
+        CacheReader reader(maybe_file->View());
+        return ReadSymbols(reader, key);
+    } catch (std::exception&) {
+        return std::nullopt;
+    }
+}
+
+std::error_code SaveSymbolsCache(const std::filesystem::path& path, const std::string& key,
+                                 const HaskellLibSymbols& symbols) {
+    CacheWriter writer;
+    std::string section;
+
+    CacheWriter::PutU32(section, static_cast<uint32_t>(symbols.functions.size()));
+    for (const auto& [name, maybe_type] : symbols.functions) {
+        CacheWriter::PutU32(section, writer.AddString(name));
+        CacheWriter::PutU32(section, maybe_type ? writer.AddType(*maybe_type) : kNone);
+    }
+
+    CacheWriter::PutU32(section, static_cast<uint32_t>(symbols.type_constructors.size()));
+    for (const auto& [name, maybe_params_num] : symbols.type_constructors) {
+        CacheWriter::PutU32(section, writer.AddString(name));
+        CacheWriter::PutU32(section, maybe_params_num
+                                         ? static_cast<uint32_t>(*maybe_params_num)
+                                         : kNone);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (error) {
+        return error;
+    }
+
+    auto tmp_path = path;
+    tmp_path += "." + util::GenTmpFilepath().filename().string();
+
+    std::error_code ignored;
+
+    error = util::WriteFile(tmp_path, writer.Finish(key, section));
+    if (!error) {
+        std::filesystem::rename(tmp_path, path, error);
+    }
+    if (error) {
+        std::filesystem::remove(tmp_path, ignored);
+    }
+
+    return error;
+}
+
+}  // namespace komaru::translate::hs
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <komaru/lang/type.hpp>
+#include <komaru/translate/haskell/hs_import.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace komaru::translate::hs {
+
+// What GHCi answered about library symbols, nullopt for symbols it doesn't know
+struct HaskellLibSymbols {
+    std::unordered_map<std::string, std::optional<lang::Type>> functions;
+    std::unordered_map<std::string, std::optional<size_t>> type_constructors;  // params num
+};
+
+// Library symbols only depend on the GHC version, packages and imports. Returns nullopt
+// if GHC's version can't be found out.
+std::optional<std::string> MakeSymbolsCacheKey(const std::vector<std::string>& packages,
+                                               const std::vector<HaskellImport>& imports);
+// File of the key's cache inside `cache_dir`
+std::filesystem::path GetSymbolsCachePath(const std::filesystem::path& cache_dir,
+                                          const std::string& key);
+
+// Cache files are binary: a header with the format version and the whole key, a string table,
+// a table of types where each type refers to names and types before it, then the symbols.
+// Returns nullopt for missing, outdated or broken files and for files of another key.
+std::optional<HaskellLibSymbols> LoadSymbolsCache(const std::filesystem::path& path,
+                                                  const std::string& key);
+// Replaces the file at once, so concurrent readers see either the old or the new cache
+std::error_code SaveSymbolsCache(const std::filesystem::path& path, const std::string& key,
+                                 const HaskellLibSymbols& symbols);
+
+}  // namespace komaru::translate::hs
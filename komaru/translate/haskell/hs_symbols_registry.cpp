@@ -1,13 +1,46 @@
 #include "hs_symbols_registry.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+#include <format>
 #include <print>
+#include <ranges>
 
 namespace komaru::translate::hs {
 
+namespace {
+
+// Symbols of Komaru itself, GHCi is never asked about them
+std::optional<lang::Type> FindBuiltinFunction(const std::string& name) {
+    if (name == "(!)") {
+        return lang::Type::FunctionChain(
+            {lang::Type::Var("a"), lang::Type::Var("b"), lang::Type::Var("b")});
+    }
+    return std::nullopt;
+}
+
+std::optional<lang::TypeConstructor> FindBuiltinTypeConstructor(const std::string& name) {
+    if (name == "S") {
+        return lang::TypeConstructor("S", 0);
+    } else if (name == "Str") {
+        return lang::TypeConstructor("Str", 0);
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
 HaskellSymbolsRegistry::HaskellSymbolsRegistry(std::vector<std::string> packages,
                                                std::vector<HaskellImport> imports)
     : packages_(std::move(packages)),
       imports_(std::move(imports)) {
+    if (const char* cache_dir = std::getenv("KOMARU_SYMBOLS_CACHE_DIR")) {
+        cache_dir_ = cache_dir;
+    }
+    if (const char* interface_file = std::getenv("KOMARU_HS_INTERFACE_FILE")) {
+        interface_file_ = interface_file;
+    }
+
     Reload();
 }
 
@@ -19,56 +52,119 @@ void HaskellSymbolsRegistry::SetImports(std::vector<HaskellImport> imports) {
     imports_ = std::move(imports);
 }
 
+void HaskellSymbolsRegistry::SetCacheDir(std::optional<std::filesystem::path> cache_dir) {
+    cache_dir_ = std::move(cache_dir);
+}
+
+void HaskellSymbolsRegistry::SetInterfaceFile(
+    std::optional<std::filesystem::path> interface_file) {
+    interface_file_ = std::move(interface_file);
+}
+
 void HaskellSymbolsRegistry::Reload() {
-    auto maybe_ghci = GHCI::CreateSession(packages_, imports_);
-    if (!maybe_ghci) {
-        throw std::runtime_error("failed to create ghci session");
+    // Forks made before keep the old symbols and session
+    lib_ = std::make_shared<LibSymbols>();
+    lib_->packages = packages_;
+    lib_->imports = imports_;
+
+    // Kept by the registry past the current type universe, as are the ones looked up later
+    lang::TypeUniverse::PermanentScope permanent;
+
+    if (interface_file_) {
+        lib_->interface = HaskellInterfaceSymbols::Load(*interface_file_);
+        if (!lib_->interface) {
+            throw std::runtime_error(std::format("failed to load haskell interface file \"{}\"",
+                                                 interface_file_->string()));
+        }
+    } else if (cache_dir_) {
+        if (auto maybe_key = MakeSymbolsCacheKey(packages_, imports_)) {
+            lib_->cache_path = GetSymbolsCachePath(*cache_dir_, *maybe_key);
+            lib_->cache_key = std::move(maybe_key.value());
+
+            if (auto maybe_symbols = LoadSymbolsCache(*lib_->cache_path, lib_->cache_key)) {
+                lib_->symbols = std::move(maybe_symbols.value());
+            }
+        }
     }
-    ghci_ = std::move(maybe_ghci.value());
-    lib_symbols_cache_.clear();
+
+    ++lib_generation_;
+}
+
+std::error_code HaskellSymbolsRegistry::SaveCache() const {
+    std::lock_guard lock(lib_->mutex);
+    return lib_->Save();
+}
+
+HaskellSymbolsRegistry HaskellSymbolsRegistry::Fork() const {
+    HaskellSymbolsRegistry fork;
+    fork.lib_ = lib_;
+    fork.packages_ = packages_;
+    fork.imports_ = imports_;
+    fork.cache_dir_ = cache_dir_;
+    fork.interface_file_ = interface_file_;
+    fork.global_symbols_ = global_symbols_;
+    fork.lib_generation_ = lib_generation_;
+    return fork;
 }
 
 void HaskellSymbolsRegistry::AddLocalFunction(const std::string& name, lang::Type type) {
-    local_symbols_.emplace(name, type);
+    if (local_symbols_.types.emplace(name, type).second) {
+        local_symbols_.pins.Add(type);
+    }
 }
 
 void HaskellSymbolsRegistry::AddGlobalFunction(const std::string& name, lang::Type type) {
-    global_symbols_.emplace(name, type);
+    Functions& functions = GetOwnGlobalFunctions();
+    if (functions.types.emplace(name, type).second) {
+        functions.pins.Add(type);
+    }
 }
 
 void HaskellSymbolsRegistry::ResetLocalFunctions() {
-    local_symbols_.clear();
+    local_symbols_ = {};
 }
 
 void HaskellSymbolsRegistry::ResetGlobalFunctions() {
-    global_symbols_.clear();
+    global_symbols_ = std::make_shared<Functions>();
 }
 
 std::optional<lang::Type> HaskellSymbolsRegistry::FindFunction(const std::string& name) const {
-    if (name == "(!)") {
-        return lang::Type::FunctionChain(
-            {lang::Type::Var("a"), lang::Type::Var("b"), lang::Type::Var("b")});
+    if (auto maybe_type = FindBuiltinFunction(name)) {
+        return maybe_type;
     }
 
-    auto it = local_symbols_.find(name);
-    if (it != local_symbols_.end()) {
-        return it->second;
+    if (auto maybe_type = FindProgramFunction(name)) {
+        return maybe_type;
     }
 
-    it = global_symbols_.find(name);
-    if (it != global_symbols_.end()) {
-        return it->second;
+    if (lib_->interface) {
+        return lib_->interface->FindFunction(name);
+    }
+
+    std::lock_guard lock(lib_->mutex);
+
+    auto& functions = lib_->symbols.functions;
+    auto lib_it = functions.find(name);
+
+    if (lib_it == functions.end()) {
+        lang::TypeUniverse::PermanentScope permanent;
+        lib_it = functions.emplace(name, lib_->GetGHCI().GetType(name)).first;
+        lib_->has_unsaved = true;
     }
 
-    it = lib_symbols_cache_.find(name);
-    if (it != lib_symbols_cache_.end()) {
+    return lib_it->second;
+}
+
+std::optional<lang::Type> HaskellSymbolsRegistry::FindProgramFunction(
+    const std::string& name) const {
+    auto it = local_symbols_.types.find(name);
+    if (it != local_symbols_.types.end()) {
         return it->second;
     }
 
-    auto maybe_type = ghci_->GetType(name);
-    if (maybe_type.has_value()) {
-        lib_symbols_cache_[name] = maybe_type.value();
-        return maybe_type.value();
+    it = global_symbols_->types.find(name);
+    if (it != global_symbols_->types.end()) {
+        return it->second;
     }
 
     return std::nullopt;
@@ -76,13 +172,134 @@ std::optional<lang::Type> HaskellSymbolsRegistry::FindFunction(const std::string
 
 std::optional<lang::TypeConstructor> HaskellSymbolsRegistry::FindTypeConstructor(
     const std::string& name) const {
-    if (name == "S") {
-        return lang::TypeConstructor("S", 0);
-    } else if (name == "Str") {
-        return lang::TypeConstructor("Str", 0);
+    if (auto maybe_constructor = FindBuiltinTypeConstructor(name)) {
+        return maybe_constructor;
+    }
+
+    if (lib_->interface) {
+        return lib_->interface->FindTypeConstructor(name);
+    }
+
+    std::lock_guard lock(lib_->mutex);
+
+    auto& type_constructors = lib_->symbols.type_constructors;
+    auto it = type_constructors.find(name);
+
+    if (it == type_constructors.end()) {
+        auto maybe_constructor = lib_->GetGHCI().GetTypeConstructor(name);
+        it = type_constructors
+                 .emplace(name, maybe_constructor.transform(&lang::TypeConstructor::GetNumParams))
+                 .first;
+        lib_->has_unsaved = true;
+    }
+
+    return it->second.transform([&](size_t num_params) {
+        return lang::TypeConstructor(name, num_params);
+    });
+}
+
+void HaskellSymbolsRegistry::PrefetchFunctions(std::span<const std::string> names) const {
+    if (lib_->interface) {
+        return;
+    }
+
+    std::lock_guard lock(lib_->mutex);
+
+    auto& functions = lib_->symbols.functions;
+    std::vector<std::string> unknown_names;
+
+    for (const auto& name : names) {
+        if (!FindBuiltinFunction(name) && !local_symbols_.types.contains(name) &&
+            !global_symbols_->types.contains(name) && !functions.contains(name)) {
+            unknown_names.push_back(name);
+        }
+    }
+
+    std::ranges::sort(unknown_names);
+    unknown_names.erase(std::ranges::unique(unknown_names).begin(), unknown_names.end());
+
+    if (unknown_names.empty()) {
+        return;
+    }
+
+    lang::TypeUniverse::PermanentScope permanent;
+    auto types = lib_->GetGHCI().GetTypes(unknown_names);
+    for (auto& [name, maybe_type] : std::views::zip(unknown_names, types)) {
+        functions.emplace(std::move(name), maybe_type);
+    }
+    lib_->has_unsaved = true;
+}
+
+void HaskellSymbolsRegistry::PrefetchTypeConstructors(std::span<const std::string> names) const {
+    if (lib_->interface) {
+        return;
+    }
+
+    std::lock_guard lock(lib_->mutex);
+
+    auto& type_constructors = lib_->symbols.type_constructors;
+    std::vector<std::string> unknown_names;
+
+    for (const auto& name : names) {
+        if (!FindBuiltinTypeConstructor(name) && !type_constructors.contains(name)) {
+            unknown_names.push_back(name);
+        }
+    }
+
+    std::ranges::sort(unknown_names);
+    unknown_names.erase(std::ranges::unique(unknown_names).begin(), unknown_names.end());
+
+    if (unknown_names.empty()) {
+        return;
+    }
+
+    auto maybe_constructors = lib_->GetGHCI().GetTypeConstructors(unknown_names);
+    for (auto& [name, maybe_constructor] : std::views::zip(unknown_names, maybe_constructors)) {
+        type_constructors.emplace(
+            std::move(name), maybe_constructor.transform(&lang::TypeConstructor::GetNumParams));
+    }
+    lib_->has_unsaved = true;
+}
+
+uint64_t HaskellSymbolsRegistry::GetLibGeneration() const {
+    return lib_generation_;
+}
+
+HaskellSymbolsRegistry::Functions& HaskellSymbolsRegistry::GetOwnGlobalFunctions() {
+    // Only this registry can share them, so a count of one can't grow meanwhile
+    if (global_symbols_.use_count() > 1) {
+        global_symbols_ = std::make_shared<Functions>(*global_symbols_);
+    }
+    return *global_symbols_;
+}
+
+HaskellSymbolsRegistry::LibSymbols::~LibSymbols() {
+    // Nothing to report errors to here, the cache is only written again next time
+    Save();
+}
+
+GHCI& HaskellSymbolsRegistry::LibSymbols::GetGHCI() {
+    if (!ghci) {
+        ghci = GHCIPool::Global().Acquire(packages, imports);
+        if (!ghci) {
+            throw std::runtime_error("failed to create ghci session");
+        }
+    }
+
+    return **ghci;
+}
+
+std::error_code HaskellSymbolsRegistry::LibSymbols::Save() {
+    if (!cache_path || !has_unsaved) {
+        return {};
+    }
+
+    auto error = SaveSymbolsCache(*cache_path, cache_key, symbols);
+    if (!error) {
+        has_unsaved = false;
     }
 
-    return ghci_->GetTypeConstructor(name);
+    return error;
 }
 
 }  // namespace komaru::translate::hs
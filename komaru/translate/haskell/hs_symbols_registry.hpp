@@ -3,6 +3,15 @@
 #include <komaru/translate/symbols_registry_like.hpp>
 #include <komaru/translate/haskell/hs_import.hpp>
 #include <komaru/translate/haskell/ghci.hpp>
+#include <komaru/translate/haskell/ghci_pool.hpp>
+#include <komaru/translate/haskell/hs_interface_symbols.hpp>
+#include <komaru/translate/haskell/hs_symbols_cache.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
 
 namespace komaru::translate::hs {
 
@@ -12,21 +21,81 @@ public:
 
     void SetPackages(std::vector<std::string> packages);
     void SetImports(std::vector<HaskellImport> imports);
+    // Library symbols are kept in `cache_dir` between runs, so a warm start doesn't need GHCi.
+    // Used from the next Reload, like packages and imports. Defaults to
+    // $KOMARU_SYMBOLS_CACHE_DIR if it's set.
+    void SetCacheDir(std::optional<std::filesystem::path> cache_dir);
+    // Library symbols are answered from the interface file alone, GHCi and the cache aren't
+    // used. Used from the next Reload, which throws if the file can't be loaded. Defaults to
+    // $KOMARU_HS_INTERFACE_FILE if it's set.
+    void SetInterfaceFile(std::optional<std::filesystem::path> interface_file);
     void Reload();
+    // Writes library symbols looked up so far to the cache. It's also done once the registry
+    // and its forks stop using them.
+    std::error_code SaveCache() const;
+    // Registry with the same library and global functions but no local ones, e.g. for cooking
+    // a function on another thread. Library symbols are looked up under a shared lock. Global
+    // functions are shared until either side changes them, local ones are the fork's own.
+    HaskellSymbolsRegistry Fork() const;
+    // Types of functions are pinned until they're reset
     void AddLocalFunction(const std::string& name, lang::Type type);
     void AddGlobalFunction(const std::string& name, lang::Type type);
     void ResetLocalFunctions();
     void ResetGlobalFunctions();
     std::optional<lang::Type> FindFunction(const std::string& name) const;
+    // Local or global function of the name, the only answers of FindFunction that may change
+    // without a reload
+    std::optional<lang::Type> FindProgramFunction(const std::string& name) const;
     std::optional<lang::TypeConstructor> FindTypeConstructor(const std::string& name) const;
+    // Asks GHCi about all library symbols among `names` in one batch, so that the following
+    // Find* calls don't wait for a GHCi round trip each
+    void PrefetchFunctions(std::span<const std::string> names) const;
+    void PrefetchTypeConstructors(std::span<const std::string> names) const;
+
+    // Changes whenever library symbols may be answered differently
+    uint64_t GetLibGeneration() const;
+
+private:
+    // Shared by a registry and its forks. A GHCi session is leased from the global pool on
+    // the first symbol the cache misses and returned once the registry and its forks are gone.
+    struct LibSymbols {
+        ~LibSymbols();
+
+        GHCI& GetGHCI();
+        std::error_code Save();
+
+        std::mutex mutex;
+        std::vector<std::string> packages;
+        std::vector<HaskellImport> imports;
+        std::optional<GHCIPool::Lease> ghci;
+        // Never changes once the registry is reloaded, so it's read without the mutex
+        std::optional<HaskellInterfaceSymbols> interface;
+        HaskellLibSymbols symbols;
+        std::optional<std::filesystem::path> cache_path;
+        std::string cache_key;
+        bool has_unsaved{false};
+    };
+
+    // Functions are kept past the current type universe, so their types are pinned
+    struct Functions {
+        std::unordered_map<std::string, lang::Type> types;
+        lang::PinnedTypes pins;
+    };
+
+    HaskellSymbolsRegistry() = default;
+
+    // Copies global functions first if a fork still uses them
+    Functions& GetOwnGlobalFunctions();
 
 private:
-    std::unique_ptr<GHCI> ghci_;
+    std::shared_ptr<LibSymbols> lib_;
     std::vector<std::string> packages_;
     std::vector<HaskellImport> imports_;
-    std::unordered_map<std::string, lang::Type> local_symbols_;
-    std::unordered_map<std::string, lang::Type> global_symbols_;
-    mutable std::unordered_map<std::string, lang::Type> lib_symbols_cache_;
+    std::optional<std::filesystem::path> cache_dir_;
+    std::optional<std::filesystem::path> interface_file_;
+    Functions local_symbols_;
+    std::shared_ptr<Functions> global_symbols_{std::make_shared<Functions>()};
+    uint64_t lib_generation_{0};
 };
 
 }  // namespace komaru::translate::hs
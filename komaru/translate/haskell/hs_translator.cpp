@@ -49,13 +49,17 @@ ResultProgram HaskellTranslationRequest::Translate() && {
     lang::Type main_type = lang::Type::Parameterized("IO", {lang::Type::Singleton()});
     bool is_interpreter_mode = false;
 
+    MorphismStrings morphism_strs(cat_prog_.GetMorphisms().Size());
+
     auto roots = DiscoverFunctions();
     for (const auto& root : roots) {
         if (root->GetName() == "main" && FindReturnType(root) != main_type) {
             is_interpreter_mode = true;
         }
 
-        auto maybe_def = HaskellFuncTranslationRequest(*root).Translate();
+        auto maybe_def =
+            HaskellFuncTranslationRequest(*root, cat_prog_.GetMorphisms(), morphism_strs)
+                .Translate();
         if (!maybe_def) {
             return std::unexpected(maybe_def.error());
         }
@@ -77,25 +81,34 @@ ResultProgram HaskellTranslationRequest::Translate() && {
 
 std::vector<const CPNode*> HaskellTranslationRequest::DiscoverFunctions() {
     std::unordered_map<const CPNode*, const CPNode*> node2root;
-
-    auto find_root = [&](auto&& self, const CPNode* node) -> const CPNode* {
-        if (node->IncomingArrows().empty()) {
-            return node;
+    std::vector<const CPNode*> path;
+
+    // Climbs the first incoming arrows until a root or a node with a known root
+    auto find_root = [&](const CPNode* node) -> const CPNode* {
+        const CPNode* root = nullptr;
+
+        while (!root) {
+            if (node->IncomingArrows().empty()) {
+                root = node;
+            } else if (auto it = node2root.find(node); it != node2root.end()) {
+                root = it->second;
+            } else {
+                path.push_back(node);
+                node = &node->IncomingArrows().front()->SourcePin().GetNode();
+            }
         }
 
-        auto it = node2root.find(node);
-        if (it != node2root.end()) {
-            return it->second;
+        for (const CPNode* path_node : path) {
+            node2root[path_node] = root;
         }
+        path.clear();
 
-        auto root = self(self, &node->IncomingArrows().front()->SourcePin().GetNode());
-        node2root[node] = root;
         return root;
     };
 
     std::unordered_set<const CPNode*> roots;
     for (const auto& node : cat_prog_.GetNodes()) {
-        roots.insert(find_root(find_root, &node));
+        roots.insert(find_root(&node));
     }
 
     return std::vector<const CPNode*>(roots.begin(), roots.end());
@@ -0,0 +1,73 @@
+#pragma once
+#include <komaru/util/non_copyable.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace komaru::util {
+
+// Bump allocator: memory is cut from big blocks and freed only together with the arena.
+// Objects placed in it are never destroyed, so only trivially destructible ones are allowed.
+class Arena : public NonCopyable {
+public:
+    explicit Arena(size_t first_block_size = 4096)
+        : next_block_size_(first_block_size) {
+    }
+
+    void* Allocate(size_t size, size_t alignment) {
+        size_t padding = -reinterpret_cast<std::uintptr_t>(cur_) & (alignment - 1);
+        if (cur_ == nullptr || padding + size > left_) {
+            NewBlock(size + alignment);
+            padding = -reinterpret_cast<std::uintptr_t>(cur_) & (alignment - 1);
+        }
+
+        std::byte* res = cur_ + padding;
+        cur_ = res + size;
+        left_ -= padding + size;
+        return res;
+    }
+
+    template <typename T>
+    std::span<const T> CopyArray(std::span<const T> values) {
+        static_assert(std::is_trivially_destructible_v<T>);
+
+        if (values.empty()) {
+            return {};
+        }
+
+        T* data = static_cast<T*>(Allocate(values.size_bytes(), alignof(T)));
+        std::uninitialized_copy(values.begin(), values.end(), data);
+        return {data, values.size()};
+    }
+
+    size_t GetBytesReserved() const {
+        return bytes_reserved_;
+    }
+
+private:
+    void NewBlock(size_t min_size) {
+        size_t size = std::max(next_block_size_, min_size);
+        blocks_.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+        cur_ = blocks_.back().get();
+        left_ = size;
+        bytes_reserved_ += size;
+        // Grow geometrically so big arenas don't end up with lots of tiny blocks
+        next_block_size_ = std::min(next_block_size_ * 2, kMaxBlockSize);
+    }
+
+private:
+    static constexpr size_t kMaxBlockSize = size_t{1} << 20;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::byte* cur_{nullptr};
+    size_t left_{0};
+    size_t next_block_size_;
+    size_t bytes_reserved_{0};
+};
+
+}  // namespace komaru::util
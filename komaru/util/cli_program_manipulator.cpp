@@ -2,27 +2,39 @@
 
 #include <komaru/util/string.hpp>
 
+#include <sys/eventfd.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 
+#include <algorithm>
+#include <cstring>
 #include <format>
 
 namespace komaru::util {
 
 CLIProgramManipulator::CLIProgramManipulator(const std::vector<std::string>& start_command,
-                                             std::string query_sep, bool skip_initial_response)
-    : query_sep_(query_sep) {
+                                             std::string query_sep, bool skip_initial_response,
+                                             Timeout timeout, std::stop_token stop)
+    : query_sep_(query_sep),
+      timeout_(timeout),
+      stop_(std::move(stop)) {
     auto joined_command = start_command | JoinStrings(" ") | std::ranges::to<std::string>();
 
     int pipe_to[2];
     int pipe_from[2];
 
     pipe2(pipe_to, O_CLOEXEC);
-    pipe2(pipe_from, O_CLOEXEC | O_NONBLOCK);
+    pipe2(pipe_from, O_CLOEXEC);
+    // Only our end, the program's output has to block once the pipe is full
+    fcntl(pipe_from[0], F_SETFL, O_NONBLOCK);
 
     write_fd_ = pipe_to[1];
     read_fd_ = pipe_from[0];
+    if (stop_.stop_possible()) {
+        stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    }
 
     pid_ = fork();
 
@@ -39,14 +51,37 @@ CLIProgramManipulator::CLIProgramManipulator(const std::vector<std::string>& sta
         exit(42);
     }
 
+    // Otherwise the program's exit isn't seen as the end of its output
+    close(pipe_to[0]);
+    close(pipe_from[1]);
+
     if (skip_initial_response) {
-        Receive();
+        try {
+            Receive();
+        } catch (...) {
+            // The destructor isn't called if the constructor throws
+            Kill();
+            close(read_fd_);
+            close(write_fd_);
+            if (stop_fd_ >= 0) {
+                close(stop_fd_);
+            }
+            throw;
+        }
     }
 }
 
 CLIProgramManipulator::~CLIProgramManipulator() {
-    kill(pid_, SIGKILL);
-    waitpid(pid_, nullptr, 0);
+    Kill();
+    close(read_fd_);
+    close(write_fd_);
+    if (stop_fd_ >= 0) {
+        close(stop_fd_);
+    }
+}
+
+void CLIProgramManipulator::SetTimeout(Timeout timeout) {
+    timeout_ = timeout;
 }
 
 std::string CLIProgramManipulator::Interact(const std::string& input) {
@@ -54,7 +89,43 @@ std::string CLIProgramManipulator::Interact(const std::string& input) {
     return Receive();
 }
 
+std::vector<std::string> CLIProgramManipulator::InteractMany(
+    std::span<const std::string> inputs) {
+    std::vector<std::string> responses;
+    responses.reserve(inputs.size());
+    size_t sent = 0;
+
+    while (responses.size() < inputs.size()) {
+        while (sent < inputs.size() && sent - responses.size() < kMaxInFlight) {
+            Send(inputs[sent++]);
+        }
+        responses.push_back(Receive());
+    }
+
+    return responses;
+}
+
+bool CLIProgramManipulator::IsAlive() {
+    if (!exited_ && waitpid(pid_, nullptr, WNOHANG) != 0) {
+        exited_ = true;
+    }
+    return !exited_;
+}
+
+void CLIProgramManipulator::Kill() {
+    if (!exited_) {
+        kill(pid_, SIGKILL);
+        waitpid(pid_, nullptr, 0);
+        exited_ = true;
+    }
+}
+
 void CLIProgramManipulator::Send(const std::string& input) {
+    // Writing to a killed program would raise SIGPIPE
+    if (exited_) {
+        throw std::runtime_error("child process has exited");
+    }
+
     errno = 0;
     ssize_t n_written = write(write_fd_, input.c_str(), input.size());
     if (errno != 0) {
@@ -69,37 +140,98 @@ void CLIProgramManipulator::Send(const std::string& input) {
 }
 
 std::string CLIProgramManipulator::Receive() {
-    std::string res;
+    Deadline deadline;
+    if (timeout_) {
+        deadline = std::chrono::steady_clock::now() + *timeout_;
+    }
+
+    size_t scanned = received_pos_;
+
+    // Only wakes the poll() up, the program is killed on this thread, which also reaps it
+    std::stop_callback on_stop(stop_, [this]() {
+        uint64_t one = 1;
+        [[maybe_unused]] auto n_written = write(stop_fd_, &one, sizeof(one));
+    });
 
     while (true) {
-        errno = 0;
-        ssize_t n_read = read(read_fd_, read_buf_, sizeof(read_buf_));
-        int err = errno;
-        if (n_read > 0) {
-            res += std::string(read_buf_, n_read);
+        // Only the new bytes and the separator's possible beginning before them are searched
+        size_t pos = received_.find(query_sep_, scanned);
+        if (pos != std::string::npos) {
+            std::string res = received_.substr(received_pos_, pos - received_pos_);
+            received_pos_ = pos + query_sep_.size();
+            return res;
         }
-        if (res.ends_with(query_sep_)) {
+        scanned = std::max(received_pos_,
+                           received_.size() - std::min(received_.size(), query_sep_.size() - 1));
+
+        if (received_pos_ > received_.size() / 2) {
+            received_.erase(0, received_pos_);
+            scanned -= received_pos_;
+            received_pos_ = 0;
+        }
+
+        if (!ReadSome(deadline)) {
             break;
         }
-        if (err == EAGAIN) {
+    }
+
+    throw std::runtime_error(std::format(
+        "received unexpected response from child process: \"{}\"",
+        std::string_view(received_).substr(received_pos_)));
+}
+
+bool CLIProgramManipulator::ReadSome(Deadline deadline) {
+    while (true) {
+        size_t old_size = received_.size();
+        ssize_t n_read = 0;
+        int err = 0;
+
+        received_.resize_and_overwrite(old_size + kReadChunkSize, [&](char* data, size_t size) {
+            errno = 0;
+            n_read = read(read_fd_, data + old_size, size - old_size);
+            err = errno;
+            return old_size + static_cast<size_t>(std::max<ssize_t>(n_read, 0));
+        });
+
+        if (n_read > 0) {
+            return true;
+        }
+        if (n_read == 0) {
+            return false;
+        }
+        if (err == EINTR) {
             continue;
         }
-        if (err != 0) {
+        if (err != EAGAIN) {
             throw std::runtime_error(
                 std::format("failed to read from child process: {}", strerror(err)));
         }
-        if (n_read == 0) {
-            break;
+
+        int timeout_ms = -1;
+        if (deadline) {
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(
+                *deadline - std::chrono::steady_clock::now());
+            timeout_ms = static_cast<int>(std::max<int64_t>(left.count(), 0));
         }
-    }
 
-    if (res.ends_with(query_sep_)) {
-        res.resize(res.size() - query_sep_.size());
-    } else {
-        throw std::runtime_error(
-            std::format("received unexpected response from child process: \"{}\"", res));
+        pollfd fds[] = {{.fd = read_fd_, .events = POLLIN, .revents = 0},
+                        {.fd = stop_fd_, .events = POLLIN, .revents = 0}};
+        int n_ready = poll(fds, stop_fd_ < 0 ? 1 : 2, timeout_ms);
+
+        if (stop_.stop_requested()) {
+            Kill();
+            throw std::runtime_error("stopped waiting for child process");
+        }
+        if (n_ready == 0) {
+            Kill();
+            throw std::runtime_error(
+                std::format("child process didn't respond in {} ms", timeout_->count()));
+        }
+        if (n_ready < 0 && errno != EINTR) {
+            throw std::runtime_error(
+                std::format("failed to wait for child process: {}", strerror(errno)));
+        }
     }
-    return res;
 }
 
 }  // namespace komaru::util
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <chrono>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <string>
 #include <vector>
 
@@ -7,24 +11,57 @@
 
 namespace komaru::util {
 
+// Reading waits in poll() instead of spinning, so a program that thinks costs no CPU.
+// Received bytes are only scanned for query_sep once, so responses are read in linear time.
+// Requesting `stop` kills the program and fails the wait for its response, e.g. to not block
+// a shutdown on a program that is still starting.
 class CLIProgramManipulator : public NonCopyableNonMovable {
 public:
+    using Timeout = std::optional<std::chrono::milliseconds>;
+
     explicit CLIProgramManipulator(const std::vector<std::string>& start_command,
-                                   std::string query_sep, bool skip_initial_response = true);
+                                   std::string query_sep, bool skip_initial_response = true,
+                                   Timeout timeout = std::nullopt, std::stop_token stop = {});
     ~CLIProgramManipulator();
 
+    // How long a response may take, nullopt to wait forever. The program is killed once it
+    // times out, since its late response would be taken for the next query's.
+    void SetTimeout(Timeout timeout);
+
     std::string Interact(const std::string& input);
+    // Sends the inputs without waiting for each response, responses are split by query_sep.
+    // Inputs are sent a window at a time, so neither side's pipe buffer can fill up.
+    std::vector<std::string> InteractMany(std::span<const std::string> inputs);
+    // Whether the program hasn't exited yet
+    bool IsAlive();
 
 private:
+    using Deadline = std::optional<std::chrono::steady_clock::time_point>;
+
+    static constexpr size_t kMaxInFlight = 64;
+    static constexpr size_t kReadChunkSize = 64 * 1024;
+
+    void Kill();
     void Send(const std::string& input);
     std::string Receive();
+    // Appends what the program has written, waiting until it writes something. Returns false
+    // at the end of its output.
+    bool ReadSome(Deadline deadline);
 
 private:
     std::string query_sep_;
     int pid_;
+    bool exited_{false};  // already waited for, so its pid may belong to another process
     int read_fd_;
     int write_fd_;
-    char read_buf_[1024];
+    Timeout timeout_;
+    std::stop_token stop_;
+    // Becomes readable once stop_ is requested, so that poll() wakes up. -1 if it can't be.
+    int stop_fd_{-1};
+    // Bytes after received_pos_ are read but not yet returned, e.g. responses to the next
+    // queries. The returned ones are dropped once they take up half of the buffer.
+    std::string received_;
+    size_t received_pos_{0};
 };
 
 }  // namespace komaru::util
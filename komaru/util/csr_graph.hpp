@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace komaru::util {
+
+// Directed graph with adjacency lists packed into one array: edges going out of node v are
+// edges_[offsets_[v]..offsets_[v + 1]). Every edge remembers the index it was given under,
+// e.g. of the connection it was built from. Edges of a node keep the order they were given in.
+class CsrGraph {
+public:
+    struct Edge {
+        size_t node;
+        size_t idx;
+    };
+
+    CsrGraph() = default;
+
+    // get_edge(i) gives the {from, to} pair of the i-th edge
+    template <typename F>
+    static CsrGraph Build(size_t nodes_num, size_t edges_num, F&& get_edge) {
+        CsrGraph graph;
+        graph.offsets_.assign(nodes_num + 1, 0);
+        graph.edges_.resize(edges_num);
+
+        for (size_t i = 0; i < edges_num; ++i) {
+            ++graph.offsets_[get_edge(i).first + 1];
+        }
+        for (size_t v = 0; v < nodes_num; ++v) {
+            graph.offsets_[v + 1] += graph.offsets_[v];
+        }
+
+        std::vector<size_t> pos(graph.offsets_.begin(), graph.offsets_.end() - 1);
+        for (size_t i = 0; i < edges_num; ++i) {
+            auto [from, to] = get_edge(i);
+            graph.edges_[pos[from]++] = Edge{.node = to, .idx = i};
+        }
+
+        return graph;
+    }
+
+    size_t Size() const {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+    std::span<const Edge> operator[](size_t v) const {
+        return {edges_.data() + offsets_[v], edges_.data() + offsets_[v + 1]};
+    }
+
+private:
+    std::vector<size_t> offsets_;
+    std::vector<Edge> edges_;
+};
+
+}  // namespace komaru::util
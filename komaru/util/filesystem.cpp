@@ -4,6 +4,12 @@
 
 #include <fstream>
 #include <sstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace komaru::util {
 
@@ -40,4 +46,76 @@ std::error_code WriteFile(const std::filesystem::path& path, const std::string&
     return std::error_code{};
 }
 
+std::expected<MappedFile, std::error_code> MappedFile::Open(const std::filesystem::path& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return Error<MappedFile>();
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        auto error = Error<MappedFile>();
+        close(fd);
+        return error;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+
+    // mmap refuses empty mappings
+    if (size == 0) {
+        close(fd);
+        return MappedFile(nullptr, 0);
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        auto error = Error<MappedFile>();
+        close(fd);
+        return error;
+    }
+
+    // The mapping stays valid without the descriptor
+    close(fd);
+
+    // The file is read front to back once
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    return MappedFile(static_cast<const char*>(data), size);
+}
+
+MappedFile::MappedFile(const char* data, size_t size)
+    : data_(data),
+      size_(size) {
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    Unmap();
+}
+
+std::string_view MappedFile::View() const {
+    return {data_, size_};
+}
+
+void MappedFile::Unmap() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
 }  // namespace komaru::util
@@ -1,6 +1,9 @@
 #pragma once
+#include <komaru/util/non_copyable.hpp>
+
 #include <filesystem>
 #include <expected>
+#include <string_view>
 #include <system_error>
 
 namespace komaru::util {
@@ -10,4 +13,25 @@ std::filesystem::path GenTmpFilepath();
 std::expected<std::string, std::error_code> ReadFile(const std::filesystem::path& path);
 std::error_code WriteFile(const std::filesystem::path& path, const std::string& content);
 
+// Read-only view of a whole file mapped into memory, pages are loaded as they are touched
+class MappedFile : public NonCopyable {
+public:
+    static std::expected<MappedFile, std::error_code> Open(const std::filesystem::path& path);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    std::string_view View() const;
+
+private:
+    MappedFile(const char* data, size_t size);
+
+    void Unmap();
+
+private:
+    const char* data_{nullptr};
+    size_t size_{0};
+};
+
 }  // namespace komaru::util
@@ -0,0 +1,117 @@
+#pragma once
+#include <komaru/util/small_vector.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <initializer_list>
+
+namespace komaru::util {
+
+// Map stored as a vector of pairs sorted by key. Meant for maps with a handful of entries,
+// which then live inline without any allocation.
+template <typename K, typename V, size_t N = 4>
+class FlatMap {
+public:
+    using value_type = std::pair<K, V>;  // NOLINT
+    using iterator = value_type*;  // NOLINT
+    using const_iterator = const value_type*;  // NOLINT
+
+    FlatMap() = default;
+
+    FlatMap(std::initializer_list<value_type> init) {
+        for (const auto& [key, value] : init) {
+            emplace(key, value);
+        }
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const K& key, Args&&... args) {  // NOLINT
+        auto it = LowerBound(key);
+        if (it != entries_.end() && it->first == key) {
+            return {it, false};
+        }
+
+        it = entries_.emplace(
+            it, std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return {it, true};
+    }
+
+    iterator find(const K& key) {  // NOLINT
+        return FindImpl(*this, key);
+    }
+
+    const_iterator find(const K& key) const {  // NOLINT
+        return FindImpl(*this, key);
+    }
+
+    bool contains(const K& key) const {  // NOLINT
+        return find(key) != end();
+    }
+
+    size_t erase(const K& key) {  // NOLINT
+        auto it = find(key);
+        if (it == end()) {
+            return 0;
+        }
+        entries_.erase(it);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) {  // NOLINT
+        return entries_.erase(pos);
+    }
+
+    V& operator[](const K& key) {
+        return emplace(key).first->second;
+    }
+
+    size_t size() const {  // NOLINT
+        return entries_.size();
+    }
+
+    bool empty() const {  // NOLINT
+        return entries_.empty();
+    }
+
+    void clear() {  // NOLINT
+        entries_.clear();
+    }
+
+    iterator begin() {  // NOLINT
+        return entries_.begin();
+    }
+
+    iterator end() {  // NOLINT
+        return entries_.end();
+    }
+
+    const_iterator begin() const {  // NOLINT
+        return entries_.begin();
+    }
+
+    const_iterator end() const {  // NOLINT
+        return entries_.end();
+    }
+
+    bool operator==(const FlatMap& o) const = default;
+
+private:
+    iterator LowerBound(const K& key) {
+        return std::ranges::lower_bound(entries_, key, {}, &value_type::first);
+    }
+
+    template <typename Self>
+    static auto FindImpl(Self& self, const K& key) {
+        auto it = std::ranges::lower_bound(self.entries_, key, {}, &value_type::first);
+        if (it != self.entries_.end() && it->first == key) {
+            return it;
+        }
+        return self.entries_.end();
+    }
+
+private:
+    SmallVector<value_type, N> entries_;
+};
+
+}  // namespace komaru::util
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+
+namespace komaru::util {
+
+// https://www.boost.org/doc/libs/1_85_0/libs/container_hash/doc/html/hash.html#notes_hash_combine
+inline constexpr size_t HashCombine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 12) + (seed >> 4));
+}
+
+}  // namespace komaru::util
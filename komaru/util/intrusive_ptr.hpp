@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace komaru::util {
+
+// Base for objects owned through IntrusivePtr. The counter lives in the object itself and is
+// atomic, so pointers to the same object may be copied and dropped on different threads.
+class RefCounted {
+protected:
+    RefCounted() = default;
+    ~RefCounted() = default;
+
+    // A copy is a new object, nobody owns it yet
+    RefCounted(const RefCounted&) {
+    }
+
+    RefCounted& operator=(const RefCounted&) {
+        return *this;
+    }
+
+private:
+    template <typename T>
+    friend class IntrusivePtr;
+
+    mutable std::atomic<uint32_t> ref_count_{0};
+};
+
+// Shared ownership without a separate control block. Objects are destroyed with `delete`,
+// so a class can route them to a pool through its own operator new/delete.
+template <typename T>
+class IntrusivePtr {
+public:
+    IntrusivePtr() = default;
+
+    IntrusivePtr(std::nullptr_t) {  // NOLINT
+    }
+
+    explicit IntrusivePtr(T* ptr)
+        : ptr_(ptr) {
+        Acquire();
+    }
+
+    IntrusivePtr(const IntrusivePtr& o)
+        : ptr_(o.ptr_) {
+        Acquire();
+    }
+
+    IntrusivePtr(IntrusivePtr&& o) noexcept
+        : ptr_(std::exchange(o.ptr_, nullptr)) {
+    }
+
+    IntrusivePtr& operator=(const IntrusivePtr& o) {
+        IntrusivePtr(o).Swap(*this);
+        return *this;
+    }
+
+    IntrusivePtr& operator=(IntrusivePtr&& o) noexcept {
+        IntrusivePtr(std::move(o)).Swap(*this);
+        return *this;
+    }
+
+    ~IntrusivePtr() {
+        Release();
+    }
+
+    T* get() const {  // NOLINT
+        return ptr_;
+    }
+
+    T& operator*() const {
+        return *ptr_;
+    }
+
+    T* operator->() const {
+        return ptr_;
+    }
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+    bool operator==(const IntrusivePtr& o) const {
+        return ptr_ == o.ptr_;
+    }
+
+    bool operator==(std::nullptr_t) const {
+        return ptr_ == nullptr;
+    }
+
+private:
+    // A new reference comes from an existing one, so nothing has to be ordered before it.
+    // The last release has to see every write made through the other references.
+    void Acquire() {
+        if (ptr_) {
+            ptr_->ref_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Release() {
+        if (ptr_ && ptr_->ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete ptr_;
+        }
+    }
+
+    void Swap(IntrusivePtr& o) noexcept {
+        std::swap(ptr_, o.ptr_);
+    }
+
+private:
+    T* ptr_{nullptr};
+};
+
+}  // namespace komaru::util
@@ -0,0 +1,135 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace komaru::util {
+
+// Per-thread free lists of blocks fitting one T, for objects that are created and dropped
+// in bulk, e.g. morphisms of a cooked program. A program cooked again reuses the blocks of
+// the previous one without touching malloc.
+//
+// Every block goes back to the pool it was cut from: a block freed by another thread is
+// pushed to the owner's remote list, which the owner takes over once its own list runs out.
+// The pool of an exited thread is handed to the next new thread, so memory is bounded by what
+// the threads ever held at once. Chunks are never given back.
+template <typename T>
+class ObjectPool {
+public:
+    static void* Allocate() {
+        Pool* pool = GetPool();
+        if (!pool->head) {
+            pool->head = pool->remote_head.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (!pool->head) {
+            Refill(*pool);
+        }
+
+        Block* block = pool->head;
+        pool->head = block->next;
+        block->owner = pool;
+        return block->storage;
+    }
+
+    static void Deallocate(void* ptr) {
+        auto* block = reinterpret_cast<Block*>(static_cast<std::byte*>(ptr) - kStorageOffset);
+        Pool* owner = block->owner;
+
+        if (owner == current_pool) {
+            block->next = owner->head;
+            owner->head = block;
+            return;
+        }
+
+        block->next = owner->remote_head.load(std::memory_order_relaxed);
+        while (!owner->remote_head.compare_exchange_weak(
+            block->next, block, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+private:
+    struct Pool;
+
+    struct Block {
+        // Only set while the block is allocated
+        Pool* owner;
+        union {
+            Block* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+    };
+
+    struct Pool {
+        Block* head{nullptr};
+        // Blocks freed by other threads, only the owner takes them
+        std::atomic<Block*> remote_head{nullptr};
+        size_t next_chunk_size{kFirstChunkSize};
+    };
+
+    // Pools of exited threads, waiting for a new one
+    struct Orphans {
+        std::mutex mutex;
+        std::vector<Pool*> pools;
+    };
+
+    // Gives the thread's pool away when the thread exits
+    struct PoolReleaser {
+        ~PoolReleaser() {
+            Orphans& orphans = GetOrphans();
+            std::lock_guard lock(orphans.mutex);
+            orphans.pools.push_back(current_pool);
+            current_pool = nullptr;
+        }
+    };
+
+    static Pool* GetPool() {
+        if (!current_pool) {
+            Orphans& orphans = GetOrphans();
+            {
+                std::lock_guard lock(orphans.mutex);
+                if (!orphans.pools.empty()) {
+                    current_pool = orphans.pools.back();
+                    orphans.pools.pop_back();
+                }
+            }
+            if (!current_pool) {
+                current_pool = new Pool();
+            }
+
+            thread_local PoolReleaser releaser;
+        }
+        return current_pool;
+    }
+
+    // Never destroyed, threads may exit after static destructors have run
+    static Orphans& GetOrphans() {
+        static auto* orphans = new Orphans();
+        return *orphans;
+    }
+
+    static void Refill(Pool& pool) {
+        size_t blocks_num = pool.next_chunk_size;
+        auto* chunk = static_cast<Block*>(
+            ::operator new(blocks_num * sizeof(Block), std::align_val_t(alignof(Block))));
+
+        for (size_t i = 0; i + 1 < blocks_num; ++i) {
+            chunk[i].next = &chunk[i + 1];
+        }
+        chunk[blocks_num - 1].next = pool.head;
+        pool.head = chunk;
+
+        pool.next_chunk_size = std::min(pool.next_chunk_size * 2, kMaxChunkSize);
+    }
+
+private:
+    static constexpr size_t kFirstChunkSize = 64;
+    static constexpr size_t kMaxChunkSize = 16384;
+    static constexpr size_t kStorageOffset = offsetof(Block, storage);
+
+    static inline thread_local Pool* current_pool = nullptr;
+};
+
+}  // namespace komaru::util
@@ -0,0 +1,229 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <initializer_list>
+
+namespace komaru::util {
+
+// Vector that keeps up to N elements inline and only goes to the heap when it grows past them
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(N > 0);
+
+public:
+    using value_type = T;  // NOLINT
+    using iterator = T*;  // NOLINT
+    using const_iterator = const T*;  // NOLINT
+
+    SmallVector() = default;
+
+    SmallVector(std::initializer_list<T> init) {
+        Reserve(init.size());
+        for (const auto& value : init) {
+            EmplaceBackUnchecked(value);
+        }
+    }
+
+    SmallVector(const SmallVector& o) {
+        Reserve(o.size_);
+        for (const auto& value : o) {
+            EmplaceBackUnchecked(value);
+        }
+    }
+
+    SmallVector(SmallVector&& o) noexcept {
+        MoveFrom(std::move(o));
+    }
+
+    SmallVector& operator=(const SmallVector& o) {
+        if (this != &o) {
+            SmallVector copy(o);
+            clear();
+            MoveFrom(std::move(copy));
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& o) noexcept {
+        if (this != &o) {
+            clear();
+            MoveFrom(std::move(o));
+        }
+        return *this;
+    }
+
+    ~SmallVector() {
+        clear();
+        FreeHeap();
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {  // NOLINT
+        Reserve(size_ + 1);
+        return EmplaceBackUnchecked(std::forward<Args>(args)...);
+    }
+
+    void push_back(T value) {  // NOLINT
+        emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args) {  // NOLINT
+        size_t idx = pos - begin();
+        T value(std::forward<Args>(args)...);
+
+        Reserve(size_ + 1);
+        if (idx == size_) {
+            EmplaceBackUnchecked(std::move(value));
+            return begin() + idx;
+        }
+
+        EmplaceBackUnchecked(std::move(data_[size_ - 1]));
+        std::move_backward(begin() + idx, end() - 2, end() - 1);
+        data_[idx] = std::move(value);
+
+        return begin() + idx;
+    }
+
+    iterator erase(const_iterator pos) {  // NOLINT
+        size_t idx = pos - begin();
+        std::move(begin() + idx + 1, end(), begin() + idx);
+        pop_back();
+        return begin() + idx;
+    }
+
+    void pop_back() {  // NOLINT
+        std::destroy_at(data_ + --size_);
+    }
+
+    void clear() {  // NOLINT
+        std::destroy(begin(), end());
+        size_ = 0;
+    }
+
+    void reserve(size_t capacity) {  // NOLINT
+        Reserve(capacity);
+    }
+
+    T& operator[](size_t i) {
+        return data_[i];
+    }
+
+    const T& operator[](size_t i) const {
+        return data_[i];
+    }
+
+    T& back() {  // NOLINT
+        return data_[size_ - 1];
+    }
+
+    const T& back() const {  // NOLINT
+        return data_[size_ - 1];
+    }
+
+    size_t size() const {  // NOLINT
+        return size_;
+    }
+
+    bool empty() const {  // NOLINT
+        return size_ == 0;
+    }
+
+    T* data() {  // NOLINT
+        return data_;
+    }
+
+    const T* data() const {  // NOLINT
+        return data_;
+    }
+
+    iterator begin() {  // NOLINT
+        return data_;
+    }
+
+    iterator end() {  // NOLINT
+        return data_ + size_;
+    }
+
+    const_iterator begin() const {  // NOLINT
+        return data_;
+    }
+
+    const_iterator end() const {  // NOLINT
+        return data_ + size_;
+    }
+
+    bool IsInline() const {
+        return data_ == InlineData();
+    }
+
+    bool operator==(const SmallVector& o) const {
+        return std::equal(begin(), end(), o.begin(), o.end());
+    }
+
+private:
+    template <typename... Args>
+    T& EmplaceBackUnchecked(Args&&... args) {
+        T* value = std::construct_at(data_ + size_, std::forward<Args>(args)...);
+        ++size_;
+        return *value;
+    }
+
+    void Reserve(size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+
+        capacity = std::max(capacity, capacity_ * 2);
+        T* new_data = std::allocator<T>().allocate(capacity);
+
+        std::uninitialized_move(begin(), end(), new_data);
+        std::destroy(begin(), end());
+        FreeHeap();
+
+        data_ = new_data;
+        capacity_ = capacity;
+    }
+
+    // Expects this to be empty
+    void MoveFrom(SmallVector&& o) {
+        if (!o.IsInline()) {
+            FreeHeap();
+            data_ = std::exchange(o.data_, o.InlineData());
+            capacity_ = std::exchange(o.capacity_, N);
+            size_ = std::exchange(o.size_, 0);
+            return;
+        }
+
+        Reserve(o.size_);
+        std::uninitialized_move(o.begin(), o.end(), data_);
+        size_ = o.size_;
+        o.clear();
+    }
+
+    void FreeHeap() {
+        if (!IsInline()) {
+            std::allocator<T>().deallocate(data_, capacity_);
+            data_ = InlineData();
+            capacity_ = N;
+        }
+    }
+
+    T* InlineData() {
+        return reinterpret_cast<T*>(inline_);
+    }
+
+    const T* InlineData() const {
+        return reinterpret_cast<const T*>(inline_);
+    }
+
+private:
+    alignas(T) std::byte inline_[N * sizeof(T)];
+    T* data_{InlineData()};
+    size_t size_{0};
+    size_t capacity_{N};
+};
+
+}  // namespace komaru::util
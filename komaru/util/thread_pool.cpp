@@ -0,0 +1,96 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <latch>
+
+namespace komaru::util {
+
+ThreadPool::ThreadPool(size_t threads_num) {
+    workers_.reserve(threads_num);
+    for (size_t i = 0; i < threads_num; ++i) {
+        workers_.emplace_back([this](std::stop_token stop) {
+            WorkerLoop(stop);
+        });
+    }
+}
+
+// Workers are stopped and joined by their jthreads
+ThreadPool::~ThreadPool() = default;
+
+ThreadPool& ThreadPool::Global() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+size_t ThreadPool::GetThreadsNum() const {
+    return workers_.size();
+}
+
+void ThreadPool::ParallelFor(size_t n, const std::function<void(size_t)>& func) {
+    std::atomic<size_t> next_idx{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto run = [&] {
+        for (size_t i = next_idx++; i < n; i = next_idx++) {
+            try {
+                func(i);
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    // The caller runs too, so there's no point in waking up more than n - 1 workers
+    size_t helpers_num = std::min(workers_.size(), n > 0 ? n - 1 : 0);
+    std::latch helpers_done(static_cast<ptrdiff_t>(helpers_num));
+
+    for (size_t i = 0; i < helpers_num; ++i) {
+        Submit([&] {
+            run();
+            helpers_done.count_down();
+        });
+    }
+
+    run();
+    helpers_done.wait();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.push(std::move(task));
+    }
+    has_tasks_.notify_one();
+}
+
+void ThreadPool::WorkerLoop(std::stop_token stop) {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock(mutex_);
+            if (!has_tasks_.wait(lock, stop, [this] {
+                    return !tasks_.empty();
+                })) {
+                return;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+
+        task();
+    }
+}
+
+}  // namespace komaru::util
@@ -0,0 +1,42 @@
+#pragma once
+#include <komaru/util/non_copyable_non_movable.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace komaru::util {
+
+// Fixed set of workers living as long as the pool. Workers are kept rather than spawned per
+// job, so their per-thread state, e.g. ObjectPool free lists, is reused from job to job.
+class ThreadPool : public NonCopyableNonMovable {
+public:
+    explicit ThreadPool(size_t threads_num);
+    ~ThreadPool();
+
+    // Shared by the whole process, one worker per hardware thread but the caller's
+    static ThreadPool& Global();
+
+    size_t GetThreadsNum() const;
+
+    // Calls func(i) for every i in [0, n) on the workers and the calling thread, and returns
+    // once all calls are done. The first exception thrown by a call is rethrown here.
+    // Must not be called from the pool's own workers: they could all end up waiting for helpers.
+    void ParallelFor(size_t n, const std::function<void(size_t)>& func);
+
+private:
+    void Submit(std::function<void()> task);
+    void WorkerLoop(std::stop_token stop);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable_any has_tasks_;
+    std::queue<std::function<void()>> tasks_;
+    std::vector<std::jthread> workers_;
+};
+
+}  // namespace komaru::util
@@ -2,6 +2,8 @@
 
 #include <komaru/lang/type.hpp>
 #include <komaru/lang/morphism.hpp>
+#include <komaru/lang/morphism_interner.hpp>
+#include <komaru/lang/cat_program.hpp>
 #include <komaru/util/std_extensions.hpp>
 
 using namespace komaru::lang;
@@ -40,3 +42,70 @@ TEST(Morphisms, RBind) {
     ASSERT_EQ(binded->ToString(), "+ 42");
     ASSERT_EQ(binded->GetType().ToString(), "a -> a");
 }
+
+TEST(Morphisms, NestedBinded) {
+    auto f = Morphism::ChainFunction("f", {Type::Int(), Type::Char(), Type::Bool(), Type::Int()});
+    auto inner = Morphism::Binded(f, {{1, Morphism::Value("x", Type::Char())}});
+    auto outer = Morphism::Binded(inner, {{0, Morphism::Value("y", Type::Int())},
+                                          {1, Morphism::Value("z", Type::Bool())}});
+
+    ASSERT_EQ(outer->ToString(), "f y x z");
+    ASSERT_EQ(outer->GetType().ToString(), "S -> Int");
+    ASSERT_EQ(outer->GetVariant<BindedMorphism>().GetMapping().size(), 3);
+
+    // The inner binded morphism is owned by the outer one only
+    auto less_than_ten = Morphism::Binded(Morphism::Binded(Morphism::Less(), {{0, Morphism::Position(0)}}),
+                                          {{0, Morphism::Literal(Literal::Number(10))}});
+    ASSERT_EQ(less_than_ten->ToString(), "$0 < 10");
+}
+
+TEST(Morphisms, Interning) {
+    auto plus_one = [](int value) {
+        return Morphism::Binded(Morphism::Plus(), {{1, Morphism::Literal(Literal::Number(value))}});
+    };
+
+    MorphismInterner interner;
+
+    auto first = interner.Intern(plus_one(1));
+    auto second = interner.Intern(plus_one(1));
+    auto other = interner.Intern(plus_one(2));
+
+    ASSERT_EQ(first, second);
+    ASSERT_NE(first, other);
+    ASSERT_EQ(interner.FindID(*first), interner.FindID(*second));
+    ASSERT_NE(interner.FindID(*first), interner.FindID(*other));
+    ASSERT_FALSE(interner.FindID(*plus_one(1)).has_value());
+
+    // `+` is shared between both binded morphisms
+    ASSERT_EQ(first->GetVariant<BindedMorphism>().GetUnderlyingMorphism(),
+              other->GetVariant<BindedMorphism>().GetUnderlyingMorphism());
+    ASSERT_EQ(interner.Size(), 5);
+
+    auto tuple = interner.Intern(Morphism::Tuple({plus_one(1), Morphism::True()}));
+    ASSERT_EQ(tuple->GetVariant<TupleMorphism>().GetMorphisms().front(), first);
+    ASSERT_EQ(tuple->ToString(), "(+ 1, True)");
+    ASSERT_EQ(interner.GetMorphism(interner.FindID(*tuple).value()), tuple);
+
+    // Equal names with different types are different morphisms
+    ASSERT_NE(interner.Intern(Morphism::Value("x", Type::Int())),
+              interner.Intern(Morphism::Value("x", Type::Char())));
+}
+
+TEST(Morphisms, ProgramSharesMorphisms) {
+    auto builder = CatProgramBuilder();
+
+    auto [start_node, start_pin] = builder.NewNodeWithPin(Type::Singleton(), "main");
+    auto& a_node = builder.NewNode(Type::Int(), "a");
+    auto& b_node = builder.NewNode(Type::Int(), "b");
+
+    builder.Connect(start_pin, a_node, Morphism::Value("x", Type::Int()))
+        .Connect(start_pin, b_node, Morphism::Value("x", Type::Int()));
+
+    auto program = builder.Extract();
+    const auto& arrows = program.GetNodes().front().OutPins().front().Arrows();
+
+    ASSERT_EQ(arrows.size(), 2);
+    ASSERT_EQ(arrows[0].GetMorphism(), arrows[1].GetMorphism());
+    ASSERT_EQ(program.GetMorphisms().Size(), 1);
+    ASSERT_EQ(program.GetMorphisms().FindID(*arrows[0].GetMorphism()), 0);
+}
@@ -3,9 +3,43 @@
 #include <komaru/util/std_extensions.hpp>
 #include <komaru/lang/type.hpp>
 #include <komaru/lang/morphism.hpp>
+
+#include <latch>
+#include <random>
+#include <thread>
+
 using namespace komaru::lang;
 using namespace komaru::util;
 
+static Type RandomType(std::mt19937& gen, size_t depth) {
+    static const std::vector<std::string> kNames = {"Int", "Char", "Bool", "a", "b", "Maybe"};
+
+    auto pick = [&gen](size_t n) {
+        return std::uniform_int_distribution<size_t>(0, n - 1)(gen);
+    };
+
+    const std::string& name = kNames[pick(kNames.size())];
+    if (depth == 0) {
+        return name == "Maybe" ? Type::Parameterized(name, {Type::Int()}) : Type::Common(name);
+    }
+
+    switch (pick(4)) {
+        case 0:
+            return Type::Parameterized(name, {RandomType(gen, depth - 1)});
+        case 1: {
+            std::vector<Type> types(2 + pick(2));
+            for (auto& type : types) {
+                type = RandomType(gen, depth - 1);
+            }
+            return Type::Tuple(std::move(types));
+        }
+        case 2:
+            return Type::Function(RandomType(gen, depth - 1), RandomType(gen, depth - 1));
+        default:
+            return Type::List(RandomType(gen, depth - 1));
+    }
+}
+
 TEST(Types, Atom) {
     std::vector<std::string> names = {"Int", "Char", "Float", "Bool"};
     std::vector<Type> types = {Type::Int(), Type::Char(), Type::Float(), Type::Bool()};
@@ -47,8 +81,8 @@ TEST(Types, Tuple) {
 
     ASSERT_EQ(tuple_ic2.ToString(), tuple_ic1.GetVariant<TupleType>().ToString());
     ASSERT_EQ(tuple_ic2.ToString(), "Int x Char");
-    ASSERT_TRUE(
-        VecEq(tuple_ic1.GetVariant<TupleType>().GetTupleTypes(), {Type::Int(), Type::Char()}));
+    ASSERT_TRUE(std::ranges::equal(tuple_ic1.GetVariant<TupleType>().GetTupleTypes(),
+                                   std::vector{Type::Int(), Type::Char()}));
 }
 
 TEST(Types, Function) {
@@ -76,6 +110,126 @@ TEST(Types, List) {
     ASSERT_EQ(list_i.GetVariant<ListType>().Inner(), Type::Int());
 }
 
+TEST(Types, StructuralInterning) {
+    Type maybe_int1 = Type::Parameterized("Maybe", {Type::Int()});
+    Type maybe_int2 = Type::Parameterized(std::string("Maybe"), {Type::Simple("Int")});
+    ASSERT_EQ(maybe_int1, maybe_int2);
+    ASSERT_EQ(std::hash<Type>{}(maybe_int1), std::hash<Type>{}(maybe_int2));
+
+    // Same children, different kinds or names
+    std::vector<Type> types = {maybe_int1,
+                               Type::Parameterized("IO", {Type::Int()}),
+                               Type::List(Type::Int()),
+                               Type::Tuple({Type::Int()}),
+                               Type::Tuple({Type::Int(), Type::Int()}),
+                               Type::Function(Type::Int(), Type::Int())};
+
+    for (size_t i = 0; i < types.size(); ++i) {
+        for (size_t j = 0; j < types.size(); ++j) {
+            ASSERT_EQ(i == j, types[i] == types[j]) << types[i].ToString(Style::Debug) << " vs "
+                                                    << types[j].ToString(Style::Debug);
+        }
+    }
+
+    ASSERT_EQ(Type::Parameterized("[]", {Type::Int()}), Type::List(Type::Int()));
+    ASSERT_EQ(Type::Tuple({Type::Int(), Type::Int()}), Type::Int().Pow(2));
+}
+
+TEST(Types, CompactStorage) {
+    static_assert(sizeof(Type) == sizeof(uint32_t));
+
+    std::vector<Type> children = {Type::Int(), Type::Char(), Type::Var("a")};
+    Type tuple1 = Type::Tuple(children);
+    children.clear();
+    Type tuple2 = Type::Tuple({Type::Int(), Type::Char(), Type::Var("a")});
+
+    // Child lists live in the type store, not in the caller's vectors
+    auto types1 = tuple1.GetVariant<TupleType>().GetTupleTypes();
+    auto types2 = tuple2.GetVariant<TupleType>().GetTupleTypes();
+    ASSERT_EQ(types1.data(), types2.data());
+    ASSERT_EQ(types1.size(), 3);
+    ASSERT_EQ(types1[2], Type::Var("a"));
+    ASSERT_EQ(tuple1.ToString(), "Int x Char x a");
+}
+
+TEST(Types, DerivedProperties) {
+    Type func = Type::FunctionChain({Type::Int(), Type::Var("a"), Type::List(Type::Char())});
+    ASSERT_EQ(func.GetParamNum(), 2);
+    ASSERT_FALSE(func.IsValueType());
+    ASSERT_FALSE(func.IsConcrete());
+    ASSERT_TRUE(func.ShouldBeShielded());
+
+    // Computed once, so every call views the same storage
+    auto flattened = func.FlattenFunction();
+    ASSERT_EQ(flattened.data(), func.FlattenFunction().data());
+    ASSERT_TRUE(std::ranges::equal(
+        flattened, std::vector{Type::Int(), Type::Var("a"), Type::List(Type::Char())}));
+
+    Type value = Type::Function(Type::Singleton(), Type::Int());
+    ASSERT_EQ(value.GetParamNum(), 0);
+    ASSERT_TRUE(value.IsValueType());
+    ASSERT_TRUE(value.IsConcrete());
+    ASSERT_TRUE(std::ranges::equal(value.FlattenFunction(), std::vector{Type::Int()}));
+
+    Type tuple = Type::Tuple({Type::Int(), Type::Bool()});
+    ASSERT_EQ(tuple.GetComponentsNum(), 2);
+    ASSERT_EQ(tuple.GetComponents().data(), tuple.GetVariant<TupleType>().GetTupleTypes().data());
+    ASSERT_TRUE(std::ranges::equal(Type::Int().GetComponents(), std::vector{Type::Int()}));
+    ASSERT_TRUE(std::ranges::equal(Type::Int().FlattenFunction(), std::vector{Type::Int()}));
+}
+
+TEST(Types, Builtins) {
+    static_assert(Type::Int() != Type::Bool());
+    static_assert(Type() == Type::Auto());
+
+    ASSERT_EQ(Type::Simple("Int"), Type::Int());
+    ASSERT_EQ(Type::Var("auto"), Type::Auto());
+    ASSERT_EQ(Type::List(Type::Char()), Type::String());
+    ASSERT_EQ(Type::Parameterized("IO", {Type::Singleton()}).ToString(), "IO S");
+    ASSERT_EQ(Type::String().ToString(), "[Char]");
+
+    ASSERT_TRUE(Type::Auto().IsAuto());
+    ASSERT_TRUE(Type::Auto().IsTypeVar());
+    ASSERT_TRUE(Type::Var("a").IsTypeVar());
+    ASSERT_FALSE(Type::Var("a").IsAuto());
+    ASSERT_FALSE(Type::Int().IsTypeVar());
+    ASSERT_FALSE(Type::Parameterized("m", {Type::Int()}).IsTypeVar());
+    ASSERT_TRUE(Type::Singleton().GetVariant<CommonType>().GetSymbol() == BuiltinSymbol::kSingleton);
+}
+
+TEST(Types, Rendering) {
+    Type type = Type::FunctionChain({Type::Parameterized("Maybe", {Type::List(Type::Int())}),
+                                     Type::Tuple({Type::Char(), Type::Var("a")})});
+
+    // Rendered once, so every call views the same text
+    std::string_view text = type.ToStringView();
+    ASSERT_EQ(text, "(Maybe [Int]) -> Char x a");
+    ASSERT_EQ(text.data(), type.ToStringView().data());
+    ASSERT_EQ(type.ToStringView(Style::Haskell), "(Maybe [Int]) -> (Char, a)");
+    ASSERT_EQ(type.ToString(Style::Debug), type.Visit([](const TypeLike auto& t) {
+        return t.ToString(Style::Debug);
+    }));
+
+    std::string out = "f :: ";
+    type.AppendTo(out, Style::Haskell);
+    ASSERT_EQ(out, "f :: (Maybe [Int]) -> (Char, a)");
+    ASSERT_EQ(std::format("<{}>", Type::String()), "<[Char]>");
+}
+
+TEST(Types, Symbols) {
+    Symbol maybe1("Maybe");
+    Symbol maybe2(std::string("Maybe"));
+    ASSERT_EQ(maybe1, maybe2);
+    ASSERT_NE(maybe1, Symbol("Either"));
+    ASSERT_EQ(maybe1.GetName(), "Maybe");
+    ASSERT_TRUE(Symbol().IsEmpty());
+    ASSERT_EQ(Symbol().GetName(), "");
+
+    Type maybe_int = Type::Parameterized(maybe1, {Type::Int()});
+    ASSERT_EQ(maybe_int.GetVariant<CommonType>().GetSymbol(), maybe2);
+    ASSERT_EQ(maybe_int.GetVariant<CommonType>().GetName(), "Maybe");
+}
+
 TEST(Types, SimpleDeduction) {
     Type func_ic = Type::Function(Type::Var("a"), Type::Char());
     Type arg_i = Type::Int();
@@ -97,6 +251,18 @@ TEST(Types, SimpleSubstitution) {
     ASSERT_EQ(maybe_deduced_type.value(), Type::Int());
 }
 
+TEST(Types, SubstitutionFromArgTypes) {
+    Type less_t = Morphism::Less()->GetType();
+    std::pair<size_t, Type> args[] = {{1, Type::Char()}};
+
+    ASSERT_EQ(DeduceTypes(less_t, args),
+              Type::FunctionChain({Type::Char(), Type::Char(), Type::Bool()}));
+    ASSERT_EQ(TryMakeSubstitution(less_t, args), Type::Function(Type::Char(), Type::Bool()));
+
+    std::pair<size_t, Type> bad_args[] = {{0, Type::Char()}, {1, Type::Int()}};
+    ASSERT_FALSE(TryMakeSubstitution(less_t, bad_args).has_value());
+}
+
 TEST(Types, MatchDoesNotLoseInformation) {
     auto param_type = Type::Int();
     auto arg_type = Type::Var("a");
@@ -148,3 +314,188 @@ TEST(Types, ParameterizedSubstitution) {
     ASSERT_EQ(deduced.ToString(), "IO Int");
     ASSERT_EQ(deduced, io_int) << "deduced type in debug style: " << deduced.ToString(Style::Debug);
 }
+
+TEST(Types, ConcurrentInterning) {
+    constexpr size_t kThreadsNum = 8;
+    constexpr size_t kSeedsNum = kThreadsNum / 2;
+    constexpr size_t kTypesPerThread = 250'000;
+
+    // Threads with the same seed race to intern exactly the same types
+    std::vector<std::vector<Type>> results(kThreadsNum);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < kThreadsNum; ++t) {
+        threads.emplace_back([&result = results[t], seed = t % kSeedsNum]() {
+            std::mt19937 gen(seed);
+            result.reserve(kTypesPerThread);
+            for (size_t i = 0; i < kTypesPerThread; ++i) {
+                result.push_back(RandomType(gen, i % 5));
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t t = 0; t < kSeedsNum; ++t) {
+        ASSERT_TRUE(VecEq(results[t], results[t + kSeedsNum]));
+    }
+
+    // Interning the same types again after the race hits the already stored ones
+    std::mt19937 gen(0);
+    for (size_t i = 0; i < kTypesPerThread; ++i) {
+        ASSERT_EQ(RandomType(gen, i % 5), results[0][i]);
+    }
+}
+
+TEST(Types, MatchCache) {
+    ResetMatchCache(64);
+
+    Type either_ea = Type::Parameterized("Either", {Type::Var("e"), Type::Var("a")});
+    Type either_ci = Type::Parameterized("Either", {Type::Char(), Type::Int()});
+
+    auto match_map = TryMatchTypes(either_ea, either_ci).value();
+    ASSERT_EQ(ApplyMatchMap(either_ea, match_map), either_ci);
+
+    auto stats = GetMatchCacheStats();
+    ASSERT_EQ(stats.match_hits, 0);
+    ASSERT_EQ(stats.substitution_hits, 0);
+
+    ASSERT_EQ(TryMatchTypes(either_ea, either_ci).value(), match_map);
+    ASSERT_EQ(ApplyMatchMap(either_ea, match_map), either_ci);
+    ASSERT_FALSE(TryMatchTypes(either_ci, Type::Int()).has_value());
+    ASSERT_FALSE(TryMatchTypes(either_ci, Type::Int()).has_value());
+
+    stats = GetMatchCacheStats();
+    ASSERT_EQ(stats.match_hits, 2);
+    ASSERT_EQ(stats.substitution_hits, 1);
+
+    ResetMatchCache(64);
+    ASSERT_EQ(GetMatchCacheStats().match_hits, 0);
+}
+
+TEST(Types, UniverseReleasesTypes) {
+    Type permanent = Type::Parameterized("Maybe", {Type::Int()});
+
+    {
+        TypeUniverse universe;
+        ASSERT_EQ(universe.GetTypesNum(), 0);
+
+        Type program_type = Type::Tuple({Type::Parameterized("ProgramType", {}), Type::Char()});
+        ASSERT_EQ(universe.GetTypesNum(), 2);
+        ASSERT_EQ(program_type, Type::Tuple({Type::Simple("ProgramType"), Type::Char()}));
+
+        // Builtins and types created outside the universe are shared with it
+        ASSERT_EQ(Type::Parameterized("Maybe", {Type::Int()}), permanent);
+        ASSERT_EQ(Type::Parameterized("IO", {Type::Singleton()}).ToString(), "IO S");
+        ASSERT_EQ(universe.GetTypesNum(), 2);
+    }
+
+    ASSERT_EQ(permanent.ToString(), "Maybe Int");
+
+    {
+        TypeUniverse universe;
+        Type program_type = Type::Tuple({Type::Simple("ProgramType"), Type::Char()});
+        ASSERT_EQ(universe.GetTypesNum(), 2);
+        ASSERT_EQ(program_type.ToString(), "ProgramType x Char");
+    }
+}
+
+TEST(Types, NestedUniverses) {
+    TypeUniverse outer;
+    Type outer_type = Type::Simple("OuterType");
+
+    {
+        TypeUniverse inner;
+        Type list = Type::List(outer_type);
+        ASSERT_EQ(Type::Simple("OuterType"), outer_type);
+        ASSERT_EQ(inner.GetTypesNum(), 1);
+        ASSERT_EQ(outer.GetTypesNum(), 1);
+        ASSERT_EQ(list.ToString(), "[OuterType]");
+    }
+
+    ASSERT_EQ(outer.GetTypesNum(), 1);
+    ASSERT_EQ(Type::List(outer_type).ToString(), "[OuterType]");
+    ASSERT_EQ(outer.GetTypesNum(), 2);
+}
+
+TEST(Types, UniversesArePerThread) {
+    size_t all_types_num = TypeUniverse::GetAllTypesNum();
+    std::latch outer_released(1);
+    std::thread other_cook;
+
+    {
+        TypeUniverse universe;
+        Type shared = Type::Simple("Shared");
+
+        std::latch interned(1);
+        other_cook = std::thread([&]() {
+            TypeUniverse other;
+            Type tuple = Type::Tuple({Type::Simple("Shared"), Type::Simple("Own")});
+            EXPECT_EQ(tuple.GetComponents()[0], shared);
+            EXPECT_EQ(other.GetTypesNum(), 2);
+            interned.count_down();
+
+            // The borrowed type outlives the universe it was made in
+            outer_released.wait();
+            EXPECT_EQ(tuple.ToString(), "Shared x Own");
+            EXPECT_EQ(Type::Simple("Shared").GetID(), tuple.GetComponents()[0].GetID());
+        });
+
+        interned.wait();
+        ASSERT_EQ(universe.GetTypesNum(), 1);
+
+        // Tasks of a cook enter its universe
+        std::thread([&universe]() {
+            TypeUniverse::Scope scope(&universe);
+            Type::Simple("FromTask");
+        }).join();
+        ASSERT_EQ(universe.GetTypesNum(), 2);
+    }
+
+    outer_released.count_down();
+    other_cook.join();
+    ASSERT_EQ(TypeUniverse::GetAllTypesNum(), all_types_num);
+}
+
+TEST(Types, PinnedTypes) {
+    size_t all_types_num = TypeUniverse::GetAllTypesNum();
+    Type permanent = Type::Int();
+    PinnedTypes pins;
+
+    {
+        TypeUniverse universe;
+        Type pinned = Type::List(Type::Simple("Pinned"));
+        Type::Simple("Released");
+        ASSERT_EQ(universe.GetTypesNum(), 3);
+
+        pins.Add(pinned);
+        // Its text is kept too
+        ASSERT_EQ(pinned.ToString(), "[Pinned]");
+
+        {
+            TypeUniverse::PermanentScope permanent_scope;
+            permanent = Type::Tuple({Type::Simple("Pinned"), Type::Int()});
+        }
+        ASSERT_EQ(universe.GetTypesNum(), 2);
+    }
+
+    ASSERT_EQ(TypeUniverse::GetAllTypesNum(), all_types_num + 3);
+    ASSERT_EQ(permanent.ToString(), "Pinned x Int");
+
+    {
+        TypeUniverse universe;
+        Type pinned = Type::List(Type::Simple("Pinned"));
+        ASSERT_EQ(pinned.ToString(), "[Pinned]");
+        ASSERT_EQ(universe.GetTypesNum(), 0);
+
+        // Still handed out in this universe, so it lives until it's over
+        pins.Clear();
+        ASSERT_EQ(TypeUniverse::GetAllTypesNum(), all_types_num + 3);
+        ASSERT_EQ(pinned.ToString(), "[Pinned]");
+    }
+
+    // Only the permanent type and its child are left
+    ASSERT_EQ(TypeUniverse::GetAllTypesNum(), all_types_num + 2);
+}
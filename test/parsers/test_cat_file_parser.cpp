@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <komaru/parsers/cat_file_parser.hpp>
+#include <komaru/translate/cat_cooking.hpp>
+#include <komaru/util/filesystem.hpp>
+
+#include <filesystem>
+
+using namespace komaru::parsers;
+using namespace komaru::translate;
+
+// Saved by the editor: keys are sorted, node 1 is saved before node 0 it's connected to
+constexpr std::string_view kIdJson = R"({
+    "imports": ["Data.List"],
+    "nodes": [
+        {
+            "has_input_pin": false,
+            "id": 1,
+            "main_text": "Int",
+            "out_pins": [
+                {
+                    "connections": [
+                        {"node": 0, "text": "+ 1"},
+                        {"node": 2, "text": "id"}
+                    ],
+                    "label": " *"
+                }
+            ],
+            "tag_text": "f",
+            "x": 1.5e2,
+            "y": -3
+        },
+        {"has_input_pin": true, "id": 0, "main_text": "Int", "out_pins": []},
+        {
+            "has_input_pin": true,
+            "id": 2,
+            "main_text": " Int\t",
+            "out_pins": [{"connections": [], "extra": {"a": [1, null, "]"]}}],
+            "tag_text": ""
+        }
+    ],
+    "packages": []
+})";
+
+TEST(CatFileParser, Simple) {
+    auto maybe_file = CatFileParser(kIdJson).Parse();
+    ASSERT_TRUE(maybe_file.has_value()) << maybe_file.error().Error();
+
+    ASSERT_EQ(maybe_file->packages.size(), 0);
+    ASSERT_EQ(maybe_file->imports, std::vector<std::string>{"Data.List"});
+
+    const auto& nodes = maybe_file->program.GetNodes();
+    ASSERT_EQ(nodes.size(), 3);
+
+    ASSERT_EQ(nodes[0].type, "Int");
+    ASSERT_EQ(nodes[0].name, "f");
+    ASSERT_EQ(nodes[0].branchers, std::vector<std::string>{"*"});
+    ASSERT_FALSE(nodes[0].has_input);
+
+    ASSERT_TRUE(nodes[1].branchers.empty());
+    ASSERT_EQ(nodes[2].type, "Int");
+    ASSERT_FALSE(nodes[2].name.has_value());
+    ASSERT_EQ(nodes[2].branchers, std::vector<std::string>{"*"});
+
+    const auto& conns = maybe_file->program.GetConnections();
+    ASSERT_EQ(conns.size(), 2);
+    ASSERT_EQ(conns[0].source_node, 0);
+    ASSERT_EQ(conns[0].target_node, 1);
+    ASSERT_EQ(conns[0].morphism, "+ 1");
+    ASSERT_EQ(conns[1].target_node, 2);
+    ASSERT_EQ(conns[1].morphism, "id");
+
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    ASSERT_TRUE(Cook(maybe_file->program, symbols_registry).has_value());
+}
+
+TEST(CatFileParser, Escapes) {
+    auto maybe_file = CatFileParser(R"({"nodes": [{"id": 0, "main_text": "S", "out_pins": [],
+        "tag_text": "\"a\\b\/\né😀"}]})")
+                          .Parse();
+    ASSERT_TRUE(maybe_file.has_value()) << maybe_file.error().Error();
+    ASSERT_EQ(maybe_file->program.GetNodes()[0].name, "\"a\\b/\n\xC3\xA9\xF0\x9F\x98\x80");
+}
+
+TEST(CatFileParser, Errors) {
+    for (std::string_view json : {
+             "",
+             "[]",
+             R"({"nodes": [{"id": 0,}]})",
+             R"({"nodes": [{"id": 0.5}]})",
+             R"({"nodes": [{"id": 1}]})",
+             R"({"nodes": [{"id": 0}, {"id": 0}]})",
+             R"({"nodes": [{"id": 0, "out_pins": [{"connections": [{"node": 7}]}]}]})",
+             R"({"nodes": [{"id": 0, "out_pins": [{"connections": [{"node": 0}]}]}]})",
+             R"({"nodes": [{"id": 0, "out_pins": [{"label": "a"}, {}]}]})",
+             R"({"nodes": [{"id": 0, "main_text": "\ud83d"}]})",
+             R"({"nodes": [{"id": 0, "main_text": "Int}]})",
+             R"({"nodes": []} {})",
+         }) {
+        ASSERT_FALSE(CatFileParser(json).Parse().has_value()) << json;
+    }
+}
+
+TEST(CatFileParser, ReadFile) {
+    auto path = komaru::util::GenTmpFilepath();
+    ASSERT_FALSE(komaru::util::WriteFile(path, std::string(kIdJson)));
+
+    auto maybe_file = ReadCatFile(path);
+    std::filesystem::remove(path);
+
+    ASSERT_TRUE(maybe_file.has_value()) << maybe_file.error().Error();
+    ASSERT_EQ(maybe_file->program.GetNodes().size(), 3);
+    ASSERT_EQ(maybe_file->program.GetConnections().size(), 2);
+
+    ASSERT_FALSE(ReadCatFile(path).has_value());
+}
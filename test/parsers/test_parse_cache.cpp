@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <komaru/parsers/parse_cache.hpp>
+
+#include <string>
+
+using namespace komaru::parsers;
+using namespace komaru::lang;
+using namespace komaru::translate;
+
+TEST(ParseCache, Hits) {
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    ParseCache cache(symbols_registry);
+
+    for (size_t i = 0; i < 10; ++i) {
+        auto maybe_type = cache.ParseType("Int x Int");
+        ASSERT_TRUE(maybe_type.has_value());
+        ASSERT_EQ(maybe_type.value(), Type::Int().Pow(2));
+
+        auto maybe_morphism = cache.ParseMorphism("+ 1");
+        ASSERT_TRUE(maybe_morphism.has_value());
+        ASSERT_EQ(maybe_morphism.value()->ToString(), "+ 1");
+
+        ASSERT_TRUE(cache.ParsePattern("(x, *)").has_value());
+        ASSERT_FALSE(cache.ParseMorphism("(((").has_value());
+    }
+
+    ASSERT_EQ(cache.GetTypeCounters().misses, 1);
+    ASSERT_EQ(cache.GetTypeCounters().hits, 9);
+    ASSERT_EQ(cache.GetMorphismCounters().misses, 2);
+    ASSERT_EQ(cache.GetMorphismCounters().hits, 18);
+    ASSERT_DOUBLE_EQ(cache.GetPatternCounters().HitRate(), 0.9);
+}
+
+TEST(ParseCache, Generations) {
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    ParseCache cache(symbols_registry);
+
+    ASSERT_FALSE(cache.ParseMorphism("foo").has_value());
+
+    symbols_registry.AddLocalFunction("foo", Type::Function(Type::Int(), Type::Bool()));
+    auto maybe_morphism = cache.ParseMorphism("foo");
+    ASSERT_TRUE(maybe_morphism.has_value());
+    ASSERT_EQ(maybe_morphism.value()->GetTarget(), Type::Bool());
+
+    // Types don't depend on functions
+    ASSERT_TRUE(cache.ParseType("Int").has_value());
+
+    symbols_registry.ResetLocalFunctions();
+    ASSERT_FALSE(cache.ParseMorphism("foo").has_value());
+    ASSERT_TRUE(cache.ParseType("Int").has_value());
+
+    // Same symbols as before, same generation
+    symbols_registry.AddLocalFunction("foo", Type::Function(Type::Int(), Type::Bool()));
+    ASSERT_TRUE(cache.ParseMorphism("foo").has_value());
+
+    ASSERT_EQ(cache.GetMorphismCounters().misses, 2);
+    ASSERT_EQ(cache.GetMorphismCounters().hits, 2);
+    ASSERT_EQ(cache.GetTypeCounters().hits, 1);
+
+    symbols_registry.Reload();
+    ASSERT_TRUE(cache.ParseType("Int").has_value());
+    ASSERT_EQ(cache.GetTypeCounters().misses, 2);
+}
+
+TEST(ParseCache, UnrelatedFunctions) {
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    ParseCache cache(symbols_registry);
+
+    symbols_registry.AddLocalFunction("foo", Type::Function(Type::Int(), Type::Bool()));
+    ASSERT_TRUE(cache.ParseMorphism("foo").has_value());
+    ASSERT_TRUE(cache.ParseMorphism("+ 1").has_value());
+
+    // Functions the texts don't mention don't make them parse again
+    symbols_registry.AddLocalFunction("bar", Type::Int());
+    symbols_registry.AddGlobalFunction("baz", Type::Int());
+    ASSERT_TRUE(cache.ParseMorphism("foo").has_value());
+    ASSERT_TRUE(cache.ParseMorphism("+ 1").has_value());
+    ASSERT_EQ(cache.GetMorphismCounters().misses, 2);
+    ASSERT_EQ(cache.GetMorphismCounters().hits, 2);
+
+    // A global one of the same name is shadowed by the local one
+    symbols_registry.AddGlobalFunction("foo", Type::Function(Type::Int(), Type::Int()));
+    ASSERT_EQ(cache.ParseMorphism("foo").value()->GetTarget(), Type::Bool());
+    ASSERT_EQ(cache.GetMorphismCounters().hits, 3);
+
+    symbols_registry.ResetLocalFunctions();
+    ASSERT_EQ(cache.ParseMorphism("foo").value()->GetTarget(), Type::Int());
+    ASSERT_EQ(cache.GetMorphismCounters().misses, 3);
+}
+
+TEST(ParseCache, Bounded) {
+    constexpr size_t kMaxTextsNum = 8;
+
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    ParseCache cache(symbols_registry, kMaxTextsNum);
+
+    // Tuples of a new size every time, pinned only by the cache
+    auto tuple_text = [](size_t size) {
+        std::string raw = "Int";
+        for (size_t i = 1; i < size; ++i) {
+            raw += " x Int";
+        }
+        return raw;
+    };
+
+    size_t base_types_num = TypeUniverse::GetAllTypesNum();
+    for (size_t run = 0; run < 40; ++run) {
+        {
+            TypeUniverse universe;
+            ASSERT_EQ(cache.ParseType(tuple_text(run + 2)).value(), Type::Int().Pow(run + 2));
+        }
+        ASSERT_LE(cache.GetTextsNum(), kMaxTextsNum);
+        ASSERT_LE(TypeUniverse::GetAllTypesNum(), base_types_num + kMaxTextsNum) << run;
+    }
+
+    TypeUniverse universe;
+    ASSERT_TRUE(cache.ParseType(tuple_text(41)).has_value());
+    ASSERT_EQ(cache.GetTypeCounters().hits, 1);
+    ASSERT_TRUE(cache.ParseType(tuple_text(2)).has_value());
+    ASSERT_EQ(cache.GetTypeCounters().misses, 41);
+}
@@ -39,3 +39,40 @@ TEST(CppCond, Basic) {
     ASSERT_TRUE((x1 & x2).DoesImply(x2));
     ASSERT_TRUE((x1 & x2).DoesImply(x1 | x2));
 }
+
+TEST(CppCond, Canonical) {
+    Cond truth;
+    Cond x1 = Cond(0);
+    Cond x2 = Cond(1);
+    Cond x3 = Cond(2);
+    Cond not_x1 = Cond::Not(0);
+
+    ASSERT_EQ(x1 | (x1 & x2), x1);
+    ASSERT_EQ((x1 & x2) | x1, x1);
+    ASSERT_EQ(x1 | x1, x1);
+    ASSERT_EQ((x1 | x2) & x3, (x3 & x2) | (x1 & x3));
+    ASSERT_EQ((x1 & x2).ToString(), "(v0 & v1)");
+    ASSERT_EQ(((x2 & x3) | x1).ToString(), "v0 | (v1 & v2)");
+    ASSERT_EQ(not_x1.ToString(), "~v0");
+    ASSERT_EQ(Cond(-1).ToString(), "~v1");
+    ASSERT_EQ(Cond(-1), Cond::Not(1));
+
+    ASSERT_TRUE((x1 & not_x1).IsFalse());
+    ASSERT_TRUE((x1 | truth).IsTrue());
+    ASSERT_EQ((x1 & not_x1) | x2, x2);
+    ASSERT_TRUE(Cond::False().DoesImply(x1));
+
+    ASSERT_FALSE((x1 | x2).DoesImply(x1));
+    ASSERT_TRUE(((x1 & x3) | (x2 & x3)).DoesImply(x3));
+}
+
+TEST(CppCond, ManyVariables) {
+    Cond cond = Cond::False();
+    for (int32_t i = 0; i < 200; ++i) {
+        cond |= Cond(i) & Cond(i + 1);
+    }
+
+    ASSERT_TRUE((Cond(150) & Cond(151)).DoesImply(cond));
+    ASSERT_FALSE((Cond(150) & Cond(152)).DoesImply(cond));
+    ASSERT_EQ(cond | (Cond(7) & Cond(8) & Cond(130)), cond);
+}
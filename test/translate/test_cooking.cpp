@@ -7,6 +7,9 @@
 #include <komaru/translate/simple_symbols_registry.hpp>
 #include <komaru/translate/cpp/cpp_translator.hpp>
 #include <komaru/translate/exec_program.hpp>
+#include <komaru/translate/graphviz.hpp>
+
+#include <format>
 
 using namespace komaru::test;
 using namespace komaru::translate;
@@ -89,3 +92,172 @@ int Fib(int n) {
 //         ASSERT_EQ(res.Output(), expected);
 //     }
 // }
+
+TEST(Cooking, Incremental) {
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    IncrementalCooker cooker(symbols_registry);
+
+    auto maybe_program = cooker.Cook(MakeRawFibProgram(5));
+    ASSERT_TRUE(maybe_program.has_value()) << maybe_program.error().Error();
+    ASSERT_EQ(cooker.GetRecookedNum(), 2);
+
+    auto maybe_full_program = Cook(MakeRawFibProgram(5), symbols_registry);
+    ASSERT_TRUE(maybe_full_program.has_value());
+    ASSERT_EQ(maybe_program->GetNodes().size(), maybe_full_program->GetNodes().size());
+
+    maybe_program = cooker.Cook(MakeRawFibProgram(5));
+    ASSERT_TRUE(maybe_program.has_value());
+    ASSERT_EQ(cooker.GetRecookedNum(), 0);
+    ASSERT_EQ(maybe_program->GetNodes().size(), maybe_full_program->GetNodes().size());
+
+    // Only main has changed
+    maybe_program = cooker.Cook(MakeRawFibProgram(6));
+    ASSERT_TRUE(maybe_program.has_value());
+    ASSERT_EQ(cooker.GetRecookedNum(), 1);
+
+    cooker.Invalidate();
+    maybe_program = cooker.Cook(MakeRawFibProgram(6));
+    ASSERT_TRUE(maybe_program.has_value());
+    ASSERT_EQ(cooker.GetRecookedNum(), 2);
+
+    // Library symbols may resolve differently after a reload
+    symbols_registry.Reload();
+    maybe_program = cooker.Cook(MakeRawFibProgram(6));
+    ASSERT_TRUE(maybe_program.has_value());
+    ASSERT_EQ(cooker.GetRecookedNum(), 2);
+}
+
+TEST(Cooking, IncrementalUniverses) {
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    komaru::util::ThreadPool thread_pool(4);
+    IncrementalCooker cooker(symbols_registry, thread_pool);
+
+    std::string graphviz;
+    {
+        komaru::lang::TypeUniverse universe;
+        auto maybe_program = cooker.Cook(MakeRawFibProgram(5));
+        ASSERT_TRUE(maybe_program.has_value()) << maybe_program.error().Error();
+        ASSERT_EQ(cooker.GetRecookedNum(), 2);
+        graphviz = ToGraphviz(maybe_program.value());
+    }
+
+    // Kept functions and parse results outlive the universe they were made in
+    for (size_t i = 0; i < 2; ++i) {
+        komaru::lang::TypeUniverse universe;
+        auto maybe_program = cooker.Cook(MakeRawFibProgram(5));
+        ASSERT_TRUE(maybe_program.has_value());
+        ASSERT_EQ(cooker.GetRecookedNum(), 0);
+        ASSERT_EQ(ToGraphviz(maybe_program.value()), graphviz);
+    }
+
+    komaru::lang::TypeUniverse universe;
+    auto maybe_program = cooker.Cook(MakeRawFibProgram(6));
+    ASSERT_TRUE(maybe_program.has_value());
+    ASSERT_EQ(cooker.GetRecookedNum(), 1);
+}
+
+TEST(Cooking, LongEditingSession) {
+    constexpr size_t kRunsNum = 40;
+    constexpr size_t kWarmRunsNum = 6;
+
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    komaru::util::ThreadPool thread_pool(4);
+    IncrementalCooker cooker(symbols_registry, thread_pool);
+
+    size_t warm_types_num = 0;
+    for (size_t run = 0; run < kRunsNum; ++run) {
+        // Every run the user renames a function and changes its type
+        auto raw_program = MakeRawFibProgram(5);
+        std::string type = "Int";
+        for (size_t i = 0; i <= run % 3; ++i) {
+            type = std::format("[{}]", type);
+        }
+        auto root = raw_program.NewRootNodeWithName(type, std::format("f{}", run));
+        auto end = raw_program.NewEndNode(type);
+        raw_program.Connect(root, end, 0, "id");
+
+        {
+            komaru::lang::TypeUniverse universe;
+            auto maybe_program = cooker.Cook(raw_program);
+            ASSERT_TRUE(maybe_program.has_value()) << maybe_program.error().Error();
+        }
+
+        // Whatever the forgotten functions had is released with the runs
+        if (run + 1 == kWarmRunsNum) {
+            warm_types_num = komaru::lang::TypeUniverse::GetAllTypesNum();
+        } else if (run + 1 > kWarmRunsNum) {
+            ASSERT_EQ(komaru::lang::TypeUniverse::GetAllTypesNum(), warm_types_num) << run;
+        }
+    }
+}
+
+TEST(Cooking, ManyFunctions) {
+    constexpr size_t kFunctionsNum = 64;
+
+    RawCatProgram raw_program;
+
+    // f0 = + 1, fi = f(i - 1) . (* 2)
+    for (size_t i = 0; i < kFunctionsNum; ++i) {
+        auto root = raw_program.NewRootNodeWithName("Int", std::format("f{}", i));
+        auto doubled = raw_program.NewNode("Int");
+        auto end = raw_program.NewEndNode("Int");
+
+        raw_program.Connect(root, doubled, 0, "* 2")
+            .Connect(doubled, end, 0, i == 0 ? "+ 1" : std::format("f{}", i - 1));
+    }
+
+    auto main_node = raw_program.NewRootNodeWithName("S", "main");
+    auto val_node = raw_program.NewNode("Int");
+    auto final_node = raw_program.NewEndNode("Int");
+    raw_program.Connect(main_node, val_node, 0, "1")
+        .Connect(val_node, final_node, 0, std::format("f{}", kFunctionsNum - 1));
+
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    komaru::util::ThreadPool thread_pool(4);
+
+    auto maybe_program = Cook(raw_program, symbols_registry, thread_pool);
+    ASSERT_TRUE(maybe_program.has_value()) << maybe_program.error().Error();
+
+    komaru::util::ThreadPool no_threads(0);
+    auto maybe_serial_program = Cook(raw_program, symbols_registry, no_threads);
+    ASSERT_TRUE(maybe_serial_program.has_value());
+
+    ASSERT_EQ(maybe_program->GetNodes().size(), 3 * (kFunctionsNum + 1));
+    ASSERT_EQ(ToGraphviz(maybe_program.value()), ToGraphviz(maybe_serial_program.value()));
+
+    // Incremental cooking recooks changed functions on the pool too
+    IncrementalCooker cooker(symbols_registry, thread_pool);
+    auto maybe_incremental_program = cooker.Cook(raw_program);
+    ASSERT_TRUE(maybe_incremental_program.has_value());
+    ASSERT_EQ(cooker.GetRecookedNum(), kFunctionsNum + 1);
+    ASSERT_EQ(ToGraphviz(maybe_program.value()), ToGraphviz(maybe_incremental_program.value()));
+
+    // A single broken function fails the whole program
+    auto broken_root = raw_program.NewRootNodeWithName("Int", "g");
+    raw_program.Connect(broken_root, raw_program.NewEndNode("Int"), 0, "(((");
+    ASSERT_FALSE(Cook(raw_program, symbols_registry, thread_pool).has_value());
+}
+
+// Used to overflow the stack with recursive traversals
+TEST(Cooking, LongChain) {
+    constexpr size_t kChainLength = 1'000'000;
+
+    RawCatProgram raw_program;
+
+    auto prev = raw_program.NewRootNodeWithName("Int", "f");
+    for (size_t i = 1; i < kChainLength; ++i) {
+        auto next =
+            i + 1 == kChainLength ? raw_program.NewEndNode("Int") : raw_program.NewNode("Int");
+        raw_program.Connect(prev, next, 0, "+ 1");
+        prev = next;
+    }
+
+    ASSERT_FALSE(ToGraphviz(raw_program).empty());
+
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    auto maybe_program = Cook(raw_program, symbols_registry);
+    ASSERT_TRUE(maybe_program.has_value()) << maybe_program.error().Error();
+    ASSERT_EQ(maybe_program->GetNodes().size(), kChainLength);
+    // Every arrow shares one `+ 1`: the binded (+) and its literal
+    ASSERT_EQ(maybe_program->GetMorphisms().Size(), 3);
+}
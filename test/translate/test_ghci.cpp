@@ -1,8 +1,13 @@
 #include <gtest/gtest.h>
 
 #include <komaru/translate/haskell/ghci.hpp>
+#include <komaru/translate/haskell/ghci_pool.hpp>
 #include <komaru/lang/morphism.hpp>
 
+#include <chrono>
+#include <ranges>
+#include <thread>
+
 using namespace komaru::translate;
 using namespace komaru::lang;
 
@@ -70,3 +75,107 @@ TEST(GHCI, GetTypeConstructor) {
     ASSERT_EQ(maybe_int.value().ToString(), "Int");
     ASSERT_EQ(maybe_int.value().GetNumParams(), 0);
 }
+
+TEST(GHCI, Batched) {
+    auto maybe_ghci = hs::GHCI::CreateSession({}, {});
+
+    ASSERT_TRUE(maybe_ghci.has_value());
+
+    auto ghci = std::move(maybe_ghci.value());
+
+    // More than fits into one window of in-flight queries
+    std::vector<std::string> names;
+    for (size_t i = 0; i < 100; ++i) {
+        names.push_back(i % 3 == 0 ? "id" : (i % 3 == 1 ? "zip" : "kek"));
+    }
+
+    auto types = ghci->GetTypes(names);
+    ASSERT_EQ(types.size(), names.size());
+    for (auto [name, type] : std::views::zip(names, types)) {
+        ASSERT_EQ(type, ghci->GetType(name)) << name;
+    }
+
+    std::vector<std::string> constructor_names = {"IO", "kek", "Int", "Either"};
+    auto constructors = ghci->GetTypeConstructors(constructor_names);
+    ASSERT_EQ(constructors.size(), 4);
+    ASSERT_EQ(constructors[0]->GetNumParams(), 1);
+    ASSERT_FALSE(constructors[1].has_value());
+    ASSERT_EQ(constructors[2]->GetNumParams(), 0);
+    ASSERT_EQ(constructors[3]->GetNumParams(), 2);
+}
+
+TEST(GHCI, Pool) {
+    using namespace std::chrono_literals;
+
+    hs::GHCIPool pool(1, 4, 50ms);
+
+    auto wait_for_idle = [&](size_t idle_num) {
+        auto deadline = std::chrono::steady_clock::now() + 10s;
+        while (pool.GetIdleNum({}, {}) < idle_num &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(10ms);
+        }
+        return pool.GetIdleNum({}, {}) >= idle_num;
+    };
+
+    auto lease = pool.Acquire({}, {});
+    ASSERT_TRUE(lease.has_value());
+    ASSERT_EQ((*lease)->GetType("id"), Morphism::Identity()->GetType());
+
+    // A standby is started in the background
+    ASSERT_TRUE(wait_for_idle(1));
+
+    lease.reset();
+    ASSERT_EQ(pool.GetIdleNum({}, {}), 2);
+
+    lease = pool.Acquire({}, {});
+    ASSERT_TRUE(lease.has_value());
+    ASSERT_EQ(pool.GetIdleNum({}, {}), 1);
+
+    // Dead sessions aren't taken back and aren't handed out
+    EXPECT_ANY_THROW((*lease)->Interact(":quit\n"));
+    // Its output is closed a bit before it exits
+    for (auto deadline = std::chrono::steady_clock::now() + 10s;
+         (*lease)->IsAlive() && std::chrono::steady_clock::now() < deadline;) {
+        std::this_thread::sleep_for(10ms);
+    }
+    lease.reset();
+    ASSERT_EQ(pool.GetIdleNum({}, {}), 1);
+
+    lease = pool.Acquire({}, {});
+    ASSERT_TRUE(lease.has_value());
+    ASSERT_TRUE((*lease)->IsAlive());
+    ASSERT_EQ((*lease)->GetType("zip").value().ToString(), "[a] -> [b] -> [a x b]");
+    ASSERT_TRUE(wait_for_idle(1));
+
+    auto bad_lease = pool.Acquire({}, {hs::HaskellImport{
+                                          .module_name = "No.Such.Module",
+                                          .ref_name = "",
+                                          .symbols = {},
+                                      }});
+    ASSERT_FALSE(bad_lease.has_value());
+}
+
+TEST(GHCI, PoolLimits) {
+    using namespace std::chrono_literals;
+
+    hs::GHCIPool pool(0, 4, 20ms, 2, 200ms);
+
+    std::vector<hs::GHCIPool::Lease> leases;
+    for (size_t i = 0; i < 3; ++i) {
+        auto lease = pool.Acquire({}, {});
+        ASSERT_TRUE(lease.has_value());
+        leases.push_back(std::move(lease.value()));
+    }
+
+    // Only two of them are kept over all configurations
+    leases.clear();
+    ASSERT_EQ(pool.GetIdleNum({}, {}), 2);
+
+    // Nobody has leased it for a while, so the configuration is dropped
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (pool.GetIdleNum({}, {}) > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(10ms);
+    }
+    ASSERT_EQ(pool.GetIdleNum({}, {}), 0);
+}
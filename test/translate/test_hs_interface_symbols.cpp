@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <komaru/translate/haskell/hs_interface_symbols.hpp>
+#include <komaru/translate/haskell/hs_symbols_registry.hpp>
+#include <komaru/util/filesystem.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+using namespace komaru::translate;
+using namespace komaru::lang;
+
+TEST(HaskellInterfaceSymbols, Load) {
+    auto path = komaru::util::GenTmpFilepath();
+    std::string interface =
+        "-- made by hand\n"
+        "komaru-hs-interface 1\n"
+        "f zip :: [a] -> [b] -> [(a, b)]\n"
+        "f print :: Show a => a -> IO ()\n"
+        "f (>=>) :: Monad m => (a -> m b) -> (b -> m c) -> a -> m c\n"
+        "t Either :: * -> * -> *\n"
+        "t Int :: *\n";
+    ASSERT_FALSE(komaru::util::WriteFile(path, interface));
+
+    auto maybe_symbols = hs::HaskellInterfaceSymbols::Load(path);
+    ASSERT_TRUE(maybe_symbols.has_value());
+
+    auto a = Type::Var("a");
+    auto b = Type::Var("b");
+    ASSERT_EQ(maybe_symbols->FindFunction("zip"),
+              Type::FunctionChain({Type::List(a), Type::List(b), Type::List(Type::Tuple({a, b}))}));
+    ASSERT_EQ(maybe_symbols->FindFunction("print"),
+              Type::Function(a, Type::Parameterized("IO", {Type::Singleton()})));
+    ASSERT_TRUE(maybe_symbols->FindFunction("(>=>)").has_value());
+    ASSERT_FALSE(maybe_symbols->FindFunction("kek").has_value());
+    ASSERT_FALSE(maybe_symbols->FindFunction("Either").has_value());
+
+    ASSERT_EQ(maybe_symbols->FindTypeConstructor("Either")->GetNumParams(), 2);
+    ASSERT_EQ(maybe_symbols->FindTypeConstructor("Int")->GetNumParams(), 0);
+    ASSERT_FALSE(maybe_symbols->FindTypeConstructor("zip").has_value());
+
+    ASSERT_TRUE(std::holds_alternative<Type>(maybe_symbols->FindSymbol("zip").value()));
+    ASSERT_TRUE(
+        std::holds_alternative<TypeConstructor>(maybe_symbols->FindSymbol("Either").value()));
+    ASSERT_FALSE(maybe_symbols->FindSymbol("kek").has_value());
+
+    // Files of another version and broken files aren't loaded
+    ASSERT_FALSE(komaru::util::WriteFile(path, "komaru-hs-interface 2\nt Int :: *\n"));
+    ASSERT_FALSE(hs::HaskellInterfaceSymbols::Load(path).has_value());
+    ASSERT_FALSE(komaru::util::WriteFile(path, "komaru-hs-interface 1\nt Int :: * ->\n"));
+    ASSERT_FALSE(hs::HaskellInterfaceSymbols::Load(path).has_value());
+
+    std::filesystem::remove(path);
+    ASSERT_FALSE(hs::HaskellInterfaceSymbols::Load(path).has_value());
+}
+
+TEST(HaskellInterfaceSymbols, Dump) {
+    auto path = komaru::util::GenTmpFilepath();
+
+    auto maybe_ghci = hs::GHCI::CreateSession({}, {});
+    ASSERT_TRUE(maybe_ghci.has_value());
+    ASSERT_FALSE(hs::DumpHaskellInterface(**maybe_ghci, {}, path));
+
+    auto maybe_symbols = hs::HaskellInterfaceSymbols::Load(path);
+    ASSERT_TRUE(maybe_symbols.has_value());
+
+    // Answers are the same as GHCi's
+    for (const std::string name : {"zip", "(!!)", "fmap", "Just", "liftM2"}) {
+        auto maybe_type = maybe_symbols->FindFunction(name);
+        ASSERT_TRUE(maybe_type.has_value()) << name;
+        ASSERT_EQ(maybe_type, (*maybe_ghci)->GetType(name)) << name;
+    }
+    for (const std::string name : {"Maybe", "Either"}) {
+        ASSERT_EQ(maybe_symbols->FindTypeConstructor(name)->GetNumParams(),
+                  (*maybe_ghci)->GetTypeConstructor(name)->GetNumParams())
+            << name;
+    }
+
+    // A symbol GHCi doesn't know can only come from the file
+    std::ofstream(path, std::ios::app) << "f fileOnly :: Int\n";
+
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    symbols_registry.SetInterfaceFile(path);
+    symbols_registry.Reload();
+
+    ASSERT_EQ(symbols_registry.FindFunction("zip"), (*maybe_ghci)->GetType("zip"));
+    ASSERT_EQ(symbols_registry.FindTypeConstructor("Either")->GetNumParams(), 2);
+    ASSERT_EQ(symbols_registry.FindFunction("fileOnly"), Type::Int());
+    // GHCi knows it, but it's not in the file
+    ASSERT_FALSE(symbols_registry.FindFunction("Data.List.sortOn").has_value());
+
+    symbols_registry.SetInterfaceFile(path.string() + ".missing");
+    ASSERT_ANY_THROW(symbols_registry.Reload());
+
+    std::filesystem::remove(path);
+}
+
+TEST(HaskellInterfaceSymbols, DumpImportedMembers) {
+    auto path = komaru::util::GenTmpFilepath();
+
+    auto maybe_ghci = hs::GHCI::CreateSession({}, {});
+    ASSERT_TRUE(maybe_ghci.has_value());
+
+    // `T(..)` brings the constructors and methods along with T
+    std::vector<hs::HaskellImport> imports = {
+        hs::HaskellImport{.module_name = "Prelude", .symbols = {"Maybe(..)", "Functor(..)"}}};
+    ASSERT_FALSE(hs::DumpHaskellInterface(**maybe_ghci, imports, path));
+
+    auto maybe_symbols = hs::HaskellInterfaceSymbols::Load(path);
+    ASSERT_TRUE(maybe_symbols.has_value());
+
+    for (const std::string name : {"Just", "Nothing", "fmap"}) {
+        ASSERT_TRUE(maybe_symbols->FindFunction(name).has_value()) << name;
+    }
+    ASSERT_TRUE(maybe_symbols->FindTypeConstructor("Maybe").has_value());
+    ASSERT_FALSE(maybe_symbols->FindFunction("zip").has_value());
+    ASSERT_FALSE(maybe_symbols->FindFunction("Left").has_value());
+    ASSERT_FALSE(maybe_symbols->FindTypeConstructor("Either").has_value());
+
+    std::filesystem::remove(path);
+}
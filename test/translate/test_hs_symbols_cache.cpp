@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <komaru/translate/cat_cooking.hpp>
+#include <komaru/translate/haskell/hs_symbols_cache.hpp>
+#include <komaru/translate/haskell/hs_symbols_registry.hpp>
+#include <komaru/util/filesystem.hpp>
+
+#include <filesystem>
+
+using namespace komaru::translate;
+using namespace komaru::lang;
+
+namespace {
+
+hs::HaskellLibSymbols MakeSymbols() {
+    auto a = Type::Var("a");
+    auto b = Type::Var("b");
+
+    hs::HaskellLibSymbols symbols;
+    symbols.functions.emplace("zip", Type::FunctionChain({Type::List(a), Type::List(b),
+                                                          Type::List(Type::Tuple({a, b}))}));
+    symbols.functions.emplace(
+        "print", Type::Function(a, Type::Parameterized("IO", {Type::Singleton()})));
+    symbols.functions.emplace("kek", std::nullopt);
+    symbols.type_constructors.emplace("Either", 2);
+    symbols.type_constructors.emplace("Kek", std::nullopt);
+    return symbols;
+}
+
+}  // namespace
+
+TEST(HaskellSymbolsCache, SaveLoad) {
+    auto dir = komaru::util::GenTmpFilepath();
+    auto path = hs::GetSymbolsCachePath(dir, "key");
+    auto symbols = MakeSymbols();
+
+    ASSERT_FALSE(hs::LoadSymbolsCache(path, "key").has_value());
+    ASSERT_FALSE(hs::SaveSymbolsCache(path, "key", symbols));
+
+    auto maybe_symbols = hs::LoadSymbolsCache(path, "key");
+    ASSERT_TRUE(maybe_symbols.has_value());
+    ASSERT_EQ(maybe_symbols->functions, symbols.functions);
+    ASSERT_EQ(maybe_symbols->type_constructors, symbols.type_constructors);
+
+    ASSERT_FALSE(hs::LoadSymbolsCache(path, "another key").has_value());
+
+    // Truncated files are ignored
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    ASSERT_FALSE(hs::LoadSymbolsCache(path, "key").has_value());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(HaskellSymbolsCache, Registry) {
+    auto dir = komaru::util::GenTmpFilepath();
+
+    {
+        hs::HaskellSymbolsRegistry symbols_registry({}, {});
+        symbols_registry.SetCacheDir(dir);
+        symbols_registry.Reload();
+
+        ASSERT_EQ(symbols_registry.FindFunction("zip"), MakeSymbols().functions.at("zip"));
+        ASSERT_FALSE(symbols_registry.FindFunction("kek").has_value());
+        ASSERT_EQ(symbols_registry.FindTypeConstructor("Either")->GetNumParams(), 2);
+    }
+
+    auto key = hs::MakeSymbolsCacheKey({}, {});
+    ASSERT_TRUE(key.has_value());
+
+    auto maybe_symbols = hs::LoadSymbolsCache(hs::GetSymbolsCachePath(dir, *key), *key);
+    ASSERT_TRUE(maybe_symbols.has_value());
+    ASSERT_EQ(maybe_symbols->functions.size(), 2);
+    ASSERT_EQ(maybe_symbols->type_constructors.size(), 1);
+
+    // A symbol GHCi doesn't know can only come from the cache
+    maybe_symbols->functions.emplace("cachedOnly", Type::Int());
+    ASSERT_FALSE(hs::SaveSymbolsCache(hs::GetSymbolsCachePath(dir, *key), *key, *maybe_symbols));
+
+    hs::HaskellSymbolsRegistry symbols_registry({}, {});
+    symbols_registry.SetCacheDir(dir);
+    symbols_registry.Reload();
+    ASSERT_EQ(symbols_registry.FindFunction("cachedOnly"), Type::Int());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(HaskellSymbolsCache, ProgramNamesArentCached) {
+    auto dir = komaru::util::GenTmpFilepath();
+
+    RawCatProgram raw_program;
+    auto root = raw_program.NewRootNodeWithName("Maybe Int", "f", {"Just boundVar", "Nothing"});
+    raw_program.Connect(root, raw_program.NewEndNode("Int"), 0, "+ boundVar")
+        .Connect(root, raw_program.NewEndNode("Int"), 1, "f");
+
+    {
+        hs::HaskellSymbolsRegistry symbols_registry({}, {});
+        symbols_registry.SetCacheDir(dir);
+        symbols_registry.Reload();
+        [[maybe_unused]] auto maybe_program = Cook(raw_program, symbols_registry);
+        ASSERT_FALSE(symbols_registry.SaveCache());
+    }
+
+    auto key = hs::MakeSymbolsCacheKey({}, {});
+    ASSERT_TRUE(key.has_value());
+
+    auto maybe_symbols = hs::LoadSymbolsCache(hs::GetSymbolsCachePath(dir, *key), *key);
+    ASSERT_TRUE(maybe_symbols.has_value());
+    ASSERT_TRUE(maybe_symbols->functions.contains("(+)"));
+    ASSERT_FALSE(maybe_symbols->functions.contains("boundVar"));
+    ASSERT_FALSE(maybe_symbols->functions.contains("f"));
+
+    std::filesystem::remove_all(dir);
+}
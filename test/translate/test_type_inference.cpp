@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <test/translate/programs.hpp>
+#include <test/translate/program_utils.hpp>
+
+#include <komaru/translate/common/type_inference.hpp>
+
+using namespace komaru::lang;
+using namespace komaru::test;
+using namespace komaru::translate;
+
+namespace {
+
+const CatProgram::Node& FindNode(const CatProgram& program, const std::string& name) {
+    for (const auto& node : program.GetNodes()) {
+        if (node.GetName() == name) {
+            return node;
+        }
+    }
+    throw std::runtime_error("node not found: " + name);
+}
+
+}  // namespace
+
+TEST(TypeInference, APlusB) {
+    auto program = MakeAPlusBProgram(1, 2);
+    auto maybe_types = common::InferFunctionTypes(FindNode(program, "main"));
+    ASSERT_TRUE(maybe_types.has_value()) << maybe_types.error().Error();
+
+    const auto& types = maybe_types.value();
+    ASSERT_EQ(types.node_types.size(), program.GetNodes().size());
+    ASSERT_EQ(types.return_type, Type::Int());
+    ASSERT_EQ(types.node_types.at(&FindNode(program, "main")), Type::Singleton());
+
+    for (const auto& [arrow, type] : types.arrow_types) {
+        if (arrow->GetMorphism()->ToString() == "+") {
+            ASSERT_EQ(type, Type::FunctionChain({Type::Int(), Type::Int(), Type::Int()}));
+        }
+    }
+}
+
+TEST(TypeInference, VariablesAreSolvedGlobally) {
+    auto builder = CatProgramBuilder();
+
+    auto [start_node, start_pin] = builder.NewNodeWithPin(Type::Singleton(), "main");
+    auto [a_node, a_pin] = builder.NewNodeWithPin(Type::Var("a"), "a");
+    auto [b_node, b_pin] = builder.NewNodeWithPin(Type::Auto(), "b");
+    auto& c_node = builder.NewNode(Type::List(Type::Var("c")), "c");
+
+    builder.Connect(start_pin, a_node, MakeLiteralMorphism('x'))
+        .Connect(a_pin, b_node, Morphism::Identity())
+        .Connect(b_pin, c_node,
+                 Morphism::CommonWithType(
+                     "replicate2", Type::Function(Type::Var("x"), Type::List(Type::Var("x")))));
+
+    auto program = builder.Extract();
+    auto maybe_types = common::InferFunctionTypes(FindNode(program, "main"));
+    ASSERT_TRUE(maybe_types.has_value()) << maybe_types.error().Error();
+
+    const auto& types = maybe_types.value();
+    ASSERT_EQ(types.node_types.at(&FindNode(program, "a")), Type::Char());
+    ASSERT_EQ(types.node_types.at(&FindNode(program, "b")), Type::Char());
+    ASSERT_EQ(types.node_types.at(&FindNode(program, "c")), Type::List(Type::Char()));
+    ASSERT_EQ(types.return_type, Type::List(Type::Char()));
+}
+
+TEST(TypeInference, TypeConstructorVariables) {
+    auto builder = CatProgramBuilder();
+
+    auto [start_node, start_pin] = builder.NewNodeWithPin(Type::Singleton(), "main");
+    auto& res_node = builder.NewNode(Type::Parameterized("m", {Type::Var("a")}), "res");
+
+    builder.Connect(start_pin, res_node,
+                    Morphism::Common("read", Type::Singleton(),
+                                     Type::Parameterized("IO", {Type::Int()})));
+
+    auto program = builder.Extract();
+    auto maybe_types = common::InferFunctionTypes(FindNode(program, "main"));
+    ASSERT_TRUE(maybe_types.has_value()) << maybe_types.error().Error();
+    ASSERT_EQ(maybe_types->node_types.at(&FindNode(program, "res")),
+              Type::Parameterized("IO", {Type::Int()}));
+}
+
+TEST(TypeInference, SameNamedVariablesStayApart) {
+    auto builder = CatProgramBuilder();
+
+    // `a` of the annotation and `a` of the morphism are different variables
+    auto [start_node, start_pin] = builder.NewNodeWithPin(Type::Var("a"), "main");
+    auto& res_node = builder.NewNode(Type::Auto(), "res");
+
+    builder.Connect(start_pin, res_node,
+                    Morphism::CommonWithType("anything",
+                                             Type::Function(Type::Var("b"), Type::Var("a"))));
+
+    auto program = builder.Extract();
+    auto maybe_types = common::InferFunctionTypes(FindNode(program, "main"));
+    ASSERT_TRUE(maybe_types.has_value()) << maybe_types.error().Error();
+
+    Type main_type = maybe_types->node_types.at(&FindNode(program, "main"));
+    Type res_type = maybe_types->node_types.at(&FindNode(program, "res"));
+    ASSERT_NE(main_type, res_type);
+    // Nodes are named in BFS order, so the root always keeps its declared name
+    ASSERT_EQ(main_type, Type::Var("a"));
+    ASSERT_EQ(maybe_types->return_type, res_type);
+    for (const auto& [arrow, type] : maybe_types->arrow_types) {
+        ASSERT_EQ(type, Type::Function(main_type, res_type));
+    }
+}
+
+TEST(TypeInference, Mismatch) {
+    auto builder = CatProgramBuilder();
+
+    auto [start_node, start_pin] = builder.NewNodeWithPin(Type::Singleton(), "main");
+    auto [a_node, a_pin] = builder.NewNodeWithPin(Type::Var("a"), "a");
+    auto& b_node = builder.NewNode(Type::Int(), "b");
+
+    builder.Connect(start_pin, a_node, MakeLiteralMorphism('x'))
+        .Connect(a_pin, b_node, Morphism::Identity());
+
+    auto program = builder.Extract();
+    ASSERT_FALSE(common::InferFunctionTypes(FindNode(program, "main")).has_value());
+}
+
+TEST(TypeInference, LongChain) {
+    constexpr size_t kChainLength = 100'000;
+
+    auto builder = CatProgramBuilder();
+
+    auto [start_node, start_pin] = builder.NewNodeWithPin(Type::Singleton(), "main");
+    auto [first_node, first_pin] = builder.NewNodeWithPin(Type::Var("a"));
+    builder.Connect(start_pin, first_node, MakeLiteralMorphism('x'));
+
+    auto* pin = &first_pin;
+    for (size_t i = 0; i < kChainLength; ++i) {
+        auto [node, next_pin] = builder.NewNodeWithPin(Type::Auto());
+        builder.Connect(*pin, node, Morphism::Identity());
+        pin = &next_pin;
+    }
+
+    auto& last_node = builder.NewNode(Type::Auto(), "last");
+    builder.Connect(*pin, last_node, Morphism::Identity());
+
+    auto program = builder.Extract();
+    auto maybe_types = common::InferFunctionTypes(FindNode(program, "main"));
+    ASSERT_TRUE(maybe_types.has_value()) << maybe_types.error().Error();
+    ASSERT_EQ(maybe_types->return_type, Type::Char());
+
+    const auto* main_node = &FindNode(program, "main");
+    for (const auto& [node, type] : maybe_types->node_types) {
+        if (node != main_node) {
+            ASSERT_EQ(type, Type::Char());
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <komaru/util/cli_program_manipulator.hpp>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+using komaru::util::CLIProgramManipulator;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::chrono::microseconds GetThreadCPUTime() {
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+}  // namespace
+
+TEST(CLIProgramManipulator, Interact) {
+    CLIProgramManipulator cat({"cat"}, "\n", false);
+
+    ASSERT_EQ(cat.Interact("first\n"), "first");
+    ASSERT_EQ(cat.InteractMany(std::vector<std::string>{"a\n", "b\n", "\n"}),
+              (std::vector<std::string>{"a", "b", ""}));
+    ASSERT_TRUE(cat.IsAlive());
+}
+
+TEST(CLIProgramManipulator, SplitSeparator) {
+    // The separator comes in several reads
+    std::string script =
+        "'while read line; do echo $line; sleep 0.05; echo .; sleep 0.05; echo; done'";
+    CLIProgramManipulator sh({"sh", "-c", script}, "\n.\n\n", false);
+
+    ASSERT_EQ(sh.Interact("one\n"), "one");
+    ASSERT_EQ(sh.Interact("two\n"), "two");
+}
+
+TEST(CLIProgramManipulator, LargeResponse) {
+    constexpr size_t kSize = 32 << 20;
+
+    CLIProgramManipulator sh({"sh", "-c", "'read line; head -c 33554432 /dev/zero; echo END'"},
+                             "END\n", false);
+
+    auto start = std::chrono::steady_clock::now();
+    auto resp = sh.Interact("go\n");
+    ASSERT_EQ(resp.size(), kSize);
+    ASSERT_EQ(resp.find_first_not_of('\0'), std::string::npos);
+    // Reading must stay linear in the response's size
+    ASSERT_LT(std::chrono::steady_clock::now() - start, 10s);
+}
+
+TEST(CLIProgramManipulator, IdleWait) {
+    CLIProgramManipulator sh({"sh", "-c", "'read line; sleep 0.5; echo done'"}, "\n", false);
+
+    auto cpu_time = GetThreadCPUTime();
+    ASSERT_EQ(sh.Interact("go\n"), "done");
+    // Waiting for the response doesn't spin
+    ASSERT_LT(GetThreadCPUTime() - cpu_time, 100ms);
+}
+
+TEST(CLIProgramManipulator, Timeout) {
+    CLIProgramManipulator sh({"sh", "-c", "'read line; sleep 10; echo done'"}, "\n", false,
+                             100ms);
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_ANY_THROW(sh.Interact("go\n"));
+    ASSERT_LT(std::chrono::steady_clock::now() - start, 5s);
+
+    // The late response can't be mistaken for the next one's
+    ASSERT_FALSE(sh.IsAlive());
+    ASSERT_ANY_THROW(sh.Interact("go\n"));
+
+    ASSERT_ANY_THROW(CLIProgramManipulator({"sleep", "10"}, "\n", true, 100ms));
+}
+
+TEST(CLIProgramManipulator, Stop) {
+    std::stop_source stop;
+    std::jthread stopper([&]() {
+        std::this_thread::sleep_for(100ms);
+        stop.request_stop();
+    });
+
+    // The program never answers, but the wait for it ends
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_ANY_THROW(
+        CLIProgramManipulator({"sleep", "10"}, "\n", true, std::nullopt, stop.get_token()));
+    ASSERT_LT(std::chrono::steady_clock::now() - start, 5s);
+}
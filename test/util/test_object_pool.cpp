@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <komaru/util/object_pool.hpp>
+
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using komaru::util::ObjectPool;
+
+namespace {
+
+struct Item {
+    char data[24];
+};
+
+}  // namespace
+
+TEST(ObjectPool, ForeignFreesComeBack) {
+    constexpr size_t kItemsNum = 1000;
+    constexpr size_t kRoundsNum = 100;
+
+    std::unordered_set<void*> seen;
+    for (size_t round = 0; round < kRoundsNum; ++round) {
+        std::vector<void*> items;
+        for (size_t i = 0; i < kItemsNum; ++i) {
+            items.push_back(ObjectPool<Item>::Allocate());
+            seen.insert(items.back());
+        }
+
+        std::thread([&items]() {
+            for (void* item : items) {
+                ObjectPool<Item>::Deallocate(item);
+            }
+        }).join();
+    }
+
+    // Otherwise every round would take fresh blocks
+    ASSERT_LT(seen.size(), 4 * kItemsNum);
+}
+
+TEST(ObjectPool, ExitedThreadsPoolIsReused) {
+    void* item = nullptr;
+    std::thread([&item]() {
+        item = ObjectPool<Item>::Allocate();
+        ObjectPool<Item>::Deallocate(item);
+    }).join();
+
+    bool reused = false;
+    std::thread([&]() {
+        void* other = ObjectPool<Item>::Allocate();
+        reused = other == item;
+        ObjectPool<Item>::Deallocate(other);
+    }).join();
+
+    ASSERT_TRUE(reused);
+}
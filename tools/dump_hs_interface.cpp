@@ -0,0 +1,46 @@
+#include <komaru/parsers/cat_file_parser.hpp>
+#include <komaru/translate/haskell/ghci.hpp>
+#include <komaru/translate/haskell/hs_interface_symbols.hpp>
+
+#include <print>
+#include <vector>
+
+namespace hs = komaru::translate::hs;
+
+// Usage: dump_hs_interface <program.cat> <output>
+//
+// Asks GHCi once about the symbols of the program's packages and imports, so that the program
+// can be cooked with KOMARU_HS_INTERFACE_FILE=<output> where GHC isn't installed.
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::println(stderr, "usage: {} <program.cat> <output>", argv[0]);
+        return 2;
+    }
+
+    auto maybe_file = komaru::parsers::ReadCatFile(argv[1]);
+    if (!maybe_file) {
+        std::println(stderr, "failed to read {}: {}", argv[1], maybe_file.error().Error());
+        return 1;
+    }
+
+    std::vector<hs::HaskellImport> imports;
+    for (const auto& text : maybe_file->imports) {
+        auto maybe_import = hs::ParseHaskellImport(text);
+        if (!maybe_import) {
+            std::println(stderr, "failed to parse import \"{}\"", text);
+            return 1;
+        }
+        imports.push_back(std::move(maybe_import.value()));
+    }
+
+    auto maybe_ghci = hs::GHCI::CreateSession(maybe_file->packages, imports);
+    if (!maybe_ghci) {
+        std::println(stderr, "failed to create ghci session");
+        return 1;
+    }
+
+    if (auto error = hs::DumpHaskellInterface(**maybe_ghci, imports, argv[2])) {
+        std::println(stderr, "failed to write {}: {}", argv[2], error.message());
+        return 1;
+    }
+}